@@ -0,0 +1,575 @@
+/*****************************************************************************
+ * decode_throughput.cpp: Decoding capacity through the video & audio callbacks
+ *****************************************************************************
+ * Copyright © 2015 libvlcpp authors & VideoLAN
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Decodes a set of clips through VLC::DecodeSession, and reports the frames
+ * & samples delivered per second, the CPU time they cost, and the callback
+ * latencies.
+ *
+ * The clips are generated by libvlc itself on the first run: a synthetic
+ * pattern is fed through the imem input, and encoded with the transcode
+ * stream output. Clips which can't be generated, ie. because libvlc was
+ * built without the matching encoder, are reported as skipped. Generated
+ * clips are kept in the work directory and reused by the following runs.
+ *
+ * usage: vlcpp_bench_decode [--workdir=<dir>] [--clip-duration-s=<s>]
+ *                           [--regenerate=1] [--video-rate=<r>]
+ *                           [--audio-rate=<r>] [harness options]
+ *
+ * The rates default to DecodeSession's: MaxRate for video, and
+ * DecodeSession::MaxAudioRate for audio, since libvlc drops the audio played
+ * faster, which also caps --audio-rate. Audio played at a rate other than 1
+ * is resampled: --audio-rate=1 measures the decoding of unmodified samples.
+ * The rate field reports the rate actually used, and realtime_factor how
+ * many seconds of media were decoded per second.
+ *
+ * The CPU time is the process time, as reported by std::clock(), and
+ * includes all the libvlc threads.
+ */
+
+#include "vlcpp/vlc.hpp"
+#include "harness.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <future>
+#include <vector>
+
+using Benchmark::Harness;
+
+namespace
+{
+
+/**
+ * A clip to generate. Video clips have no audio track and vice versa, since
+ * imem provides a single elementary stream.
+ */
+struct Clip
+{
+    const char* name;
+    // Video clips only
+    const char* vcodec;
+    unsigned int width;
+    unsigned int height;
+    unsigned int fps;
+    // Audio clips only
+    const char* acodec;
+    unsigned int rate;
+    unsigned int channels;
+    // In kb/s, 0 for the encoder's default
+    unsigned int bitrate;
+    const char* mux;
+    const char* extension;
+
+    bool isVideo() const
+    {
+        return vcodec != nullptr;
+    }
+};
+
+const Clip Clips[] = {
+    { "h264_640x360",   "h264", 640,  360,  25, nullptr, 0,     0, 1000, "mp4", "mp4" },
+    { "h264_1280x720",  "h264", 1280, 720,  25, nullptr, 0,     0, 3000, "mp4", "mp4" },
+    { "h264_1920x1080", "h264", 1920, 1080, 25, nullptr, 0,     0, 6000, "mp4", "mp4" },
+    { "mp4v_1280x720",  "mp4v", 1280, 720,  25, nullptr, 0,     0, 4000, "mp4", "mp4" },
+    { "mp2v_1280x720",  "mp2v", 1280, 720,  25, nullptr, 0,     0, 6000, "ts",  "ts" },
+    { "theo_640x360",   "theo", 640,  360,  25, nullptr, 0,     0, 1500, "ogg", "ogv" },
+    { "mp3_44100_2",    nullptr, 0,   0,    0,  "mp3",   44100, 2, 192,  "raw", "mp3" },
+    { "vorb_48000_2",   nullptr, 0,   0,    0,  "vorb",  48000, 2, 160,  "ogg", "ogg" },
+    { "flac_44100_2",   nullptr, 0,   0,    0,  "flac",  44100, 2, 0,    "ogg", "oga" },
+    { "mp4a_48000_2",   nullptr, 0,   0,    0,  "mp4a",  48000, 2, 192,  "mp4", "m4a" },
+    { "s16l_48000_6",   nullptr, 0,   0,    0,  "s16l",  48000, 6, 0,    "wav", "wav" },
+};
+
+/**
+ * Produces the raw content fed to the imem input: a moving I420 pattern with
+ * some noise, so that encoders & decoders have actual work to do, or a
+ * stereo/multichannel sine in s16l.
+ */
+class Generator
+{
+public:
+    Generator( const Clip& clip, unsigned int durationS )
+        : m_clip( clip )
+        , m_index( 0 )
+    {
+        if ( clip.isVideo() == true )
+        {
+            m_count = static_cast<uint64_t>( durationS ) * clip.fps;
+            m_buffer.resize( clip.width * clip.height * 3 / 2 );
+            // Deterministic noise, shifted on each frame
+            m_noise.resize( clip.width * clip.height );
+            uint32_t seed = 0x12345678;
+            for ( auto& n : m_noise )
+            {
+                seed = seed * 1664525 + 1013904223;
+                n = static_cast<uint8_t>( ( seed >> 24 ) & 0x1f );
+            }
+        }
+        else
+        {
+            m_count = static_cast<uint64_t>( durationS ) * clip.rate / SamplesPerBlock;
+            m_buffer.resize( SamplesPerBlock * clip.channels * sizeof( int16_t ) );
+        }
+    }
+
+    static int get( void* data, const char*, int64_t* dts, int64_t* pts, unsigned* flags,
+                    size_t* size, void** buffer )
+    {
+        auto self = static_cast<Generator*>( data );
+        if ( self->m_index >= self->m_count )
+            return 1;
+        if ( self->m_clip.isVideo() == true )
+        {
+            self->fillVideo();
+            *pts = *dts = static_cast<int64_t>( self->m_index * 1000000 / self->m_clip.fps );
+        }
+        else
+        {
+            self->fillAudio();
+            *pts = *dts = static_cast<int64_t>( self->m_index * SamplesPerBlock * 1000000 / self->m_clip.rate );
+        }
+        *flags = 0;
+        *size = self->m_buffer.size();
+        *buffer = self->m_buffer.data();
+        ++self->m_index;
+        return 0;
+    }
+
+    static void release( void*, const char*, size_t, void* )
+    {
+        // imem copies the buffer, which is reused for the next block
+    }
+
+private:
+    void fillVideo()
+    {
+        const auto w = m_clip.width;
+        const auto h = m_clip.height;
+        const auto frame = static_cast<unsigned int>( m_index );
+        const auto shift = ( frame * 7919 ) % m_noise.size();
+        auto y = m_buffer.data();
+        for ( unsigned int row = 0; row < h; ++row )
+        {
+            for ( unsigned int col = 0; col < w; ++col )
+            {
+                auto i = row * w + col;
+                y[i] = static_cast<uint8_t>( ( ( col + row + 2 * frame ) & 0xbf ) +
+                                             m_noise[( i + shift ) % m_noise.size()] );
+            }
+        }
+        auto u = y + w * h;
+        auto v = u + ( w / 2 ) * ( h / 2 );
+        for ( unsigned int row = 0; row < h / 2; ++row )
+        {
+            for ( unsigned int col = 0; col < w / 2; ++col )
+            {
+                u[row * ( w / 2 ) + col] = static_cast<uint8_t>( 64 + ( ( col + frame ) & 0x7f ) );
+                v[row * ( w / 2 ) + col] = static_cast<uint8_t>( 64 + ( ( row + frame ) & 0x7f ) );
+            }
+        }
+    }
+
+    void fillAudio()
+    {
+        const double pi = 3.14159265358979323846;
+        auto samples = reinterpret_cast<int16_t*>( m_buffer.data() );
+        auto first = m_index * SamplesPerBlock;
+        for ( unsigned int i = 0; i < SamplesPerBlock; ++i )
+        {
+            auto t = static_cast<double>( first + i ) / m_clip.rate;
+            for ( unsigned int c = 0; c < m_clip.channels; ++c )
+                samples[i * m_clip.channels + c] = static_cast<int16_t>(
+                            8000 * std::sin( 2 * pi * ( 220. * ( c + 1 ) ) * t ) );
+        }
+    }
+
+private:
+    static const unsigned int SamplesPerBlock = 1024;
+
+    const Clip& m_clip;
+    uint64_t m_index;
+    uint64_t m_count;
+    std::vector<uint8_t> m_buffer;
+    std::vector<uint8_t> m_noise;
+};
+
+template <typename T>
+std::string pointerOption( const char* name, T ptr )
+{
+    char buff[64];
+    snprintf( buff, sizeof( buff ), ":%s=%p", name, reinterpret_cast<void*>( ptr ) );
+    return buff;
+}
+
+int64_t fileSize( const std::string& path )
+{
+    std::ifstream f( path, std::ios::binary | std::ios::ate );
+    if ( f.is_open() == false )
+        return -1;
+    return static_cast<int64_t>( f.tellg() );
+}
+
+/**
+ * Plays the media until it ends, fails, or the timeout expires
+ */
+bool playToEnd( VLC::MediaPlayer& player, std::chrono::seconds timeout )
+{
+    std::promise<bool> promise;
+    std::atomic<bool> done( false );
+    auto complete = [&promise, &done]( bool res ) {
+        if ( done.exchange( true ) == false )
+            promise.set_value( res );
+    };
+    VLC::MediaPlayerEventManager em( player.eventManager() );
+    em.onEndReached( [&complete]() { complete( true ); } );
+    em.onEncounteredError( [&complete]() { complete( false ); } );
+    auto future = promise.get_future();
+    bool res = player.play() == 0 &&
+               future.wait_for( timeout ) == std::future_status::ready &&
+               future.get() == true;
+    // Waits for the muxer to be closed, and the handlers to be done
+    player.stop();
+    return res;
+}
+
+bool generate( VLC::Instance& instance, const Clip& clip, unsigned int durationS, const std::string& path )
+{
+    Generator generator( clip, durationS );
+    VLC::Media media( instance, "imem://", VLC::Media::FromLocation );
+    media.addOption( pointerOption( "imem-get", &Generator::get ) );
+    media.addOption( pointerOption( "imem-release", &Generator::release ) );
+    media.addOption( pointerOption( "imem-data", &generator ) );
+    std::string transcode;
+    if ( clip.isVideo() == true )
+    {
+        media.addOption( ":imem-cat=2" );
+        media.addOption( ":imem-codec=I420" );
+        media.addOption( ":imem-width=" + std::to_string( clip.width ) );
+        media.addOption( ":imem-height=" + std::to_string( clip.height ) );
+        media.addOption( ":imem-fps=" + std::to_string( clip.fps ) );
+        transcode = std::string( "vcodec=" ) + clip.vcodec;
+    }
+    else
+    {
+        media.addOption( ":imem-cat=1" );
+        media.addOption( ":imem-codec=s16l" );
+        media.addOption( ":imem-channels=" + std::to_string( clip.channels ) );
+        media.addOption( ":imem-samplerate=" + std::to_string( clip.rate ) );
+        transcode = std::string( "acodec=" ) + clip.acodec +
+                    ",channels=" + std::to_string( clip.channels ) +
+                    ",samplerate=" + std::to_string( clip.rate );
+    }
+    if ( clip.bitrate != 0 )
+        transcode += ( clip.isVideo() ? ",vb=" : ",ab=" ) + std::to_string( clip.bitrate );
+    media.addOption( ":sout=#transcode{" + transcode + "}:std{access=file,mux=" +
+                     clip.mux + ",dst=\"" + path + "\"}" );
+
+    VLC::MediaPlayer player( media );
+    return playToEnd( player, std::chrono::seconds( 600 ) ) == true && fileSize( path ) > 0;
+}
+
+/**
+ * What a single decoding run observed
+ */
+struct Run
+{
+    Run()
+        : wallUs( 0 )
+        , cpuUs( 0 )
+        , units( 0 )
+        , samples( 0 )
+        , rate( 0.f )
+        , success( false )
+    {
+    }
+
+    int64_t wallUs;
+    int64_t cpuUs;
+    // Pictures displayed, or audio buffers played
+    uint64_t units;
+    uint64_t samples;
+    float rate;
+    bool success;
+    // In µs
+    std::vector<int64_t> latencies;
+    std::vector<int64_t> intervals;
+};
+
+int64_t elapsedUs( Harness::Clock::time_point since )
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>( Harness::Clock::now() - since ).count();
+}
+
+/**
+ * Receives the decoded pictures in a small pool of I420 buffers
+ */
+class VideoSink
+{
+public:
+    VideoSink( Run& run )
+        : m_run( run )
+        , m_next( 0 )
+        , m_hasLast( false )
+    {
+    }
+
+    unsigned int format( char* chroma, unsigned int* width, unsigned int* height,
+                         unsigned int* pitches, unsigned int* lines )
+    {
+        memcpy( chroma, "I420", 4 );
+        pitches[0] = align( *width, 32 );
+        lines[0] = align( *height, 16 );
+        pitches[1] = pitches[2] = pitches[0] / 2;
+        lines[1] = lines[2] = lines[0] / 2;
+        for ( unsigned int i = 0; i < 3; ++i )
+            m_offsets[i] = i == 0 ? 0 : m_offsets[i - 1] + pitches[i - 1] * lines[i - 1];
+        auto size = m_offsets[2] + pitches[2] * lines[2];
+        for ( auto& b : m_buffers )
+            b.resize( size );
+        return NbBuffers;
+    }
+
+    void* lock( void** planes )
+    {
+        auto idx = m_next++ % NbBuffers;
+        for ( unsigned int i = 0; i < 3; ++i )
+            planes[i] = m_buffers[idx].data() + m_offsets[i];
+        m_lockTimes[idx] = Harness::Clock::now();
+        return reinterpret_cast<void*>( static_cast<uintptr_t>( idx ) );
+    }
+
+    void display( void* picture )
+    {
+        auto now = Harness::Clock::now();
+        auto idx = static_cast<unsigned int>( reinterpret_cast<uintptr_t>( picture ) );
+        m_run.latencies.push_back( std::chrono::duration_cast<std::chrono::microseconds>(
+                                       now - m_lockTimes[idx] ).count() );
+        if ( m_hasLast == true )
+            m_run.intervals.push_back( std::chrono::duration_cast<std::chrono::microseconds>(
+                                           now - m_last ).count() );
+        m_last = now;
+        m_hasLast = true;
+        ++m_run.units;
+    }
+
+private:
+    static unsigned int align( unsigned int v, unsigned int a )
+    {
+        return ( v + a - 1 ) / a * a;
+    }
+
+private:
+    static const unsigned int NbBuffers = 4;
+
+    Run& m_run;
+    std::vector<uint8_t> m_buffers[NbBuffers];
+    Harness::Clock::time_point m_lockTimes[NbBuffers];
+    unsigned int m_offsets[3];
+    unsigned int m_next;
+    Harness::Clock::time_point m_last;
+    bool m_hasLast;
+};
+
+// A rate of 0 lets DecodeSession pick its default
+Run decode( VLC::Instance& instance, const Clip& clip, const std::string& path, float rate )
+{
+    Run run;
+    // Declared before the session, which holds callbacks referencing them
+    VideoSink video( run );
+    Harness::Clock::time_point last;
+    bool hasLast = false;
+    VLC::Media media( instance, path, VLC::Media::FromPath );
+    VLC::DecodeSession session( instance, media );
+    session.setRate( rate );
+    if ( clip.isVideo() == true )
+    {
+        session.player().setVideoFormatCallbacks( [&video]( char* chroma, unsigned int* width, unsigned int* height,
+                                                            unsigned int* pitches, unsigned int* lines ) {
+            return video.format( chroma, width, height, pitches, lines );
+        }, nullptr );
+        session.setVideoSink( [&video]( void** planes ) {
+            return video.lock( planes );
+        }, []( void*, void*const* ) {
+        }, [&video]( void* picture ) {
+            video.display( picture );
+        });
+    }
+    else
+    {
+        // Keeps the decoder's rate & channels, avoiding any resampling
+        session.player().setAudioFormatCallbacks( []( char* format, unsigned int*, unsigned int* ) {
+            memcpy( format, "S16N", 4 );
+            return 0;
+        }, nullptr );
+        session.setAudioSink( [&run, &last, &hasLast]( const void*, unsigned int count, int64_t ) {
+            auto now = Harness::Clock::now();
+            if ( hasLast == true )
+                run.intervals.push_back( std::chrono::duration_cast<std::chrono::microseconds>(
+                                             now - last ).count() );
+            last = now;
+            hasLast = true;
+            ++run.units;
+            run.samples += count;
+        }, nullptr, nullptr, nullptr, nullptr );
+    }
+    run.rate = session.rate();
+    run.latencies.reserve( 1 << 14 );
+    run.intervals.reserve( 1 << 14 );
+
+    auto cpuStart = std::clock();
+    auto start = Harness::Clock::now();
+    auto completion = session.start();
+    run.success = completion.wait_for( std::chrono::seconds( 600 ) ) == std::future_status::ready &&
+                  completion.get() == true;
+    run.wallUs = elapsedUs( start );
+    // Joins the decoding threads before the results are read
+    session.cancel();
+    run.cpuUs = static_cast<int64_t>( ( std::clock() - cpuStart ) * 1000000. / CLOCKS_PER_SEC );
+    return run;
+}
+
+void addPercentiles( Benchmark::Record& r, const std::string& prefix, std::vector<int64_t>& values )
+{
+    if ( values.empty() == true )
+        return;
+    std::sort( begin( values ), end( values ) );
+    auto at = [&values]( double p ) {
+        return values[static_cast<size_t>( p * ( values.size() - 1 ) )];
+    };
+    r.add( prefix + "_p50", at( .5 ) )
+     .add( prefix + "_p90", at( .9 ) )
+     .add( prefix + "_p99", at( .99 ) )
+     .add( prefix + "_max", values.back() );
+}
+
+void benchClip( Harness& h, VLC::Instance& instance, const Clip& clip )
+{
+    const std::string name = std::string( "decode/" ) + clip.name;
+    if ( h.enabled( name ) == false )
+        return;
+    auto durationS = static_cast<unsigned int>( std::max( 1, atoi( h.option( "clip-duration-s", "10" ).c_str() ) ) );
+    auto workdir = h.option( "workdir", getenv( "TMPDIR" ) != nullptr ? getenv( "TMPDIR" ) : "/tmp" );
+    auto path = workdir + "/vlcpp_bench_" + clip.name + "_" + std::to_string( durationS ) + "s." + clip.extension;
+
+    if ( fileSize( path ) <= 0 || h.option( "regenerate" ) == "1" )
+    {
+        // Generated aside, so that an interrupted generation isn't reused
+        auto tmpPath = path + ".part";
+        auto start = Harness::Clock::now();
+        if ( generate( instance, clip, durationS, tmpPath ) == false )
+        {
+            std::remove( tmpPath.c_str() );
+            h.skip( name, "the clip couldn't be generated" );
+            return;
+        }
+        std::remove( path.c_str() );
+        std::rename( tmpPath.c_str(), path.c_str() );
+        auto r = h.record( name, "generate" );
+        r.add( "path", path )
+         .add( "size", fileSize( path ) )
+         .add( "ms", elapsedUs( start ) / 1000 );
+        h.emit( r );
+    }
+
+    const auto rate = static_cast<float>( atof( h.option( clip.isVideo() ? "video-rate" : "audio-rate",
+                                                          "0" ).c_str() ) );
+    std::vector<Run> runs;
+    for ( int i = 0; i < h.repetitions(); ++i )
+    {
+        auto run = decode( instance, clip, path, rate );
+        if ( run.success == false || run.units == 0 )
+        {
+            h.skip( name, "decoding failed, or produced nothing" );
+            return;
+        }
+        runs.push_back( std::move( run ) );
+    }
+    // Reports the median run, along with the latencies of all of them
+    std::sort( begin( runs ), end( runs ), []( const Run& a, const Run& b ) {
+        return a.wallUs < b.wallUs;
+    });
+    const auto& median = runs[runs.size() / 2];
+    std::vector<int64_t> latencies;
+    std::vector<int64_t> intervals;
+    for ( const auto& run : runs )
+    {
+        latencies.insert( end( latencies ), begin( run.latencies ), end( run.latencies ) );
+        intervals.insert( end( intervals ), begin( run.intervals ), end( run.intervals ) );
+    }
+    const double wallS = median.wallUs / 1e6;
+
+    auto r = h.record( name, "wrapper" );
+    r.add( "repetitions", static_cast<int>( runs.size() ) )
+     .add( "rate", static_cast<double>( median.rate ) )
+     .add( "duration_s", static_cast<int>( durationS ) )
+     .add( "wall_ms", median.wallUs / 1000 )
+     .add( "cpu_ms", median.cpuUs / 1000 )
+     .add( "realtime_factor", durationS / wallS )
+     .add( "cpu_ms_per_media_s", median.cpuUs / 1000. / durationS );
+    if ( clip.isVideo() == true )
+    {
+        r.add( "codec", clip.vcodec )
+         .add( "width", static_cast<int>( clip.width ) )
+         .add( "height", static_cast<int>( clip.height ) )
+         .add( "frames", median.units )
+         .add( "frames_per_s", median.units / wallS )
+         .add( "cpu_us_per_frame", static_cast<double>( median.cpuUs ) / median.units );
+        // Time between a picture buffer being locked for decoding, and
+        // being displayed
+        addPercentiles( r, "lock_to_display_us", latencies );
+        addPercentiles( r, "display_interval_us", intervals );
+    }
+    else
+    {
+        r.add( "codec", clip.acodec )
+         .add( "sample_rate", static_cast<int>( clip.rate ) )
+         .add( "channels", static_cast<int>( clip.channels ) )
+         .add( "buffers", median.units )
+         .add( "samples", median.samples )
+         .add( "samples_per_s", median.samples / wallS )
+         .add( "cpu_us_per_buffer", static_cast<double>( median.cpuUs ) / median.units );
+        addPercentiles( r, "play_interval_us", intervals );
+    }
+    h.emit( r );
+}
+
+} // anonymous namespace
+
+int main( int argc, char** argv )
+{
+    Harness h( "decode_throughput", argc, argv );
+    h.setContext( "libvlc", libvlc_get_version() );
+    const char* args[] = { "--quiet", "--no-video-title-show" };
+    VLC::Instance instance( 2, args );
+
+    for ( const auto& clip : Clips )
+        benchClip( h, instance, clip );
+    return 0;
+}
@@ -0,0 +1,360 @@
+/*****************************************************************************
+ * harness.hpp: Minimal benchmark harness, reporting JSON lines
+ *****************************************************************************
+ * Copyright © 2015 libvlcpp authors & VideoLAN
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_CXX_BENCHMARK_HARNESS_H
+#define LIBVLC_CXX_BENCHMARK_HARNESS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Benchmark
+{
+
+/**
+ * Prevents the compiler from optimizing away the computation of value
+ */
+template <typename T>
+inline void doNotOptimize( const T& value )
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile( "" : : "r,m"( value ) : "memory" );
+#else
+    static const void* volatile sink;
+    sink = &value;
+#endif
+}
+
+/**
+ * @brief A single JSON object, written on its own line
+ *
+ * Only flat objects are supported, which is all the results need, and keeps
+ * them trivial to consume with jq or a few lines of python.
+ */
+class Record
+{
+public:
+    Record& add( const std::string& key, const std::string& value )
+    {
+        appendKey( key );
+        appendString( value );
+        return *this;
+    }
+
+    Record& add( const std::string& key, const char* value )
+    {
+        return add( key, std::string( value != nullptr ? value : "" ) );
+    }
+
+    Record& add( const std::string& key, double value )
+    {
+        appendKey( key );
+        std::ostringstream oss;
+        oss.precision( 6 );
+        oss << std::fixed << value;
+        m_body += oss.str();
+        return *this;
+    }
+
+    Record& add( const std::string& key, int64_t value )
+    {
+        appendKey( key );
+        m_body += std::to_string( value );
+        return *this;
+    }
+
+    Record& add( const std::string& key, uint64_t value )
+    {
+        appendKey( key );
+        m_body += std::to_string( value );
+        return *this;
+    }
+
+    Record& add( const std::string& key, int value )
+    {
+        return add( key, static_cast<int64_t>( value ) );
+    }
+
+    Record& add( const std::string& key, bool value )
+    {
+        appendKey( key );
+        m_body += value ? "true" : "false";
+        return *this;
+    }
+
+    std::string str() const
+    {
+        return "{" + m_body + "}";
+    }
+
+private:
+    void appendKey( const std::string& key )
+    {
+        if ( m_body.empty() == false )
+            m_body += ",";
+        appendString( key );
+        m_body += ":";
+    }
+
+    void appendString( const std::string& value )
+    {
+        m_body += '"';
+        for ( auto c : value )
+        {
+            switch ( c )
+            {
+            case '"':
+                m_body += "\\\"";
+                break;
+            case '\\':
+                m_body += "\\\\";
+                break;
+            case '\n':
+                m_body += "\\n";
+                break;
+            case '\t':
+                m_body += "\\t";
+                break;
+            default:
+                if ( static_cast<unsigned char>( c ) < 0x20 )
+                {
+                    char buff[8];
+                    snprintf( buff, sizeof( buff ), "\\u%04x", c );
+                    m_body += buff;
+                }
+                else
+                    m_body += c;
+                break;
+            }
+        }
+        m_body += '"';
+    }
+
+private:
+    std::string m_body;
+};
+
+/**
+ * @brief Runs benchmarks, and prints their results as JSON lines on stdout
+ *
+ * Each benchmark is a function running its operation N times. The harness
+ * doubles N until a run lasts at least the minimum time, then measures a
+ * few repetitions of that run and reports the median and minimal time per
+ * operation.
+ *
+ * Supported command line options:
+ *  --filter=<substring>    Only run the benchmarks whose name contains it
+ *  --min-time-ms=<ms>      Minimum duration of a repetition (default: 200)
+ *  --repetitions=<n>       Number of measured repetitions (default: 5)
+ *  --list                  Print the benchmark names and exit
+ *
+ * Unknown options are left for the benchmark program to interpret.
+ */
+class Harness
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    Harness( const std::string& suite, int argc, char** argv )
+        : m_suite( suite )
+        , m_minTime( std::chrono::milliseconds( 200 ) )
+        , m_repetitions( 5 )
+        , m_list( false )
+    {
+        for ( int i = 1; i < argc; ++i )
+        {
+            std::string arg = argv[i];
+            if ( startsWith( arg, "--filter=" ) )
+                m_filter = value( arg );
+            else if ( startsWith( arg, "--min-time-ms=" ) )
+                m_minTime = std::chrono::milliseconds( atoi( value( arg ).c_str() ) );
+            else if ( startsWith( arg, "--repetitions=" ) )
+                m_repetitions = std::max( 1, atoi( value( arg ).c_str() ) );
+            else if ( arg == "--list" )
+                m_list = true;
+            else
+                m_args.push_back( arg );
+        }
+    }
+
+    /**
+     * Adds a key to all the records, ie. the libvlc version
+     */
+    void setContext( const std::string& key, const std::string& value )
+    {
+        m_context.emplace_back( key, value );
+    }
+
+    /**
+     * Returns the value of a --key=value option which wasn't handled by the
+     * harness, or def if it wasn't provided.
+     */
+    std::string option( const std::string& key, const std::string& def = {} ) const
+    {
+        auto prefix = "--" + key + "=";
+        for ( const auto& a : m_args )
+        {
+            if ( startsWith( a, prefix ) )
+                return value( a );
+        }
+        return def;
+    }
+
+    /**
+     * The number of measured repetitions, for benchmarks running their own
+     * measurements.
+     */
+    int repetitions() const
+    {
+        return m_repetitions;
+    }
+
+    /**
+     * Returns true if the benchmark should run, printing its name instead
+     * when --list was provided.
+     */
+    bool enabled( const std::string& name ) const
+    {
+        if ( m_filter.empty() == false && name.find( m_filter ) == std::string::npos )
+            return false;
+        if ( m_list )
+        {
+            // Benchmarks have several variants, only list them once
+            if ( m_listed.insert( name ).second == true )
+                std::cout << name << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Measures a benchmark
+     *
+     * \param name      The benchmark name, shared by all its variants
+     * \param variant   Identifies the implementation, ie. "wrapper" or "raw"
+     * \param func      A callable taking the number of operations to run
+     */
+    template <typename Func>
+    void run( const std::string& name, const std::string& variant, Func&& func )
+    {
+        if ( enabled( name ) == false )
+            return;
+        uint64_t iterations = 1;
+        while ( true )
+        {
+            auto d = measure( func, iterations );
+            if ( d >= m_minTime || iterations >= ( uint64_t{ 1 } << 40 ) )
+                break;
+            // Aim slightly above the minimum time, rather than doubling blindly
+            auto ratio = d.count() > 0 ? static_cast<double>( m_minTime.count() ) / d.count() : 10.;
+            iterations = static_cast<uint64_t>( iterations * std::min( 10., std::max( 2., ratio * 1.2 ) ) );
+        }
+        std::vector<double> nsPerOp;
+        for ( int i = 0; i < m_repetitions; ++i )
+        {
+            auto d = measure( func, iterations );
+            nsPerOp.push_back( static_cast<double>( d.count() ) / iterations );
+        }
+        std::sort( begin( nsPerOp ), end( nsPerOp ) );
+        auto r = record( name, variant );
+        r.add( "iterations", iterations )
+         .add( "repetitions", m_repetitions )
+         .add( "ns_per_op", nsPerOp[nsPerOp.size() / 2] )
+         .add( "ns_per_op_min", nsPerOp.front() )
+         .add( "ns_per_op_max", nsPerOp.back() );
+        emit( r );
+    }
+
+    /**
+     * Returns a record prefilled with the suite, benchmark and context keys,
+     * for benchmarks reporting their own metrics.
+     */
+    Record record( const std::string& name, const std::string& variant ) const
+    {
+        Record r;
+        r.add( "suite", m_suite )
+         .add( "benchmark", name )
+         .add( "variant", variant );
+        for ( const auto& c : m_context )
+            r.add( c.first, c.second );
+        return r;
+    }
+
+    void emit( const Record& r ) const
+    {
+        std::cout << r.str() << std::endl;
+    }
+
+    /**
+     * Reports a benchmark which couldn't run
+     */
+    void skip( const std::string& name, const std::string& reason ) const
+    {
+        if ( enabled( name ) == false )
+            return;
+        auto r = record( name, "skipped" );
+        r.add( "reason", reason );
+        emit( r );
+    }
+
+private:
+    template <typename Func>
+    static std::chrono::nanoseconds measure( Func& func, uint64_t iterations )
+    {
+        auto start = Clock::now();
+        func( iterations );
+        return std::chrono::duration_cast<std::chrono::nanoseconds>( Clock::now() - start );
+    }
+
+    static bool startsWith( const std::string& str, const std::string& prefix )
+    {
+        return str.compare( 0, prefix.size(), prefix ) == 0;
+    }
+
+    static std::string value( const std::string& arg )
+    {
+        return arg.substr( arg.find( '=' ) + 1 );
+    }
+
+private:
+    std::string m_suite;
+    std::string m_filter;
+    std::chrono::nanoseconds m_minTime;
+    int m_repetitions;
+    bool m_list;
+    mutable std::set<std::string> m_listed;
+    std::vector<std::string> m_args;
+    std::vector<std::pair<std::string, std::string>> m_context;
+};
+
+} // namespace Benchmark
+
+#endif
@@ -0,0 +1,319 @@
+/*****************************************************************************
+ * mock_streams.cpp: Event & callback streams, driven by the mock libvlc
+ *****************************************************************************
+ * Copyright © 2015 libvlcpp authors & VideoLAN
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Measures EventManager and the MediaPlayer callbacks under synthetic
+ * streams, and stresses handler registration while events are flowing.
+ * This only builds against the mock libvlc (see test/mock), which makes the
+ * results independent from codecs, files and the machine's outputs.
+ *
+ * usage: vlcpp_bench_mock_streams [--threads=<n>] [--stress-duration-ms=<ms>]
+ *                                 [harness options]
+ *
+ * The last record reports the mock objects still alive, which should all be
+ * 0 once the wrappers are gone.
+ */
+
+#include "vlcpp/vlc.hpp"
+#include "test/mock/vlcmock.h"
+#include "harness.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using Benchmark::doNotOptimize;
+using Benchmark::Harness;
+
+namespace
+{
+
+// A stream made of a single kind of item, one per ms of stream time, so that
+// n items last n ms
+vlcmock_stream_config_t streamConfig( bool video, bool audio, uint64_t n )
+{
+    vlcmock_stream_config_t cfg;
+    vlcmock_stream_config_init( &cfg );
+    cfg.video_fps = video ? 1000. : 0.;
+    cfg.audio_rate = audio ? 48000 : 0;
+    cfg.audio_samples_per_buffer = 48;
+    cfg.time_changed_rate = 0.;
+    cfg.duration = static_cast<int64_t>( n );
+    return cfg;
+}
+
+void playToEnd( libvlc_media_player_t* mp, const vlcmock_stream_config_t& cfg )
+{
+    vlcmock_media_player_set_stream_config( mp, &cfg );
+    libvlc_media_player_play( mp );
+    vlcmock_media_player_wait( mp, -1 );
+    libvlc_media_player_stop( mp );
+}
+
+void benchEventEmit( Harness& h, VLC::Instance& instance )
+{
+    const std::string name = "event_emit/time_changed";
+    VLC::MediaPlayer player( instance );
+    auto em = libvlc_media_player_event_manager( player );
+    std::atomic<int64_t> total( 0 );
+    {
+        VLC::MediaPlayerEventManager wrapped( player.eventManager() );
+        wrapped.onTimeChanged( [&total]( libvlc_time_t t ) {
+            total.fetch_add( t, std::memory_order_relaxed );
+        });
+        h.run( name, "wrapper", [&]( uint64_t n ) {
+            vlcmock_event_emit( em, libvlc_MediaPlayerTimeChanged, nullptr, static_cast<unsigned>( n ) );
+        });
+    }
+    {
+        auto cb = []( const libvlc_event_t* e, void* data ) {
+            static_cast<std::atomic<int64_t>*>( data )->fetch_add(
+                        e->u.media_player_time_changed.new_time, std::memory_order_relaxed );
+        };
+        libvlc_event_attach( em, libvlc_MediaPlayerTimeChanged, cb, &total );
+        h.run( name, "raw", [&]( uint64_t n ) {
+            vlcmock_event_emit( em, libvlc_MediaPlayerTimeChanged, nullptr, static_cast<unsigned>( n ) );
+        });
+        libvlc_event_detach( em, libvlc_MediaPlayerTimeChanged, cb, &total );
+    }
+    doNotOptimize( total );
+}
+
+// Wraps the event's media in a MediaPtr, hence an allocation per event
+void benchListEvents( Harness& h, VLC::Instance& instance )
+{
+    const std::string name = "event_emit/media_list_item_added";
+    VLC::MediaList list( instance );
+    VLC::Media media( instance, "mock://item", VLC::Media::FromLocation );
+    auto em = libvlc_media_list_event_manager( list );
+    std::atomic<uint64_t> count( 0 );
+    {
+        VLC::MediaListEventManager wrapped( list.eventManager() );
+        wrapped.onItemAdded( [&count]( VLC::MediaPtr m, int ) {
+            if ( m != nullptr )
+                count.fetch_add( 1, std::memory_order_relaxed );
+        });
+        h.run( name, "wrapper", [&]( uint64_t n ) {
+            vlcmock_event_emit( em, libvlc_MediaListItemAdded, media, static_cast<unsigned>( n ) );
+        });
+    }
+    {
+        auto cb = []( const libvlc_event_t* e, void* data ) {
+            if ( e->u.media_list_item_added.item != nullptr )
+                static_cast<std::atomic<uint64_t>*>( data )->fetch_add( 1, std::memory_order_relaxed );
+        };
+        libvlc_event_attach( em, libvlc_MediaListItemAdded, cb, &count );
+        h.run( name, "raw", [&]( uint64_t n ) {
+            vlcmock_event_emit( em, libvlc_MediaListItemAdded, media, static_cast<unsigned>( n ) );
+        });
+        libvlc_event_detach( em, libvlc_MediaListItemAdded, cb, &count );
+    }
+    doNotOptimize( count );
+}
+
+struct RawVideo
+{
+    uint8_t buffer[16];
+    uint64_t frames;
+};
+
+void benchVideoStream( Harness& h, VLC::Instance& instance )
+{
+    const std::string name = "stream/video_frames";
+    VLC::Media media( instance, "mock://video", VLC::Media::FromLocation );
+    {
+        VLC::MediaPlayer player( media );
+        uint8_t buffer[16];
+        uint64_t frames = 0;
+        player.setVideoFormat( "RV32", 2, 2, 8 );
+        player.setVideoCallbacks( [&buffer]( void** planes ) -> void* {
+            planes[0] = buffer;
+            return nullptr;
+        }, []( void*, void*const* ) {
+        }, [&frames]( void* ) {
+            ++frames;
+        });
+        h.run( name, "wrapper", [&]( uint64_t n ) {
+            playToEnd( player, streamConfig( true, false, n ) );
+        });
+        doNotOptimize( frames );
+    }
+    {
+        auto mp = libvlc_media_player_new_from_media( media );
+        RawVideo video{};
+        libvlc_video_set_format( mp, "RV32", 2, 2, 8 );
+        libvlc_video_set_callbacks( mp, []( void* opaque, void** planes ) -> void* {
+            planes[0] = static_cast<RawVideo*>( opaque )->buffer;
+            return nullptr;
+        }, []( void*, void*, void*const* ) {
+        }, []( void* opaque, void* ) {
+            ++static_cast<RawVideo*>( opaque )->frames;
+        }, &video );
+        h.run( name, "raw", [&]( uint64_t n ) {
+            playToEnd( mp, streamConfig( true, false, n ) );
+        });
+        doNotOptimize( video.frames );
+        libvlc_media_player_release( mp );
+    }
+}
+
+void benchAudioStream( Harness& h, VLC::Instance& instance )
+{
+    const std::string name = "stream/audio_buffers";
+    VLC::Media media( instance, "mock://audio", VLC::Media::FromLocation );
+    {
+        VLC::MediaPlayer player( media );
+        uint64_t samples = 0;
+        player.setAudioFormat( "S16N", 48000, 2 );
+        player.setAudioCallbacks( [&samples]( const void*, unsigned int count, int64_t ) {
+            samples += count;
+        }, nullptr, nullptr, nullptr, nullptr );
+        h.run( name, "wrapper", [&]( uint64_t n ) {
+            playToEnd( player, streamConfig( false, true, n ) );
+        });
+        doNotOptimize( samples );
+    }
+    {
+        auto mp = libvlc_media_player_new_from_media( media );
+        uint64_t samples = 0;
+        libvlc_audio_set_format( mp, "S16N", 48000, 2 );
+        libvlc_audio_set_callbacks( mp, []( void* data, const void*, unsigned count, int64_t ) {
+            *static_cast<uint64_t*>( data ) += count;
+        }, nullptr, nullptr, nullptr, nullptr, &samples );
+        h.run( name, "raw", [&]( uint64_t n ) {
+            playToEnd( mp, streamConfig( false, true, n ) );
+        });
+        doNotOptimize( samples );
+        libvlc_media_player_release( mp );
+    }
+}
+
+/*
+ * Threads register & unregister handlers through their own event manager
+ * copies, while the player thread fires TimeChanged & PositionChanged events
+ * at a high rate. This is meant to be run under ASAN/TSAN: the record only
+ * reports the volume of work done, and the listeners left behind.
+ */
+void stressRegistration( Harness& h, VLC::Instance& instance )
+{
+    const std::string name = "stress/event_registration";
+    if ( h.enabled( name ) == false )
+        return;
+    auto nbThreads = std::max( 1, atoi( h.option( "threads", "4" ).c_str() ) );
+    auto duration = std::max( 1, atoi( h.option( "stress-duration-ms", "2000" ).c_str() ) );
+
+    vlcmock_stats_t before;
+    vlcmock_get_stats( &before );
+
+    VLC::Media media( instance, "mock://stress", VLC::Media::FromLocation );
+    VLC::MediaPlayer player( media );
+    auto cfg = streamConfig( false, false, 0 );
+    cfg.time_changed_rate = 20000.;
+    cfg.duration = duration;
+    cfg.paced = 1;
+    vlcmock_media_player_set_stream_config( player, &cfg );
+
+    std::atomic<bool> done( false );
+    std::atomic<uint64_t> registrations( 0 );
+    std::atomic<uint64_t> delivered( 0 );
+    auto start = Harness::Clock::now();
+    {
+        // Copied from this thread, since eventManager() lazily creates the
+        // player's own event manager
+        std::vector<VLC::MediaPlayerEventManager> managers( nbThreads, player.eventManager() );
+        std::vector<std::thread> threads;
+        for ( auto& em : managers )
+        {
+            threads.emplace_back( [&em, &done, &registrations, &delivered]() {
+                while ( done == false )
+                {
+                    auto time = em.onTimeChanged( [&delivered]( libvlc_time_t ) {
+                        delivered.fetch_add( 1, std::memory_order_relaxed );
+                    });
+                    auto position = em.onPositionChanged( [&delivered]( float ) {
+                        delivered.fetch_add( 1, std::memory_order_relaxed );
+                    });
+                    em.unregister( time, position );
+                    registrations.fetch_add( 1, std::memory_order_relaxed );
+                }
+                // Left registered, to check they are released along with
+                // the event manager
+                em.onTimeChanged( []( libvlc_time_t ) {} );
+            });
+        }
+        player.play();
+        vlcmock_media_player_wait( player, -1 );
+        done = true;
+        for ( auto& t : threads )
+            t.join();
+        player.stop();
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>( Harness::Clock::now() - start );
+
+    vlcmock_stats_t after;
+    vlcmock_get_stats( &after );
+    auto r = h.record( name, "wrapper" );
+    r.add( "threads", nbThreads )
+     .add( "duration_ms", static_cast<int64_t>( elapsed.count() ) )
+     .add( "registrations", registrations.load() )
+     .add( "events_sent", after.events_sent - before.events_sent )
+     .add( "events_delivered", delivered.load() )
+     .add( "listeners_leaked", after.listeners - before.listeners );
+    h.emit( r );
+}
+
+void reportLeaks( Harness& h )
+{
+    const std::string name = "mock/leaks";
+    if ( h.enabled( name ) == false )
+        return;
+    vlcmock_stats_t s;
+    vlcmock_get_stats( &s );
+    auto r = h.record( name, "mock" );
+    r.add( "instances", s.instances )
+     .add( "medias", s.medias )
+     .add( "media_lists", s.media_lists )
+     .add( "media_players", s.media_players )
+     .add( "listeners", s.listeners )
+     .add( "events_sent", s.events_sent )
+     .add( "video_frames", s.video_frames )
+     .add( "audio_samples", s.audio_samples );
+    h.emit( r );
+}
+
+} // anonymous namespace
+
+int main( int argc, char** argv )
+{
+    Harness h( "mock_streams", argc, argv );
+    h.setContext( "libvlc", libvlc_get_version() );
+    {
+        VLC::Instance instance( 0, nullptr );
+        benchEventEmit( h, instance );
+        benchListEvents( h, instance );
+        benchVideoStream( h, instance );
+        benchAudioStream( h, instance );
+        stressRegistration( h, instance );
+    }
+    reportLeaks( h );
+    return 0;
+}
@@ -0,0 +1,426 @@
+/*****************************************************************************
+ * wrapper_overhead.cpp: Compares libvlcpp hot paths to the raw libvlc API
+ *****************************************************************************
+ * Copyright © 2015 libvlcpp authors & VideoLAN
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Every benchmark comes in a "wrapper" variant, going through libvlcpp, and a
+ * "raw" variant doing the same work with the C API. Both variants perform
+ * the same libvlc calls, so the difference is the wrapper's overhead.
+ *
+ * usage: vlcpp_bench_overhead [--media=<file>] [--threads=<n>] [harness options]
+ *
+ * The tracks benchmark needs a local media file, the others are self
+ * contained. The *_mt benchmarks run their loop on --threads threads (4 by
+ * default) at once, and report the time per iteration of each thread: on a
+ * machine with that many cores, it matches the single threaded time unless
+ * the threads contend. See harness.hpp for the common options.
+ */
+
+#include "vlcpp/vlc.hpp"
+#include "harness.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using Benchmark::doNotOptimize;
+using Benchmark::Harness;
+
+namespace
+{
+
+// Runs func( n ) on nbThreads threads at once, and waits for them
+template <typename Func>
+void runThreads( int nbThreads, uint64_t n, Func&& func )
+{
+    std::vector<std::thread> threads;
+    for ( auto i = 0; i < nbThreads; ++i )
+        threads.emplace_back( [&func, n]() { func( n ); } );
+    for ( auto& t : threads )
+        t.join();
+}
+
+// Adds and removes an item, which synchronously fires ItemAdded and
+// ItemDeleted events. The raw API is used in all variants, so that only the
+// event handlers differ.
+void addRemove( libvlc_media_list_t* list, libvlc_media_t* media, uint64_t n )
+{
+    libvlc_media_list_lock( list );
+    for ( uint64_t i = 0; i < n; ++i )
+    {
+        libvlc_media_list_add_media( list, media );
+        libvlc_media_list_remove_index( list, 0 );
+    }
+    libvlc_media_list_unlock( list );
+}
+
+void benchEventDispatch( Harness& h, VLC::Instance& instance )
+{
+    const std::string name = "event_dispatch/media_list_item_added";
+    VLC::Media media( instance, "bench://item", VLC::Media::FromLocation );
+    std::atomic<uint64_t> count( 0 );
+    {
+        VLC::MediaList list( instance );
+        h.run( name, "no_handler", [&]( uint64_t n ) {
+            addRemove( list, media, n );
+        });
+    }
+    {
+        VLC::MediaList list( instance );
+        list.eventManager().onItemAdded( [&count]( VLC::MediaPtr m, int idx ) {
+            if ( m != nullptr && idx >= 0 )
+                count.fetch_add( 1, std::memory_order_relaxed );
+        });
+        h.run( name, "wrapper", [&]( uint64_t n ) {
+            addRemove( list, media, n );
+        });
+    }
+    {
+        VLC::MediaList list( instance );
+        auto em = libvlc_media_list_event_manager( list );
+        auto cb = []( const libvlc_event_t* e, void* data ) {
+            if ( e->u.media_list_item_added.item != nullptr && e->u.media_list_item_added.index >= 0 )
+                static_cast<std::atomic<uint64_t>*>( data )->fetch_add( 1, std::memory_order_relaxed );
+        };
+        libvlc_event_attach( em, libvlc_MediaListItemAdded, cb, &count );
+        h.run( name, "raw", [&]( uint64_t n ) {
+            addRemove( list, media, n );
+        });
+        libvlc_event_detach( em, libvlc_MediaListItemAdded, cb, &count );
+    }
+    doNotOptimize( count );
+}
+
+void benchMetaChanged( Harness& h, VLC::Instance& instance )
+{
+    const std::string name = "event_dispatch/media_meta_changed";
+    std::atomic<uint64_t> count( 0 );
+    {
+        VLC::Media media( instance, "bench://meta", VLC::Media::FromLocation );
+        media.eventManager().onMetaChanged( [&count]( libvlc_meta_t ) {
+            count.fetch_add( 1, std::memory_order_relaxed );
+        });
+        h.run( name, "wrapper", [&]( uint64_t n ) {
+            for ( uint64_t i = 0; i < n; ++i )
+                libvlc_media_set_meta( media, libvlc_meta_Title, "title" );
+        });
+    }
+    {
+        auto media = libvlc_media_new_location( instance, "bench://meta" );
+        auto em = libvlc_media_event_manager( media );
+        auto cb = []( const libvlc_event_t*, void* data ) {
+            static_cast<std::atomic<uint64_t>*>( data )->fetch_add( 1, std::memory_order_relaxed );
+        };
+        libvlc_event_attach( em, libvlc_MediaMetaChanged, cb, &count );
+        h.run( name, "raw", [&]( uint64_t n ) {
+            for ( uint64_t i = 0; i < n; ++i )
+                libvlc_media_set_meta( media, libvlc_meta_Title, "title" );
+        });
+        libvlc_event_detach( em, libvlc_MediaMetaChanged, cb, &count );
+        libvlc_media_release( media );
+    }
+    doNotOptimize( count );
+}
+
+void benchHandleRegistration( Harness& h, VLC::Instance& instance )
+{
+    const std::string name = "event_handle/register_unregister";
+    VLC::Media media( instance, "bench://handle", VLC::Media::FromLocation );
+    auto& em = media.eventManager();
+    h.run( name, "wrapper", [&]( uint64_t n ) {
+        for ( uint64_t i = 0; i < n; ++i )
+        {
+            auto handler = em.onMetaChanged( []( libvlc_meta_t ) {} );
+            em.unregister( handler );
+        }
+    });
+    auto rawEm = libvlc_media_event_manager( media );
+    auto cb = []( const libvlc_event_t*, void* ) {};
+    h.run( name, "raw", [&]( uint64_t n ) {
+        for ( uint64_t i = 0; i < n; ++i )
+        {
+            libvlc_event_attach( rawEm, libvlc_MediaMetaChanged, cb, nullptr );
+            libvlc_event_detach( rawEm, libvlc_MediaMetaChanged, cb, nullptr );
+        }
+    });
+}
+
+// Exposes the callbacks block, which MediaPlayer keeps private
+struct CallbackOwner : public VLC::EventOwner<2>
+{
+    CallbackOwner()
+        : EventOwner<2>( std::make_shared<Callbacks>() )
+    {
+    }
+};
+
+void* rawLock( void* opaque, void** planes )
+{
+    planes[0] = opaque;
+    return nullptr;
+}
+
+void rawPlay( void* opaque, const void* samples, unsigned int count, int64_t pts )
+{
+    auto total = static_cast<uint64_t*>( opaque );
+    *total += count + ( samples != nullptr ) + ( pts & 1 );
+}
+
+void benchTrampolines( Harness& h )
+{
+    CallbackOwner owner;
+    uint8_t buffer[16];
+    void* planes[1];
+    uint64_t total = 0;
+
+    auto lock = [&buffer]( void** p ) -> void* {
+        p[0] = buffer;
+        return nullptr;
+    };
+    auto play = [&total]( const void* samples, unsigned int count, int64_t pts ) {
+        total += count + ( samples != nullptr ) + ( pts & 1 );
+    };
+    // Called through volatile pointers, as libvlc would, so the calls can't be inlined
+    libvlc_video_lock_cb volatile wrappedLock =
+            VLC::CallbackWrapper<0, decltype(lock), libvlc_video_lock_cb>::wrap( &owner, std::move( lock ) );
+    libvlc_audio_play_cb volatile wrappedPlay =
+            VLC::CallbackWrapper<1, decltype(play), libvlc_audio_play_cb>::wrap( &owner, std::move( play ) );
+    libvlc_video_lock_cb volatile directLock = &rawLock;
+    libvlc_audio_play_cb volatile directPlay = &rawPlay;
+    void* opaque = owner.callbacks.get();
+
+    h.run( "callback_trampoline/video_lock", "wrapper", [&]( uint64_t n ) {
+        for ( uint64_t i = 0; i < n; ++i )
+            doNotOptimize( wrappedLock( opaque, planes ) );
+    });
+    h.run( "callback_trampoline/video_lock", "raw", [&]( uint64_t n ) {
+        for ( uint64_t i = 0; i < n; ++i )
+            doNotOptimize( directLock( buffer, planes ) );
+    });
+    h.run( "callback_trampoline/audio_play", "wrapper", [&]( uint64_t n ) {
+        for ( uint64_t i = 0; i < n; ++i )
+            wrappedPlay( opaque, buffer, 1024, static_cast<int64_t>( i ) );
+    });
+    h.run( "callback_trampoline/audio_play", "raw", [&]( uint64_t n ) {
+        for ( uint64_t i = 0; i < n; ++i )
+            directPlay( &total, buffer, 1024, static_cast<int64_t>( i ) );
+    });
+    doNotOptimize( total );
+}
+
+void benchItemAtIndex( Harness& h, VLC::Instance& instance )
+{
+    const std::string name = "media_list/item_at_index";
+    const int nbItems = 1000;
+    VLC::MediaList list( instance );
+    list.lock();
+    for ( int i = 0; i < nbItems; ++i )
+    {
+        VLC::Media media( instance, "bench://item/" + std::to_string( i ), VLC::Media::FromLocation );
+        list.addMedia( media );
+    }
+    list.unlock();
+
+    h.run( name, "wrapper", [&]( uint64_t n ) {
+        list.lock();
+        for ( uint64_t i = 0; i < n; ++i )
+            doNotOptimize( list.itemAtIndex( static_cast<int>( i % nbItems ) ) );
+        list.unlock();
+    });
+    h.run( name, "wrapper_view", [&]( uint64_t n ) {
+        auto view = list.lockedView();
+        uint64_t i = 0;
+        while ( i < n )
+        {
+            for ( const auto& m : view )
+            {
+                doNotOptimize( m.get() );
+                if ( ++i == n )
+                    break;
+            }
+        }
+    });
+    h.run( name, "raw", [&]( uint64_t n ) {
+        libvlc_media_list_lock( list );
+        for ( uint64_t i = 0; i < n; ++i )
+        {
+            auto m = libvlc_media_list_item_at_index( list, static_cast<int>( i % nbItems ) );
+            doNotOptimize( m );
+            libvlc_media_release( m );
+        }
+        libvlc_media_list_unlock( list );
+    });
+}
+
+void benchMeta( Harness& h, VLC::Instance& instance )
+{
+    const std::string name = "media/meta";
+    VLC::Media media( instance, "bench://meta", VLC::Media::FromLocation );
+    media.setMeta( libvlc_meta_Title, "A reasonably long title, as found in actual files" );
+
+    h.run( name, "wrapper", [&]( uint64_t n ) {
+        for ( uint64_t i = 0; i < n; ++i )
+            doNotOptimize( media.meta( libvlc_meta_Title ) );
+    });
+    h.run( name, "wrapper_vlcstring", [&]( uint64_t n ) {
+        for ( uint64_t i = 0; i < n; ++i )
+            doNotOptimize( media.metaView( libvlc_meta_Title ).size() );
+    });
+    h.run( name, "raw", [&]( uint64_t n ) {
+        for ( uint64_t i = 0; i < n; ++i )
+        {
+            auto str = libvlc_media_get_meta( media, libvlc_meta_Title );
+            doNotOptimize( str );
+            libvlc_free( str );
+        }
+    });
+}
+
+void benchTracks( Harness& h, VLC::Instance& instance )
+{
+    const std::string name = "media/tracks";
+    auto path = h.option( "media" );
+    if ( path.empty() == true )
+    {
+        h.skip( name, "no --media=<file> provided" );
+        return;
+    }
+    VLC::Media media( instance, path, VLC::Media::FromPath );
+    media.parse();
+
+    h.run( name, "wrapper", [&]( uint64_t n ) {
+        for ( uint64_t i = 0; i < n; ++i )
+            doNotOptimize( media.tracks() );
+    });
+    h.run( name, "raw", [&]( uint64_t n ) {
+        for ( uint64_t i = 0; i < n; ++i )
+        {
+            libvlc_media_track_t** tracks;
+            auto nbTracks = libvlc_media_tracks_get( media, &tracks );
+            doNotOptimize( tracks );
+            libvlc_media_tracks_release( tracks, nbTracks );
+        }
+    });
+}
+
+// The conversions are measured on synthetic libvlc structures, since they
+// don't depend on how libvlc fetched them.
+void benchTrackConversions( Harness& h )
+{
+    libvlc_audio_track_t audio{};
+    audio.i_channels = 2;
+    audio.i_rate = 48000;
+    libvlc_video_track_t video{};
+    video.i_width = 1920;
+    video.i_height = 1080;
+    libvlc_subtitle_track_t subtitle{};
+    subtitle.psz_encoding = const_cast<char*>( "UTF-8" );
+
+    std::vector<libvlc_media_track_t> tracks( 3 );
+    for ( auto& t : tracks )
+        t.psz_language = const_cast<char*>( "eng" );
+    tracks[0].i_type = libvlc_track_video;
+    tracks[0].video = &video;
+    tracks[1].i_type = libvlc_track_audio;
+    tracks[1].audio = &audio;
+    tracks[1].psz_description = const_cast<char*>( "Stereo commentary" );
+    tracks[2].i_type = libvlc_track_text;
+    tracks[2].subtitle = &subtitle;
+
+    auto wrapper = [&tracks]( uint64_t n ) {
+        std::vector<VLC::MediaTrack> res;
+        for ( uint64_t i = 0; i < n; ++i )
+        {
+            res.clear();
+            for ( auto& t : tracks )
+                res.emplace_back( &t );
+            doNotOptimize( res );
+        }
+    };
+    auto raw = [&tracks]( uint64_t n ) {
+        for ( uint64_t i = 0; i < n; ++i )
+        {
+            for ( auto& t : tracks )
+            {
+                doNotOptimize( t.i_codec );
+                doNotOptimize( t.psz_language );
+            }
+        }
+    };
+    h.run( "media_track/conversion", "wrapper", wrapper );
+    h.run( "media_track/conversion", "raw", raw );
+
+    auto nbThreads = std::max( 1, atoi( h.option( "threads", "4" ).c_str() ) );
+    h.run( "media_track/conversion_mt", "wrapper", [&]( uint64_t n ) {
+        runThreads( nbThreads, n, wrapper );
+    });
+    h.run( "media_track/conversion_mt", "raw", [&]( uint64_t n ) {
+        runThreads( nbThreads, n, raw );
+    });
+
+    const char* names[] = { "Disable", "Track 1 - [English]", "Track 2 - [French]", "Commentary - [English]" };
+    std::vector<libvlc_track_description_t> descriptions( sizeof( names ) / sizeof( names[0] ) );
+    for ( size_t i = 0; i < descriptions.size(); ++i )
+    {
+        descriptions[i].i_id = static_cast<int>( i ) - 1;
+        descriptions[i].psz_name = const_cast<char*>( names[i] );
+        descriptions[i].p_next = i + 1 < descriptions.size() ? &descriptions[i + 1] : nullptr;
+    }
+    h.run( "track_description/conversion", "wrapper", [&]( uint64_t n ) {
+        for ( uint64_t i = 0; i < n; ++i )
+        {
+            std::vector<VLC::TrackDescription> res;
+            for ( auto p = descriptions.data(); p != nullptr; p = p->p_next )
+                res.emplace_back( p );
+            doNotOptimize( res );
+        }
+    });
+    h.run( "track_description/conversion", "raw", [&]( uint64_t n ) {
+        for ( uint64_t i = 0; i < n; ++i )
+        {
+            for ( auto p = descriptions.data(); p != nullptr; p = p->p_next )
+            {
+                doNotOptimize( p->i_id );
+                doNotOptimize( p->psz_name );
+            }
+        }
+    });
+}
+
+} // anonymous namespace
+
+int main( int argc, char** argv )
+{
+    Harness h( "wrapper_overhead", argc, argv );
+    h.setContext( "libvlc", libvlc_get_version() );
+    const char* args[] = { "--quiet" };
+    VLC::Instance instance( 1, args );
+
+    benchEventDispatch( h, instance );
+    benchMetaChanged( h, instance );
+    benchHandleRegistration( h, instance );
+    benchTrampolines( h );
+    benchItemAtIndex( h, instance );
+    benchMeta( h, instance );
+    benchTracks( h, instance );
+    benchTrackConversions( h );
+    return 0;
+}
@@ -0,0 +1,2250 @@
+/*****************************************************************************
+ * libvlc_mock.cpp: A libvlc stand-in producing synthetic streams
+ *****************************************************************************
+ * Copyright © 2015 libvlcpp authors & VideoLAN
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Threading model, which mimics libvlc closely enough for the wrapper:
+ *  - Event managers hold a recursive lock while dispatching. Listeners may
+ *    attach & detach from their callback, and detaching from another thread
+ *    waits for the ongoing dispatch to complete.
+ *  - Each playing player runs one thread, which emits the player events and
+ *    invokes the video & audio callbacks, in stream time order.
+ *  - Media parsing is synchronous, even through libvlc_media_parse_async.
+ */
+
+#include "vlcmock.h"
+
+#include <vlc/libvlc_version.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+struct Stats
+{
+    std::atomic<uint64_t> eventsSent{ 0 };
+    std::atomic<uint64_t> videoFrames{ 0 };
+    std::atomic<uint64_t> audioBuffers{ 0 };
+    std::atomic<uint64_t> audioSamples{ 0 };
+    std::atomic<uint64_t> audioDeviceEnums{ 0 };
+    std::atomic<int64_t> instances{ 0 };
+    std::atomic<int64_t> medias{ 0 };
+    std::atomic<int64_t> mediaLists{ 0 };
+    std::atomic<int64_t> mediaPlayers{ 0 };
+    std::atomic<int64_t> listeners{ 0 };
+    std::atomic<int64_t> equalizers{ 0 };
+};
+
+Stats& stats()
+{
+    static Stats s;
+    return s;
+}
+
+vlcmock_stream_config_t makeDefaultConfig()
+{
+    vlcmock_stream_config_t config;
+    vlcmock_stream_config_init( &config );
+    return config;
+}
+
+std::mutex& defaultConfigMutex()
+{
+    static std::mutex m;
+    return m;
+}
+
+vlcmock_stream_config_t& defaultConfigLocked()
+{
+    static vlcmock_stream_config_t config = makeDefaultConfig();
+    return config;
+}
+
+vlcmock_stream_config_t defaultConfig()
+{
+    std::lock_guard<std::mutex> lock( defaultConfigMutex() );
+    return defaultConfigLocked();
+}
+
+// The number of libvlc_new calls left to fail
+std::atomic<unsigned> instanceFailures{ 0 };
+
+// The devices of every audio output, see vlcmock_set_audio_devices()
+std::vector<std::string>& audioDevicesLocked()
+{
+    static std::vector<std::string> devices{ "default" };
+    return devices;
+}
+
+char* duplicate( const std::string& str )
+{
+    auto res = static_cast<char*>( malloc( str.size() + 1 ) );
+    if ( res != nullptr )
+        memcpy( res, str.c_str(), str.size() + 1 );
+    return res;
+}
+
+libvlc_event_t makeEvent( libvlc_event_type_t type )
+{
+    libvlc_event_t e;
+    memset( &e, 0, sizeof( e ) );
+    e.type = type;
+    return e;
+}
+
+uint32_t fourcc( char a, char b, char c, char d )
+{
+    return static_cast<uint32_t>( a ) | ( static_cast<uint32_t>( b ) << 8 ) |
+           ( static_cast<uint32_t>( c ) << 16 ) | ( static_cast<uint32_t>( d ) << 24 );
+}
+
+unsigned bytesPerSample( const char* format )
+{
+    if ( strncmp( format, "FL32", 4 ) == 0 || strncmp( format, "S32N", 4 ) == 0 )
+        return 4;
+    if ( strncmp( format, "FL64", 4 ) == 0 )
+        return 8;
+    if ( strncmp( format, "U8", 2 ) == 0 )
+        return 1;
+    return 2;
+}
+
+} // anonymous namespace
+
+struct libvlc_event_manager_t
+{
+    struct Listener
+    {
+        libvlc_event_type_t type;
+        libvlc_callback_t callback;
+        void* data;
+        bool detached;
+    };
+
+    explicit libvlc_event_manager_t( void* owner )
+        : owner( owner )
+        , depth( 0 )
+        , nbDetached( 0 )
+    {
+    }
+
+    ~libvlc_event_manager_t()
+    {
+        stats().listeners -= static_cast<int64_t>( listeners.size() - nbDetached );
+    }
+
+    void send( libvlc_event_t& e )
+    {
+        e.p_obj = owner;
+        std::lock_guard<std::recursive_mutex> lock( mutex );
+        ++stats().eventsSent;
+        // Listeners detached during the dispatch are only flagged, so that
+        // indexes remain valid, and the ones attached meanwhile are skipped
+        const auto size = listeners.size();
+        ++depth;
+        for ( size_t i = 0; i < size; ++i )
+        {
+            // Copied, since a nested attach may reallocate the vector
+            auto l = listeners[i];
+            if ( l.type == e.type && l.detached == false )
+                l.callback( &e, l.data );
+        }
+        if ( --depth == 0 && nbDetached > 0 )
+        {
+            listeners.erase( std::remove_if( begin( listeners ), end( listeners ), []( const Listener& l ) {
+                return l.detached;
+            }), end( listeners ) );
+            nbDetached = 0;
+        }
+    }
+
+    void* owner;
+    std::recursive_mutex mutex;
+    std::vector<Listener> listeners;
+    unsigned int depth;
+    size_t nbDetached;
+};
+
+struct libvlc_instance_t
+{
+    libvlc_instance_t()
+        : refs( 1 )
+        , logCb( nullptr )
+        , logData( nullptr )
+    {
+        ++stats().instances;
+    }
+
+    ~libvlc_instance_t()
+    {
+        --stats().instances;
+    }
+
+    std::atomic<int> refs;
+    // Held while the log callback runs, so that unsetting it waits for
+    // the pending invocations, as libvlc does
+    std::mutex logMutex;
+    libvlc_log_cb logCb;
+    void* logData;
+};
+
+struct libvlc_log_t
+{
+    const char* module;
+    const char* file;
+    unsigned line;
+    const char* objectName;
+    const char* objectHeader;
+    uintptr_t objectId;
+};
+
+struct libvlc_media_t
+{
+    libvlc_media_t( libvlc_instance_t* instance, const std::string& mrl )
+        : refs( 1 )
+        , instance( instance )
+        , mrl( mrl )
+        , state( libvlc_NothingSpecial )
+        , parsed( false )
+        , userData( nullptr )
+        , subitems( nullptr )
+        , decodedVideo( 0 )
+        , decodedAudio( 0 )
+        , eventManager( this )
+    {
+        libvlc_retain( instance );
+        ++stats().medias;
+    }
+
+    ~libvlc_media_t()
+    {
+        if ( subitems != nullptr )
+            libvlc_media_list_release( subitems );
+        libvlc_release( instance );
+        --stats().medias;
+    }
+
+    void setState( libvlc_state_t s )
+    {
+        state = s;
+        auto e = makeEvent( libvlc_MediaStateChanged );
+        e.u.media_state_changed.new_state = s;
+        eventManager.send( e );
+    }
+
+    std::atomic<int> refs;
+    libvlc_instance_t* instance;
+    const std::string mrl;
+    std::mutex mutex;
+    std::map<int, std::string> metas;
+    std::vector<std::string> options;
+    std::atomic<libvlc_state_t> state;
+    std::atomic<bool> parsed;
+    void* userData;
+    libvlc_media_list_t* subitems;
+    std::atomic<int> decodedVideo;
+    std::atomic<int> decodedAudio;
+    libvlc_event_manager_t eventManager;
+};
+
+struct libvlc_media_list_t
+{
+    explicit libvlc_media_list_t( libvlc_instance_t* instance )
+        : refs( 1 )
+        , instance( instance )
+        , media( nullptr )
+        , eventManager( this )
+    {
+        if ( instance != nullptr )
+            libvlc_retain( instance );
+        ++stats().mediaLists;
+    }
+
+    ~libvlc_media_list_t()
+    {
+        for ( auto md : items )
+            libvlc_media_release( md );
+        if ( media != nullptr )
+            libvlc_media_release( media );
+        if ( instance != nullptr )
+            libvlc_release( instance );
+        --stats().mediaLists;
+    }
+
+    std::atomic<int> refs;
+    libvlc_instance_t* instance;
+    std::recursive_mutex mutex;
+    std::vector<libvlc_media_t*> items;
+    libvlc_media_t* media;
+    libvlc_event_manager_t eventManager;
+};
+
+namespace
+{
+
+/**
+ * The outputs the application configured, snapshotted when playback starts
+ */
+struct Outputs
+{
+    libvlc_video_lock_cb lock = nullptr;
+    libvlc_video_unlock_cb unlock = nullptr;
+    libvlc_video_display_cb display = nullptr;
+    void* videoOpaque = nullptr;
+    libvlc_video_format_cb videoFormat = nullptr;
+    libvlc_video_cleanup_cb videoCleanup = nullptr;
+    char chroma[5] = {};
+    unsigned width = 0;
+    unsigned height = 0;
+
+    libvlc_audio_play_cb play = nullptr;
+    libvlc_audio_pause_cb pause = nullptr;
+    libvlc_audio_resume_cb resume = nullptr;
+    libvlc_audio_flush_cb flush = nullptr;
+    libvlc_audio_drain_cb drain = nullptr;
+    void* audioOpaque = nullptr;
+    libvlc_audio_setup_cb audioSetup = nullptr;
+    libvlc_audio_cleanup_cb audioCleanup = nullptr;
+    libvlc_audio_set_volume_cb volume = nullptr;
+    char format[5] = {};
+    unsigned rate = 0;
+    unsigned channels = 0;
+};
+
+const unsigned int EqualizerBands = 10;
+
+struct EqualizerSettings
+{
+    float preamp;
+    std::array<float, EqualizerBands> amps;
+};
+
+} // anonymous namespace
+
+struct libvlc_media_player_t
+{
+    explicit libvlc_media_player_t( libvlc_instance_t* instance )
+        : refs( 1 )
+        , instance( instance )
+        , media( nullptr )
+        , config( defaultConfig() )
+        , state( libvlc_NothingSpecial )
+        , rate( 1.f )
+        , volume( 100 )
+        , mute( false )
+        , volumeChanged( false )
+        , rateChanged( false )
+        , stopRequested( false )
+        , paused( false )
+        , finished( true )
+        , seekTo( -1 )
+        , time( 0 )
+        , hasVout( false )
+        , videoWidth( 0 )
+        , videoHeight( 0 )
+        , audioTrack( -1 )
+        , videoTrack( -1 )
+        , hasEqualizer( false )
+        , equalizer{}
+        , eventManager( this )
+    {
+        libvlc_retain( instance );
+        ++stats().mediaPlayers;
+    }
+
+    ~libvlc_media_player_t()
+    {
+        if ( media != nullptr )
+            libvlc_media_release( media );
+        libvlc_release( instance );
+        --stats().mediaPlayers;
+    }
+
+    void send( libvlc_event_type_t type )
+    {
+        auto e = makeEvent( type );
+        eventManager.send( e );
+    }
+
+    std::atomic<int> refs;
+    libvlc_instance_t* instance;
+    // Serializes play/stop/pause & media changes
+    std::mutex controlMutex;
+    // Protects the fields shared with the playback thread
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::thread thread;
+    libvlc_media_t* media;
+    vlcmock_stream_config_t config;
+    Outputs outputs;
+    std::atomic<libvlc_state_t> state;
+    float rate;
+    int volume;
+    bool mute;
+    bool volumeChanged;
+    bool rateChanged;
+    bool stopRequested;
+    bool paused;
+    bool finished;
+    // In µs, -1 when no seek is pending
+    int64_t seekTo;
+    // In ms
+    std::atomic<int64_t> time;
+    std::atomic<bool> hasVout;
+    std::atomic<unsigned> videoWidth;
+    std::atomic<unsigned> videoHeight;
+    std::atomic<int> audioTrack;
+    std::atomic<int> videoTrack;
+    // The settings of the last equalizer set, protected by mutex
+    bool hasEqualizer;
+    EqualizerSettings equalizer;
+    libvlc_event_manager_t eventManager;
+};
+
+namespace
+{
+
+/**
+ * Everything a playback thread needs, captured when play() is called
+ */
+struct Session
+{
+    libvlc_media_t* media;
+    vlcmock_stream_config_t config;
+    Outputs outputs;
+    bool noVideo;
+    bool noAudio;
+    bool startPaused;
+};
+
+bool hasOption( const std::vector<std::string>& options, const char* name )
+{
+    return std::any_of( begin( options ), end( options ), [name]( const std::string& o ) {
+        auto opt = o.c_str();
+        if ( *opt == ':' )
+            ++opt;
+        return strcmp( opt, name ) == 0;
+    });
+}
+
+void setState( libvlc_media_player_t* mp, libvlc_media_t* md, libvlc_state_t state )
+{
+    mp->state = state;
+    md->setState( state );
+}
+
+enum class Outcome
+{
+    Ended,
+    Stopped,
+    Failed,
+};
+
+void playback( libvlc_media_player_t* mp, Session s )
+{
+    using Clock = std::chrono::steady_clock;
+    const auto& cfg = s.config;
+    auto& out = s.outputs;
+
+    setState( mp, s.media, libvlc_Opening );
+    mp->send( libvlc_MediaPlayerOpening );
+    {
+        auto e = makeEvent( libvlc_MediaPlayerBuffering );
+        e.u.media_player_buffering.new_cache = 100.f;
+        mp->eventManager.send( e );
+    }
+
+    // Video output setup, as the vout would do it
+    bool video = cfg.video_fps > 0 && s.noVideo == false && out.lock != nullptr;
+    void* videoOpaque = out.videoOpaque;
+    if ( video == true && out.videoFormat != nullptr )
+    {
+        char chroma[5];
+        memcpy( chroma, cfg.video_chroma, sizeof( chroma ) );
+        unsigned width = cfg.video_width;
+        unsigned height = cfg.video_height;
+        unsigned pitches[5] = {};
+        unsigned lines[5] = {};
+        video = out.videoFormat( &videoOpaque, chroma, &width, &height, pitches, lines ) != 0;
+        mp->videoWidth = width;
+        mp->videoHeight = height;
+    }
+    else if ( video == true )
+    {
+        // libvlc_video_set_format is required in the absence of a format callback
+        video = out.chroma[0] != 0;
+        mp->videoWidth = out.width;
+        mp->videoHeight = out.height;
+    }
+    const bool videoCleanup = video == true && out.videoFormat != nullptr && out.videoCleanup != nullptr;
+
+    // Audio output setup
+    bool audio = cfg.audio_rate > 0 && cfg.audio_samples_per_buffer > 0 &&
+                 s.noAudio == false && out.play != nullptr;
+    void* audioOpaque = out.audioOpaque;
+    char format[5] = "S16N";
+    unsigned rate = cfg.audio_rate;
+    unsigned channels = cfg.audio_channels;
+    if ( audio == true && out.audioSetup != nullptr )
+        audio = out.audioSetup( &audioOpaque, format, &rate, &channels ) == 0;
+    else if ( audio == true && out.format[0] != 0 )
+    {
+        memcpy( format, out.format, sizeof( format ) );
+        rate = out.rate;
+        channels = out.channels;
+    }
+    audio = audio == true && rate > 0 && channels > 0;
+    const bool audioCleanup = audio == true && out.audioSetup != nullptr && out.audioCleanup != nullptr;
+    const unsigned samples = cfg.audio_samples_per_buffer;
+    std::vector<uint8_t> buffer;
+    if ( audio == true )
+        buffer.resize( static_cast<size_t>( samples ) * channels * bytesPerSample( format ) );
+
+    if ( video == true )
+    {
+        mp->hasVout = true;
+        auto e = makeEvent( libvlc_MediaPlayerVout );
+        e.u.media_player_vout.new_count = 1;
+        mp->eventManager.send( e );
+    }
+    setState( mp, s.media, libvlc_Playing );
+    mp->send( libvlc_MediaPlayerPlaying );
+    {
+        auto e = makeEvent( libvlc_MediaPlayerLengthChanged );
+        e.u.media_player_length_changed.new_length = cfg.duration;
+        mp->eventManager.send( e );
+        e = makeEvent( libvlc_MediaPlayerSeekableChanged );
+        e.u.media_player_seekable_changed.new_seekable = 1;
+        mp->eventManager.send( e );
+        e = makeEvent( libvlc_MediaPlayerPausableChanged );
+        e.u.media_player_pausable_changed.new_pausable = 1;
+        mp->eventManager.send( e );
+    }
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(3, 0, 0, 0)
+    for ( auto type : { libvlc_MediaPlayerESAdded, libvlc_MediaPlayerESSelected } )
+    {
+        auto e = makeEvent( type );
+        if ( cfg.video_fps > 0 )
+        {
+            e.u.media_player_es_changed.i_type = libvlc_track_video;
+            e.u.media_player_es_changed.i_id = 0;
+            mp->eventManager.send( e );
+        }
+        if ( cfg.audio_rate > 0 )
+        {
+            e.u.media_player_es_changed.i_type = libvlc_track_audio;
+            e.u.media_player_es_changed.i_id = 1;
+            mp->eventManager.send( e );
+        }
+    }
+#endif
+    if ( audio == true && out.volume != nullptr )
+    {
+        std::unique_lock<std::mutex> lock( mp->mutex );
+        auto volume = mp->volume / 100.f;
+        auto mute = mp->mute;
+        mp->volumeChanged = false;
+        lock.unlock();
+        out.volume( audioOpaque, volume, mute );
+    }
+
+    // The stream is a merge of 3 periodic sequences, indexed by k*.
+    // Dates are in µs of stream time.
+    const int64_t duration = cfg.duration * 1000;
+    const int64_t errorAt = cfg.error_at >= 0 ? cfg.error_at * 1000 : -1;
+    const double videoPeriod = video == true ? 1000000. / cfg.video_fps : 0.;
+    const double audioPeriod = audio == true ? 1000000. * samples / rate : 0.;
+    const double timePeriod = cfg.time_changed_rate > 0 ? 1000000. / cfg.time_changed_rate : 0.;
+    uint64_t kv = 0, ka = 0, kt = 0;
+    auto date = []( double period, uint64_t k ) {
+        return static_cast<int64_t>( std::llround( period * k ) );
+    };
+    auto firstIndex = []( double period, int64_t t ) {
+        return period > 0 ? static_cast<uint64_t>( std::ceil( t / period ) ) : 0;
+    };
+
+    // Wall clock reference, for paced streams
+    auto wallStart = Clock::now();
+    int64_t streamStart = 0;
+    int64_t current = 0;
+    Outcome outcome = Outcome::Ended;
+    while ( true )
+    {
+        int64_t next = -1;
+        int what = -1;
+        if ( video == true && ( next < 0 || date( videoPeriod, kv ) < next ) )
+        {
+            next = date( videoPeriod, kv );
+            what = 0;
+        }
+        if ( audio == true && ( next < 0 || date( audioPeriod, ka ) < next ) )
+        {
+            next = date( audioPeriod, ka );
+            what = 1;
+        }
+        if ( timePeriod > 0 && ( next < 0 || date( timePeriod, kt ) < next ) )
+        {
+            next = date( timePeriod, kt );
+            what = 2;
+        }
+        if ( next < 0 || next >= duration )
+            next = duration;
+
+        std::unique_lock<std::mutex> lock( mp->mutex );
+        if ( mp->paused == true && mp->stopRequested == false )
+        {
+            lock.unlock();
+            setState( mp, s.media, libvlc_Paused );
+            if ( audio == true && out.pause != nullptr )
+                out.pause( audioOpaque, current );
+            mp->send( libvlc_MediaPlayerPaused );
+            lock.lock();
+            mp->cond.wait( lock, [mp]() { return mp->paused == false || mp->stopRequested == true; } );
+            if ( mp->stopRequested == false )
+            {
+                lock.unlock();
+                if ( audio == true && out.resume != nullptr )
+                    out.resume( audioOpaque, current );
+                setState( mp, s.media, libvlc_Playing );
+                mp->send( libvlc_MediaPlayerPlaying );
+                lock.lock();
+            }
+            wallStart = Clock::now();
+            streamStart = current;
+        }
+        if ( mp->stopRequested == true )
+        {
+            outcome = Outcome::Stopped;
+            break;
+        }
+        if ( mp->seekTo >= 0 )
+        {
+            current = std::min( mp->seekTo, duration );
+            mp->seekTo = -1;
+            lock.unlock();
+            if ( audio == true && out.flush != nullptr )
+                out.flush( audioOpaque, current );
+            kv = firstIndex( videoPeriod, current );
+            ka = firstIndex( audioPeriod, current );
+            kt = firstIndex( timePeriod, current );
+            wallStart = Clock::now();
+            streamStart = current;
+            continue;
+        }
+        if ( mp->volumeChanged == true )
+        {
+            mp->volumeChanged = false;
+            auto volume = mp->volume / 100.f;
+            auto mute = mp->mute;
+            lock.unlock();
+            if ( audio == true && out.volume != nullptr )
+                out.volume( audioOpaque, volume, mute );
+            continue;
+        }
+        if ( cfg.paced != 0 )
+        {
+            auto rate = mp->rate > 0 ? mp->rate : 1.f;
+            auto deadline = wallStart + std::chrono::microseconds(
+                        static_cast<int64_t>( ( next - streamStart ) / rate ) );
+            // Woken up early to handle pause, stop, seek & rate requests
+            if ( mp->cond.wait_until( lock, deadline, [mp]() {
+                    return mp->paused == true || mp->stopRequested == true ||
+                           mp->seekTo >= 0 || mp->volumeChanged == true ||
+                           mp->rateChanged == true;
+                }) == true )
+            {
+                if ( mp->rateChanged == true )
+                {
+                    mp->rateChanged = false;
+                    wallStart = Clock::now();
+                    streamStart = current;
+                }
+                continue;
+            }
+        }
+        lock.unlock();
+
+        if ( errorAt >= 0 && next >= errorAt )
+        {
+            outcome = Outcome::Failed;
+            break;
+        }
+        if ( next >= duration )
+            break;
+        current = next;
+        switch ( what )
+        {
+        case 0:
+        {
+            void* planes[5] = {};
+            auto picture = out.lock( videoOpaque, planes );
+            if ( out.unlock != nullptr )
+                out.unlock( videoOpaque, picture, planes );
+            if ( out.display != nullptr )
+                out.display( videoOpaque, picture );
+            ++s.media->decodedVideo;
+            ++stats().videoFrames;
+            ++kv;
+            break;
+        }
+        case 1:
+            out.play( audioOpaque, buffer.data(), samples, next );
+            ++s.media->decodedAudio;
+            ++stats().audioBuffers;
+            stats().audioSamples += samples;
+            ++ka;
+            break;
+        default:
+        {
+            mp->time = next / 1000;
+            auto e = makeEvent( libvlc_MediaPlayerTimeChanged );
+            e.u.media_player_time_changed.new_time = next / 1000;
+            mp->eventManager.send( e );
+            e = makeEvent( libvlc_MediaPlayerPositionChanged );
+            e.u.media_player_position_changed.new_position =
+                    duration > 0 ? static_cast<float>( next ) / duration : 0.f;
+            mp->eventManager.send( e );
+            ++kt;
+            break;
+        }
+        }
+    }
+
+    if ( audio == true )
+    {
+        if ( outcome == Outcome::Ended && out.drain != nullptr )
+            out.drain( audioOpaque );
+        else if ( outcome != Outcome::Ended && out.flush != nullptr )
+            out.flush( audioOpaque, current );
+        if ( audioCleanup == true )
+            out.audioCleanup( audioOpaque );
+    }
+    if ( videoCleanup == true )
+        out.videoCleanup( videoOpaque );
+    mp->hasVout = false;
+
+    if ( outcome == Outcome::Ended )
+    {
+        mp->time = cfg.duration;
+        setState( mp, s.media, libvlc_Ended );
+        mp->send( libvlc_MediaPlayerEndReached );
+    }
+    else if ( outcome == Outcome::Failed )
+    {
+        setState( mp, s.media, libvlc_Error );
+        mp->send( libvlc_MediaPlayerEncounteredError );
+    }
+    libvlc_media_release( s.media );
+
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    mp->finished = true;
+    mp->cond.notify_all();
+}
+
+/**
+ * Stops the playback thread, if any.
+ * Must be called with the control lock held.
+ *
+ * \return true if a thread was stopped
+ */
+bool stopPlayback( libvlc_media_player_t* mp )
+{
+    std::thread thread;
+    {
+        std::lock_guard<std::mutex> lock( mp->mutex );
+        if ( mp->thread.joinable() == false )
+            return false;
+        mp->stopRequested = true;
+        mp->cond.notify_all();
+        thread = std::move( mp->thread );
+    }
+    thread.join();
+    mp->hasVout = false;
+    return true;
+}
+
+libvlc_track_description_t* makeTrackDescriptions( int id, const char* name )
+{
+    auto disable = static_cast<libvlc_track_description_t*>( calloc( 1, sizeof( libvlc_track_description_t ) ) );
+    auto track = static_cast<libvlc_track_description_t*>( calloc( 1, sizeof( libvlc_track_description_t ) ) );
+    if ( disable == nullptr || track == nullptr )
+    {
+        free( disable );
+        free( track );
+        return nullptr;
+    }
+    disable->i_id = -1;
+    disable->psz_name = duplicate( "Disable" );
+    disable->p_next = track;
+    track->i_id = id;
+    track->psz_name = duplicate( name );
+    return disable;
+}
+
+} // anonymous namespace
+
+/*
+ * Mock control API
+ */
+
+void vlcmock_stream_config_init( vlcmock_stream_config_t* config )
+{
+    memset( config, 0, sizeof( *config ) );
+    config->video_fps = 25.;
+    config->video_width = 640;
+    config->video_height = 360;
+    memcpy( config->video_chroma, "RV32", 5 );
+    config->audio_rate = 48000;
+    config->audio_channels = 2;
+    config->audio_samples_per_buffer = 1024;
+    config->time_changed_rate = 4.;
+    config->duration = 10000;
+    config->error_at = -1;
+    config->paced = 0;
+}
+
+void vlcmock_set_default_stream_config( const vlcmock_stream_config_t* config )
+{
+    std::lock_guard<std::mutex> lock( defaultConfigMutex() );
+    defaultConfigLocked() = *config;
+}
+
+void vlcmock_media_player_set_stream_config( libvlc_media_player_t* mp,
+                                             const vlcmock_stream_config_t* config )
+{
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    mp->config = *config;
+}
+
+int vlcmock_media_player_get_equalizer( libvlc_media_player_t* mp, float* preamp,
+                                        float* amps, unsigned count )
+{
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    if ( mp->hasEqualizer == false )
+        return -1;
+    if ( preamp != nullptr )
+        *preamp = mp->equalizer.preamp;
+    if ( amps != nullptr )
+        std::copy_n( begin( mp->equalizer.amps ), std::min( count, EqualizerBands ), amps );
+    return 0;
+}
+
+int vlcmock_media_player_wait( libvlc_media_player_t* mp, int64_t timeout )
+{
+    std::unique_lock<std::mutex> lock( mp->mutex );
+    auto pred = [mp]() { return mp->finished; };
+    if ( timeout < 0 )
+    {
+        mp->cond.wait( lock, pred );
+        return 0;
+    }
+    return mp->cond.wait_for( lock, std::chrono::milliseconds( timeout ), pred ) ? 0 : -1;
+}
+
+int vlcmock_event_emit( libvlc_event_manager_t* em, libvlc_event_type_t type,
+                        libvlc_media_t* item, unsigned count )
+{
+    for ( unsigned i = 0; i < count; ++i )
+    {
+        auto e = makeEvent( type );
+        switch ( type )
+        {
+        case libvlc_MediaMetaChanged:
+            e.u.media_meta_changed.meta_type = libvlc_meta_Title;
+            break;
+        case libvlc_MediaSubItemAdded:
+            e.u.media_subitem_added.new_child = item;
+            break;
+        case libvlc_MediaDurationChanged:
+            e.u.media_duration_changed.new_duration = i;
+            break;
+        case libvlc_MediaParsedChanged:
+            e.u.media_parsed_changed.new_status = 1;
+            break;
+        case libvlc_MediaFreed:
+            e.u.media_freed.md = item;
+            break;
+        case libvlc_MediaStateChanged:
+            e.u.media_state_changed.new_state = static_cast<libvlc_state_t>( i % ( libvlc_Error + 1 ) );
+            break;
+        case libvlc_MediaSubItemTreeAdded:
+            e.u.media_subitemtree_added.item = item;
+            break;
+        case libvlc_MediaPlayerMediaChanged:
+            e.u.media_player_media_changed.new_media = item;
+            break;
+        case libvlc_MediaPlayerNothingSpecial:
+        case libvlc_MediaPlayerOpening:
+        case libvlc_MediaPlayerPlaying:
+        case libvlc_MediaPlayerPaused:
+        case libvlc_MediaPlayerStopped:
+        case libvlc_MediaPlayerForward:
+        case libvlc_MediaPlayerBackward:
+        case libvlc_MediaPlayerEndReached:
+        case libvlc_MediaPlayerEncounteredError:
+            break;
+        case libvlc_MediaPlayerBuffering:
+            e.u.media_player_buffering.new_cache = 100.f * ( i + 1 ) / count;
+            break;
+        case libvlc_MediaPlayerTimeChanged:
+            e.u.media_player_time_changed.new_time = i;
+            break;
+        case libvlc_MediaPlayerPositionChanged:
+            e.u.media_player_position_changed.new_position = static_cast<float>( i ) / count;
+            break;
+        case libvlc_MediaPlayerSeekableChanged:
+            e.u.media_player_seekable_changed.new_seekable = 1;
+            break;
+        case libvlc_MediaPlayerPausableChanged:
+            e.u.media_player_pausable_changed.new_pausable = 1;
+            break;
+        case libvlc_MediaPlayerTitleChanged:
+            e.u.media_player_title_changed.new_title = i;
+            break;
+        case libvlc_MediaPlayerSnapshotTaken:
+            e.u.media_player_snapshot_taken.psz_filename = const_cast<char*>( "snapshot.png" );
+            break;
+        case libvlc_MediaPlayerLengthChanged:
+            e.u.media_player_length_changed.new_length = i;
+            break;
+        case libvlc_MediaPlayerVout:
+            e.u.media_player_vout.new_count = 1;
+            break;
+        case libvlc_MediaPlayerScrambledChanged:
+            e.u.media_player_scrambled_changed.new_scrambled = 0;
+            break;
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(3, 0, 0, 0)
+        case libvlc_MediaPlayerESAdded:
+        case libvlc_MediaPlayerESDeleted:
+        case libvlc_MediaPlayerESSelected:
+            e.u.media_player_es_changed.i_type = libvlc_track_video;
+            e.u.media_player_es_changed.i_id = i;
+            break;
+#endif
+        case libvlc_MediaListItemAdded:
+        case libvlc_MediaListWillAddItem:
+        case libvlc_MediaListItemDeleted:
+        case libvlc_MediaListWillDeleteItem:
+            // All 4 payloads share the same layout
+            e.u.media_list_item_added.item = item;
+            e.u.media_list_item_added.index = i;
+            break;
+        default:
+            return -1;
+        }
+        em->send( e );
+    }
+    return 0;
+}
+
+void vlcmock_event_send( libvlc_event_manager_t* em, libvlc_event_t* event )
+{
+    em->send( *event );
+}
+
+void vlcmock_fail_instances( unsigned count )
+{
+    instanceFailures = count;
+}
+
+void vlcmock_set_audio_devices( const char* const* devices, unsigned count )
+{
+    std::lock_guard<std::mutex> lock( defaultConfigMutex() );
+    audioDevicesLocked().assign( devices, devices + count );
+}
+
+void vlcmock_log( libvlc_instance_t* instance, int level, const char* module,
+                  const char* fmt, ... )
+{
+    libvlc_log_t ctx{ module, "mock.c", 1, "mock", nullptr,
+                      reinterpret_cast<uintptr_t>( instance ) };
+    std::lock_guard<std::mutex> lock( instance->logMutex );
+    if ( instance->logCb == nullptr )
+        return;
+    va_list args;
+    va_start( args, fmt );
+    instance->logCb( instance->logData, level, &ctx, fmt, args );
+    va_end( args );
+}
+
+void vlcmock_get_stats( vlcmock_stats_t* s )
+{
+    auto& st = stats();
+    s->events_sent = st.eventsSent;
+    s->video_frames = st.videoFrames;
+    s->audio_buffers = st.audioBuffers;
+    s->audio_samples = st.audioSamples;
+    s->audio_device_enums = st.audioDeviceEnums;
+    s->instances = st.instances;
+    s->medias = st.medias;
+    s->media_lists = st.mediaLists;
+    s->media_players = st.mediaPlayers;
+    s->listeners = st.listeners;
+    s->equalizers = st.equalizers;
+}
+
+/*
+ * Core
+ */
+
+libvlc_instance_t* libvlc_new( int, const char* const* )
+{
+    auto failures = instanceFailures.load();
+    while ( failures > 0 )
+    {
+        if ( instanceFailures.compare_exchange_weak( failures, failures - 1 ) )
+            return nullptr;
+    }
+    return new libvlc_instance_t;
+}
+
+void libvlc_retain( libvlc_instance_t* instance )
+{
+    ++instance->refs;
+}
+
+void libvlc_release( libvlc_instance_t* instance )
+{
+    if ( instance != nullptr && --instance->refs == 0 )
+        delete instance;
+}
+
+void libvlc_log_set( libvlc_instance_t* instance, libvlc_log_cb cb, void* data )
+{
+    std::lock_guard<std::mutex> lock( instance->logMutex );
+    instance->logCb = cb;
+    instance->logData = data;
+}
+
+void libvlc_log_unset( libvlc_instance_t* instance )
+{
+    libvlc_log_set( instance, nullptr, nullptr );
+}
+
+void libvlc_log_get_context( const libvlc_log_t* ctx, const char** module,
+                             const char** file, unsigned* line )
+{
+    if ( module != nullptr )
+        *module = ctx->module;
+    if ( file != nullptr )
+        *file = ctx->file;
+    if ( line != nullptr )
+        *line = ctx->line;
+}
+
+void libvlc_log_get_object( const libvlc_log_t* ctx, const char** name,
+                            const char** header, uintptr_t* id )
+{
+    if ( name != nullptr )
+        *name = ctx->objectName;
+    if ( header != nullptr )
+        *header = ctx->objectHeader;
+    if ( id != nullptr )
+        *id = ctx->objectId;
+}
+
+const char* libvlc_get_version()
+{
+#define VLCMOCK_STR2( x ) #x
+#define VLCMOCK_STR( x ) VLCMOCK_STR2( x )
+    return VLCMOCK_STR( LIBVLC_VERSION_MAJOR ) "." VLCMOCK_STR( LIBVLC_VERSION_MINOR ) "."
+           VLCMOCK_STR( LIBVLC_VERSION_REVISION ) " (vlcmock)";
+#undef VLCMOCK_STR
+#undef VLCMOCK_STR2
+}
+
+void libvlc_free( void* ptr )
+{
+    free( ptr );
+}
+
+int libvlc_event_attach( libvlc_event_manager_t* em, libvlc_event_type_t type,
+                         libvlc_callback_t callback, void* data )
+{
+    std::lock_guard<std::recursive_mutex> lock( em->mutex );
+    em->listeners.push_back( libvlc_event_manager_t::Listener{ type, callback, data, false } );
+    ++stats().listeners;
+    return 0;
+}
+
+void libvlc_event_detach( libvlc_event_manager_t* em, libvlc_event_type_t type,
+                          libvlc_callback_t callback, void* data )
+{
+    std::lock_guard<std::recursive_mutex> lock( em->mutex );
+    auto it = std::find_if( begin( em->listeners ), end( em->listeners ),
+                            [type, callback, data]( const libvlc_event_manager_t::Listener& l ) {
+        return l.type == type && l.callback == callback && l.data == data && l.detached == false;
+    });
+    if ( it == end( em->listeners ) )
+        return;
+    --stats().listeners;
+    if ( em->depth > 0 )
+    {
+        it->detached = true;
+        ++em->nbDetached;
+    }
+    else
+        em->listeners.erase( it );
+}
+
+/*
+ * Media
+ */
+
+libvlc_media_t* libvlc_media_new_location( libvlc_instance_t* instance, const char* mrl )
+{
+    return new libvlc_media_t( instance, mrl );
+}
+
+libvlc_media_t* libvlc_media_new_path( libvlc_instance_t* instance, const char* path )
+{
+    return new libvlc_media_t( instance, std::string( "file://" ) + path );
+}
+
+libvlc_media_t* libvlc_media_new_fd( libvlc_instance_t* instance, int fd )
+{
+    return new libvlc_media_t( instance, "fd://" + std::to_string( fd ) );
+}
+
+libvlc_media_t* libvlc_media_new_as_node( libvlc_instance_t* instance, const char* name )
+{
+    auto md = new libvlc_media_t( instance, "vlc://nop" );
+    md->metas[libvlc_meta_Title] = name;
+    return md;
+}
+
+void libvlc_media_retain( libvlc_media_t* md )
+{
+    ++md->refs;
+}
+
+void libvlc_media_release( libvlc_media_t* md )
+{
+    // As libvlc, accept NULL, which the wrapper releases in some error paths
+    if ( md == nullptr || --md->refs != 0 )
+        return;
+    auto e = makeEvent( libvlc_MediaFreed );
+    e.u.media_freed.md = md;
+    md->eventManager.send( e );
+    delete md;
+}
+
+void libvlc_media_add_option( libvlc_media_t* md, const char* option )
+{
+    std::lock_guard<std::mutex> lock( md->mutex );
+    md->options.push_back( option );
+}
+
+void libvlc_media_add_option_flag( libvlc_media_t* md, const char* option, unsigned )
+{
+    libvlc_media_add_option( md, option );
+}
+
+char* libvlc_media_get_mrl( libvlc_media_t* md )
+{
+    return duplicate( md->mrl );
+}
+
+libvlc_media_t* libvlc_media_duplicate( libvlc_media_t* md )
+{
+    auto res = new libvlc_media_t( md->instance, md->mrl );
+    std::lock_guard<std::mutex> lock( md->mutex );
+    res->metas = md->metas;
+    res->options = md->options;
+    return res;
+}
+
+char* libvlc_media_get_meta( libvlc_media_t* md, libvlc_meta_t type )
+{
+    std::lock_guard<std::mutex> lock( md->mutex );
+    auto it = md->metas.find( type );
+    if ( it == end( md->metas ) )
+        return nullptr;
+    return duplicate( it->second );
+}
+
+void libvlc_media_set_meta( libvlc_media_t* md, libvlc_meta_t type, const char* value )
+{
+    {
+        std::lock_guard<std::mutex> lock( md->mutex );
+        md->metas[type] = value != nullptr ? value : "";
+    }
+    auto e = makeEvent( libvlc_MediaMetaChanged );
+    e.u.media_meta_changed.meta_type = type;
+    md->eventManager.send( e );
+}
+
+int libvlc_media_save_meta( libvlc_media_t* )
+{
+    return 1;
+}
+
+libvlc_state_t libvlc_media_get_state( libvlc_media_t* md )
+{
+    return md->state;
+}
+
+int libvlc_media_get_stats( libvlc_media_t* md, libvlc_media_stats_t* stats )
+{
+    memset( stats, 0, sizeof( *stats ) );
+    stats->i_decoded_video = md->decodedVideo;
+    stats->i_displayed_pictures = md->decodedVideo;
+    stats->i_decoded_audio = md->decodedAudio;
+    return 1;
+}
+
+libvlc_media_list_t* libvlc_media_subitems( libvlc_media_t* md )
+{
+    std::lock_guard<std::mutex> lock( md->mutex );
+    if ( md->subitems == nullptr )
+        md->subitems = new libvlc_media_list_t( md->instance );
+    libvlc_media_list_retain( md->subitems );
+    return md->subitems;
+}
+
+libvlc_event_manager_t* libvlc_media_event_manager( libvlc_media_t* md )
+{
+    return &md->eventManager;
+}
+
+libvlc_time_t libvlc_media_get_duration( libvlc_media_t* md )
+{
+    if ( md->parsed == false && md->state == libvlc_NothingSpecial )
+        return -1;
+    return defaultConfig().duration;
+}
+
+void libvlc_media_parse( libvlc_media_t* md )
+{
+    if ( md->parsed.exchange( true ) == true )
+        return;
+    auto e = makeEvent( libvlc_MediaDurationChanged );
+    e.u.media_duration_changed.new_duration = defaultConfig().duration;
+    md->eventManager.send( e );
+    e = makeEvent( libvlc_MediaParsedChanged );
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(3, 0, 0, 0)
+    e.u.media_parsed_changed.new_status = libvlc_media_parsed_status_done;
+#else
+    e.u.media_parsed_changed.new_status = 1;
+#endif
+    md->eventManager.send( e );
+}
+
+void libvlc_media_parse_async( libvlc_media_t* md )
+{
+    libvlc_media_parse( md );
+}
+
+int libvlc_media_is_parsed( libvlc_media_t* md )
+{
+    return md->parsed;
+}
+
+void libvlc_media_set_user_data( libvlc_media_t* md, void* data )
+{
+    md->userData = data;
+}
+
+void* libvlc_media_get_user_data( libvlc_media_t* md )
+{
+    return md->userData;
+}
+
+unsigned libvlc_media_tracks_get( libvlc_media_t*, libvlc_media_track_t*** tracks )
+{
+    auto cfg = defaultConfig();
+    std::vector<libvlc_media_track_t*> res;
+    if ( cfg.video_fps > 0 )
+    {
+        auto t = static_cast<libvlc_media_track_t*>( calloc( 1, sizeof( libvlc_media_track_t ) ) );
+        t->video = static_cast<libvlc_video_track_t*>( calloc( 1, sizeof( libvlc_video_track_t ) ) );
+        t->i_codec = t->i_original_fourcc = fourcc( 'h', '2', '6', '4' );
+        t->i_id = 0;
+        t->i_type = libvlc_track_video;
+        t->video->i_width = cfg.video_width;
+        t->video->i_height = cfg.video_height;
+        t->video->i_sar_num = t->video->i_sar_den = 1;
+        t->video->i_frame_rate_num = static_cast<unsigned>( std::lround( cfg.video_fps * 1000 ) );
+        t->video->i_frame_rate_den = 1000;
+        res.push_back( t );
+    }
+    if ( cfg.audio_rate > 0 )
+    {
+        auto t = static_cast<libvlc_media_track_t*>( calloc( 1, sizeof( libvlc_media_track_t ) ) );
+        t->audio = static_cast<libvlc_audio_track_t*>( calloc( 1, sizeof( libvlc_audio_track_t ) ) );
+        t->i_codec = t->i_original_fourcc = fourcc( 'm', 'p', '4', 'a' );
+        t->i_id = 1;
+        t->i_type = libvlc_track_audio;
+        t->audio->i_rate = cfg.audio_rate;
+        t->audio->i_channels = cfg.audio_channels;
+        t->psz_language = duplicate( "eng" );
+        res.push_back( t );
+    }
+    *tracks = static_cast<libvlc_media_track_t**>( calloc( res.size() + 1, sizeof( libvlc_media_track_t* ) ) );
+    std::copy( begin( res ), end( res ), *tracks );
+    return static_cast<unsigned>( res.size() );
+}
+
+void libvlc_media_tracks_release( libvlc_media_track_t** tracks, unsigned count )
+{
+    for ( unsigned i = 0; i < count; ++i )
+    {
+        // The union members are all pointers
+        free( tracks[i]->video );
+        free( tracks[i]->psz_language );
+        free( tracks[i]->psz_description );
+        free( tracks[i] );
+    }
+    free( tracks );
+}
+
+/*
+ * Media lists
+ */
+
+libvlc_media_list_t* libvlc_media_list_new( libvlc_instance_t* instance )
+{
+    return new libvlc_media_list_t( instance );
+}
+
+void libvlc_media_list_retain( libvlc_media_list_t* list )
+{
+    ++list->refs;
+}
+
+void libvlc_media_list_release( libvlc_media_list_t* list )
+{
+    if ( list != nullptr && --list->refs == 0 )
+        delete list;
+}
+
+void libvlc_media_list_set_media( libvlc_media_list_t* list, libvlc_media_t* md )
+{
+    std::lock_guard<std::recursive_mutex> lock( list->mutex );
+    if ( md != nullptr )
+        libvlc_media_retain( md );
+    if ( list->media != nullptr )
+        libvlc_media_release( list->media );
+    list->media = md;
+}
+
+libvlc_media_t* libvlc_media_list_media( libvlc_media_list_t* list )
+{
+    std::lock_guard<std::recursive_mutex> lock( list->mutex );
+    if ( list->media != nullptr )
+        libvlc_media_retain( list->media );
+    return list->media;
+}
+
+int libvlc_media_list_insert_media( libvlc_media_list_t* list, libvlc_media_t* md, int index )
+{
+    std::lock_guard<std::recursive_mutex> lock( list->mutex );
+    if ( index < 0 || static_cast<size_t>( index ) > list->items.size() )
+        return -1;
+    auto e = makeEvent( libvlc_MediaListWillAddItem );
+    e.u.media_list_will_add_item.item = md;
+    e.u.media_list_will_add_item.index = index;
+    list->eventManager.send( e );
+    libvlc_media_retain( md );
+    list->items.insert( begin( list->items ) + index, md );
+    e = makeEvent( libvlc_MediaListItemAdded );
+    e.u.media_list_item_added.item = md;
+    e.u.media_list_item_added.index = index;
+    list->eventManager.send( e );
+    return 0;
+}
+
+int libvlc_media_list_add_media( libvlc_media_list_t* list, libvlc_media_t* md )
+{
+    std::lock_guard<std::recursive_mutex> lock( list->mutex );
+    return libvlc_media_list_insert_media( list, md, static_cast<int>( list->items.size() ) );
+}
+
+int libvlc_media_list_remove_index( libvlc_media_list_t* list, int index )
+{
+    std::lock_guard<std::recursive_mutex> lock( list->mutex );
+    if ( index < 0 || static_cast<size_t>( index ) >= list->items.size() )
+        return -1;
+    auto md = list->items[index];
+    auto e = makeEvent( libvlc_MediaListWillDeleteItem );
+    e.u.media_list_will_delete_item.item = md;
+    e.u.media_list_will_delete_item.index = index;
+    list->eventManager.send( e );
+    list->items.erase( begin( list->items ) + index );
+    e = makeEvent( libvlc_MediaListItemDeleted );
+    e.u.media_list_item_deleted.item = md;
+    e.u.media_list_item_deleted.index = index;
+    list->eventManager.send( e );
+    libvlc_media_release( md );
+    return 0;
+}
+
+int libvlc_media_list_count( libvlc_media_list_t* list )
+{
+    std::lock_guard<std::recursive_mutex> lock( list->mutex );
+    return static_cast<int>( list->items.size() );
+}
+
+libvlc_media_t* libvlc_media_list_item_at_index( libvlc_media_list_t* list, int index )
+{
+    std::lock_guard<std::recursive_mutex> lock( list->mutex );
+    if ( index < 0 || static_cast<size_t>( index ) >= list->items.size() )
+        return nullptr;
+    auto md = list->items[index];
+    libvlc_media_retain( md );
+    return md;
+}
+
+int libvlc_media_list_index_of_item( libvlc_media_list_t* list, libvlc_media_t* md )
+{
+    std::lock_guard<std::recursive_mutex> lock( list->mutex );
+    auto it = std::find( begin( list->items ), end( list->items ), md );
+    if ( it == end( list->items ) )
+        return -1;
+    return static_cast<int>( it - begin( list->items ) );
+}
+
+int libvlc_media_list_is_readonly( libvlc_media_list_t* )
+{
+    return 0;
+}
+
+void libvlc_media_list_lock( libvlc_media_list_t* list )
+{
+    list->mutex.lock();
+}
+
+void libvlc_media_list_unlock( libvlc_media_list_t* list )
+{
+    list->mutex.unlock();
+}
+
+libvlc_event_manager_t* libvlc_media_list_event_manager( libvlc_media_list_t* list )
+{
+    return &list->eventManager;
+}
+
+/*
+ * Media players
+ */
+
+libvlc_media_player_t* libvlc_media_player_new( libvlc_instance_t* instance )
+{
+    return new libvlc_media_player_t( instance );
+}
+
+libvlc_media_player_t* libvlc_media_player_new_from_media( libvlc_media_t* md )
+{
+    auto mp = new libvlc_media_player_t( md->instance );
+    libvlc_media_retain( md );
+    mp->media = md;
+    return mp;
+}
+
+void libvlc_media_player_retain( libvlc_media_player_t* mp )
+{
+    ++mp->refs;
+}
+
+void libvlc_media_player_release( libvlc_media_player_t* mp )
+{
+    if ( mp == nullptr || --mp->refs != 0 )
+        return;
+    {
+        std::lock_guard<std::mutex> lock( mp->controlMutex );
+        stopPlayback( mp );
+    }
+    delete mp;
+}
+
+void libvlc_media_player_set_media( libvlc_media_player_t* mp, libvlc_media_t* md )
+{
+    {
+        std::lock_guard<std::mutex> lock( mp->controlMutex );
+        stopPlayback( mp );
+        mp->state = libvlc_NothingSpecial;
+        if ( md != nullptr )
+            libvlc_media_retain( md );
+        if ( mp->media != nullptr )
+            libvlc_media_release( mp->media );
+        mp->media = md;
+    }
+    auto e = makeEvent( libvlc_MediaPlayerMediaChanged );
+    e.u.media_player_media_changed.new_media = md;
+    mp->eventManager.send( e );
+}
+
+libvlc_media_t* libvlc_media_player_get_media( libvlc_media_player_t* mp )
+{
+    std::lock_guard<std::mutex> lock( mp->controlMutex );
+    if ( mp->media != nullptr )
+        libvlc_media_retain( mp->media );
+    return mp->media;
+}
+
+libvlc_event_manager_t* libvlc_media_player_event_manager( libvlc_media_player_t* mp )
+{
+    return &mp->eventManager;
+}
+
+int libvlc_media_player_play( libvlc_media_player_t* mp )
+{
+    std::lock_guard<std::mutex> control( mp->controlMutex );
+    {
+        std::lock_guard<std::mutex> lock( mp->mutex );
+        if ( mp->thread.joinable() == true && mp->finished == false )
+        {
+            mp->paused = false;
+            mp->cond.notify_all();
+            return 0;
+        }
+    }
+    // Reap the previous, completed, playback
+    stopPlayback( mp );
+    if ( mp->media == nullptr )
+        return -1;
+    Session s;
+    libvlc_media_retain( mp->media );
+    s.media = mp->media;
+    {
+        std::lock_guard<std::mutex> lock( s.media->mutex );
+        s.noVideo = hasOption( s.media->options, "no-video" );
+        s.noAudio = hasOption( s.media->options, "no-audio" );
+        s.startPaused = hasOption( s.media->options, "start-paused" );
+    }
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    s.config = mp->config;
+    s.outputs = mp->outputs;
+    mp->stopRequested = false;
+    // Paused once playing, before the first frame
+    mp->paused = s.startPaused;
+    mp->finished = false;
+    mp->seekTo = -1;
+    mp->rateChanged = false;
+    mp->time = 0;
+    mp->thread = std::thread( playback, mp, s );
+    return 0;
+}
+
+void libvlc_media_player_set_pause( libvlc_media_player_t* mp, int doPause )
+{
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    if ( mp->thread.joinable() == false || mp->finished == true )
+        return;
+    mp->paused = doPause != 0;
+    mp->cond.notify_all();
+}
+
+void libvlc_media_player_pause( libvlc_media_player_t* mp )
+{
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    if ( mp->thread.joinable() == false || mp->finished == true )
+        return;
+    mp->paused = !mp->paused;
+    mp->cond.notify_all();
+}
+
+void libvlc_media_player_stop( libvlc_media_player_t* mp )
+{
+    libvlc_media_t* md;
+    {
+        std::lock_guard<std::mutex> lock( mp->controlMutex );
+        if ( stopPlayback( mp ) == false )
+            return;
+        md = mp->media;
+        libvlc_media_retain( md );
+    }
+    setState( mp, md, libvlc_Stopped );
+    mp->send( libvlc_MediaPlayerStopped );
+    libvlc_media_release( md );
+}
+
+int libvlc_media_player_is_playing( libvlc_media_player_t* mp )
+{
+    return mp->state == libvlc_Playing;
+}
+
+int libvlc_media_player_will_play( libvlc_media_player_t* mp )
+{
+    std::lock_guard<std::mutex> lock( mp->controlMutex );
+    return mp->media != nullptr && mp->state != libvlc_Error;
+}
+
+libvlc_state_t libvlc_media_player_get_state( libvlc_media_player_t* mp )
+{
+    return mp->state;
+}
+
+libvlc_time_t libvlc_media_player_get_length( libvlc_media_player_t* mp )
+{
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    return mp->thread.joinable() == true ? mp->config.duration : -1;
+}
+
+libvlc_time_t libvlc_media_player_get_time( libvlc_media_player_t* mp )
+{
+    return mp->time;
+}
+
+void libvlc_media_player_set_time( libvlc_media_player_t* mp, libvlc_time_t time )
+{
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    mp->seekTo = std::max<libvlc_time_t>( time, 0 ) * 1000;
+    mp->cond.notify_all();
+}
+
+float libvlc_media_player_get_position( libvlc_media_player_t* mp )
+{
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    if ( mp->thread.joinable() == false || mp->config.duration <= 0 )
+        return -1.f;
+    return static_cast<float>( mp->time ) / mp->config.duration;
+}
+
+void libvlc_media_player_set_position( libvlc_media_player_t* mp, float position )
+{
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    mp->seekTo = static_cast<int64_t>( std::max( position, 0.f ) * mp->config.duration ) * 1000;
+    mp->cond.notify_all();
+}
+
+float libvlc_media_player_get_rate( libvlc_media_player_t* mp )
+{
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    return mp->rate;
+}
+
+int libvlc_media_player_set_rate( libvlc_media_player_t* mp, float rate )
+{
+    if ( rate <= 0.f )
+        return -1;
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    mp->rate = rate;
+    mp->rateChanged = true;
+    mp->cond.notify_all();
+    return 0;
+}
+
+float libvlc_media_player_get_fps( libvlc_media_player_t* mp )
+{
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    return static_cast<float>( mp->config.video_fps );
+}
+
+unsigned libvlc_media_player_has_vout( libvlc_media_player_t* mp )
+{
+    return mp->hasVout ? 1 : 0;
+}
+
+int libvlc_media_player_is_seekable( libvlc_media_player_t* mp )
+{
+    return mp->state == libvlc_Playing || mp->state == libvlc_Paused;
+}
+
+int libvlc_media_player_can_pause( libvlc_media_player_t* mp )
+{
+    return mp->state == libvlc_Playing || mp->state == libvlc_Paused;
+}
+
+/*
+ * Media list players
+ *
+ * As libvlc's, the list player keeps track of its current item by index, and
+ * moves to the following index when its media player reaches the end of the
+ * media.
+ */
+
+struct libvlc_media_list_player_t
+{
+    explicit libvlc_media_list_player_t( libvlc_instance_t* instance )
+        : refs( 1 )
+        , mp( libvlc_media_player_new( instance ) )
+        , list( nullptr )
+        , index( -1 )
+        , mode( libvlc_playback_mode_default )
+        , pendingAdvances( 0 )
+        , exiting( false )
+        , eventManager( this )
+    {
+        attachPlayer();
+        // EndReached is sent from the playback thread, which setting the
+        // next media would join, hence a thread to advance in the list
+        worker = std::thread( &libvlc_media_list_player_t::run, this );
+    }
+
+    ~libvlc_media_list_player_t()
+    {
+        {
+            std::lock_guard<std::mutex> lock( queueMutex );
+            exiting = true;
+            queueCond.notify_all();
+        }
+        worker.join();
+        detachPlayer();
+        libvlc_media_player_release( mp );
+        libvlc_media_list_release( list );
+    }
+
+    void attachPlayer()
+    {
+        libvlc_event_attach( libvlc_media_player_event_manager( mp ), libvlc_MediaPlayerEndReached,
+                             &libvlc_media_list_player_t::onEndReached, this );
+    }
+
+    void detachPlayer()
+    {
+        libvlc_event_detach( libvlc_media_player_event_manager( mp ), libvlc_MediaPlayerEndReached,
+                             &libvlc_media_list_player_t::onEndReached, this );
+    }
+
+    static void onEndReached( const libvlc_event_t*, void* data )
+    {
+        auto self = static_cast<libvlc_media_list_player_t*>( data );
+        std::lock_guard<std::mutex> lock( self->queueMutex );
+        ++self->pendingAdvances;
+        self->queueCond.notify_all();
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock( queueMutex );
+        while ( true )
+        {
+            queueCond.wait( lock, [this]() { return exiting == true || pendingAdvances > 0; } );
+            if ( exiting == true )
+                return;
+            --pendingAdvances;
+            lock.unlock();
+            advance();
+            lock.lock();
+        }
+    }
+
+    void advance()
+    {
+        std::lock_guard<std::recursive_mutex> lock( mutex );
+        if ( list == nullptr || index < 0 )
+            return;
+        auto next = mode == libvlc_playback_mode_repeat ? index : index + 1;
+        if ( next >= libvlc_media_list_count( list ) )
+        {
+            if ( mode != libvlc_playback_mode_loop )
+            {
+                auto e = makeEvent( libvlc_MediaListPlayerPlayed );
+                eventManager.send( e );
+                return;
+            }
+            next = 0;
+        }
+        playAt( next );
+    }
+
+    // Must be called with the lock held
+    int playAt( int i )
+    {
+        if ( list == nullptr )
+            return -1;
+        auto md = libvlc_media_list_item_at_index( list, i );
+        if ( md == nullptr )
+            return -1;
+        index = i;
+        libvlc_media_player_set_media( mp, md );
+        auto e = makeEvent( libvlc_MediaListPlayerNextItemSet );
+        e.u.media_list_player_next_item_set.item = md;
+        eventManager.send( e );
+        libvlc_media_player_play( mp );
+        libvlc_media_release( md );
+        return 0;
+    }
+
+    std::atomic<int> refs;
+    // Serializes the controls & the advances
+    std::recursive_mutex mutex;
+    libvlc_media_player_t* mp;
+    libvlc_media_list_t* list;
+    int index;
+    libvlc_playback_mode_t mode;
+
+    std::mutex queueMutex;
+    std::condition_variable queueCond;
+    unsigned int pendingAdvances;
+    bool exiting;
+    std::thread worker;
+    libvlc_event_manager_t eventManager;
+};
+
+libvlc_media_list_player_t* libvlc_media_list_player_new( libvlc_instance_t* instance )
+{
+    return new libvlc_media_list_player_t( instance );
+}
+
+void libvlc_media_list_player_retain( libvlc_media_list_player_t* mlp )
+{
+    ++mlp->refs;
+}
+
+void libvlc_media_list_player_release( libvlc_media_list_player_t* mlp )
+{
+    if ( mlp != nullptr && --mlp->refs == 0 )
+        delete mlp;
+}
+
+libvlc_event_manager_t* libvlc_media_list_player_event_manager( libvlc_media_list_player_t* mlp )
+{
+    return &mlp->eventManager;
+}
+
+void libvlc_media_list_player_set_media_player( libvlc_media_list_player_t* mlp,
+                                                libvlc_media_player_t* mp )
+{
+    std::lock_guard<std::recursive_mutex> lock( mlp->mutex );
+    mlp->detachPlayer();
+    libvlc_media_player_retain( mp );
+    libvlc_media_player_release( mlp->mp );
+    mlp->mp = mp;
+    mlp->attachPlayer();
+}
+
+void libvlc_media_list_player_set_media_list( libvlc_media_list_player_t* mlp,
+                                              libvlc_media_list_t* list )
+{
+    std::lock_guard<std::recursive_mutex> lock( mlp->mutex );
+    libvlc_media_list_retain( list );
+    libvlc_media_list_release( mlp->list );
+    mlp->list = list;
+}
+
+void libvlc_media_list_player_play( libvlc_media_list_player_t* mlp )
+{
+    std::lock_guard<std::recursive_mutex> lock( mlp->mutex );
+    if ( mlp->index < 0 )
+        mlp->playAt( 0 );
+    else
+        libvlc_media_player_play( mlp->mp );
+}
+
+void libvlc_media_list_player_pause( libvlc_media_list_player_t* mlp )
+{
+    libvlc_media_player_pause( mlp->mp );
+}
+
+int libvlc_media_list_player_is_playing( libvlc_media_list_player_t* mlp )
+{
+    return libvlc_media_player_is_playing( mlp->mp );
+}
+
+libvlc_state_t libvlc_media_list_player_get_state( libvlc_media_list_player_t* mlp )
+{
+    return libvlc_media_player_get_state( mlp->mp );
+}
+
+int libvlc_media_list_player_play_item_at_index( libvlc_media_list_player_t* mlp, int index )
+{
+    std::lock_guard<std::recursive_mutex> lock( mlp->mutex );
+    return mlp->playAt( index );
+}
+
+int libvlc_media_list_player_play_item( libvlc_media_list_player_t* mlp, libvlc_media_t* md )
+{
+    std::lock_guard<std::recursive_mutex> lock( mlp->mutex );
+    if ( mlp->list == nullptr )
+        return -1;
+    auto index = libvlc_media_list_index_of_item( mlp->list, md );
+    if ( index < 0 )
+        return -1;
+    return mlp->playAt( index );
+}
+
+void libvlc_media_list_player_stop( libvlc_media_list_player_t* mlp )
+{
+    std::lock_guard<std::recursive_mutex> lock( mlp->mutex );
+    libvlc_media_player_stop( mlp->mp );
+    mlp->index = -1;
+    auto e = makeEvent( libvlc_MediaListPlayerStopped );
+    mlp->eventManager.send( e );
+}
+
+int libvlc_media_list_player_next( libvlc_media_list_player_t* mlp )
+{
+    std::lock_guard<std::recursive_mutex> lock( mlp->mutex );
+    return mlp->playAt( mlp->index + 1 );
+}
+
+int libvlc_media_list_player_previous( libvlc_media_list_player_t* mlp )
+{
+    std::lock_guard<std::recursive_mutex> lock( mlp->mutex );
+    return mlp->playAt( mlp->index - 1 );
+}
+
+void libvlc_media_list_player_set_playback_mode( libvlc_media_list_player_t* mlp,
+                                                 libvlc_playback_mode_t mode )
+{
+    std::lock_guard<std::recursive_mutex> lock( mlp->mutex );
+    mlp->mode = mode;
+}
+
+/*
+ * Video & audio outputs
+ */
+
+void libvlc_video_set_callbacks( libvlc_media_player_t* mp, libvlc_video_lock_cb lock,
+                                 libvlc_video_unlock_cb unlock, libvlc_video_display_cb display,
+                                 void* opaque )
+{
+    std::lock_guard<std::mutex> l( mp->mutex );
+    mp->outputs.lock = lock;
+    mp->outputs.unlock = unlock;
+    mp->outputs.display = display;
+    mp->outputs.videoOpaque = opaque;
+}
+
+void libvlc_video_set_format( libvlc_media_player_t* mp, const char* chroma,
+                              unsigned width, unsigned height, unsigned )
+{
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    strncpy( mp->outputs.chroma, chroma, 4 );
+    mp->outputs.width = width;
+    mp->outputs.height = height;
+}
+
+void libvlc_video_set_format_callbacks( libvlc_media_player_t* mp, libvlc_video_format_cb setup,
+                                        libvlc_video_cleanup_cb cleanup )
+{
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    mp->outputs.videoFormat = setup;
+    mp->outputs.videoCleanup = cleanup;
+}
+
+int libvlc_video_get_size( libvlc_media_player_t* mp, unsigned num, unsigned* width, unsigned* height )
+{
+    if ( num != 0 || mp->hasVout == false )
+        return -1;
+    *width = mp->videoWidth;
+    *height = mp->videoHeight;
+    return 0;
+}
+
+int libvlc_video_get_track_count( libvlc_media_player_t* mp )
+{
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    return mp->config.video_fps > 0 ? 2 : 0;
+}
+
+libvlc_track_description_t* libvlc_video_get_track_description( libvlc_media_player_t* mp )
+{
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    return mp->config.video_fps > 0 ? makeTrackDescriptions( 0, "Track 1" ) : nullptr;
+}
+
+int libvlc_video_get_track( libvlc_media_player_t* mp )
+{
+    return mp->videoTrack;
+}
+
+int libvlc_video_set_track( libvlc_media_player_t* mp, int track )
+{
+    mp->videoTrack = track;
+    return 0;
+}
+
+void libvlc_audio_set_callbacks( libvlc_media_player_t* mp, libvlc_audio_play_cb play,
+                                 libvlc_audio_pause_cb pause, libvlc_audio_resume_cb resume,
+                                 libvlc_audio_flush_cb flush, libvlc_audio_drain_cb drain,
+                                 void* opaque )
+{
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    mp->outputs.play = play;
+    mp->outputs.pause = pause;
+    mp->outputs.resume = resume;
+    mp->outputs.flush = flush;
+    mp->outputs.drain = drain;
+    mp->outputs.audioOpaque = opaque;
+}
+
+void libvlc_audio_set_volume_callback( libvlc_media_player_t* mp, libvlc_audio_set_volume_cb volume )
+{
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    mp->outputs.volume = volume;
+}
+
+void libvlc_audio_set_format_callbacks( libvlc_media_player_t* mp, libvlc_audio_setup_cb setup,
+                                        libvlc_audio_cleanup_cb cleanup )
+{
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    mp->outputs.audioSetup = setup;
+    mp->outputs.audioCleanup = cleanup;
+}
+
+void libvlc_audio_set_format( libvlc_media_player_t* mp, const char* format,
+                              unsigned rate, unsigned channels )
+{
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    strncpy( mp->outputs.format, format, 4 );
+    mp->outputs.rate = rate;
+    mp->outputs.channels = channels;
+}
+
+int libvlc_audio_get_volume( libvlc_media_player_t* mp )
+{
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    return mp->volume;
+}
+
+int libvlc_audio_set_volume( libvlc_media_player_t* mp, int volume )
+{
+    if ( volume < 0 || volume > 200 )
+        return -1;
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    mp->volume = volume;
+    mp->volumeChanged = true;
+    mp->cond.notify_all();
+    return 0;
+}
+
+int libvlc_audio_get_mute( libvlc_media_player_t* mp )
+{
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    return mp->mute ? 1 : 0;
+}
+
+void libvlc_audio_set_mute( libvlc_media_player_t* mp, int mute )
+{
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    mp->mute = mute != 0;
+    mp->volumeChanged = true;
+    mp->cond.notify_all();
+}
+
+void libvlc_audio_toggle_mute( libvlc_media_player_t* mp )
+{
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    mp->mute = !mp->mute;
+    mp->volumeChanged = true;
+    mp->cond.notify_all();
+}
+
+int libvlc_audio_get_track_count( libvlc_media_player_t* mp )
+{
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    return mp->config.audio_rate > 0 ? 2 : 0;
+}
+
+libvlc_track_description_t* libvlc_audio_get_track_description( libvlc_media_player_t* mp )
+{
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    return mp->config.audio_rate > 0 ? makeTrackDescriptions( 1, "Track 1 - [English]" ) : nullptr;
+}
+
+int libvlc_audio_get_track( libvlc_media_player_t* mp )
+{
+    return mp->audioTrack;
+}
+
+int libvlc_audio_set_track( libvlc_media_player_t* mp, int track )
+{
+    mp->audioTrack = track;
+    return 0;
+}
+
+void libvlc_track_description_list_release( libvlc_track_description_t* list )
+{
+    while ( list != nullptr )
+    {
+        auto next = list->p_next;
+        free( list->psz_name );
+        free( list );
+        list = next;
+    }
+}
+
+libvlc_audio_output_device_t* libvlc_audio_output_device_list_get( libvlc_instance_t*, const char* )
+{
+    ++stats().audioDeviceEnums;
+    std::vector<std::string> devices;
+    {
+        std::lock_guard<std::mutex> lock( defaultConfigMutex() );
+        devices = audioDevicesLocked();
+    }
+    libvlc_audio_output_device_t* head = nullptr;
+    for ( auto it = devices.rbegin(); it != devices.rend(); ++it )
+    {
+        auto d = static_cast<libvlc_audio_output_device_t*>( calloc( 1, sizeof( libvlc_audio_output_device_t ) ) );
+        if ( d == nullptr )
+            break;
+        d->psz_device = duplicate( *it );
+        d->psz_description = duplicate( "Mock device " + *it );
+        d->p_next = head;
+        head = d;
+    }
+    return head;
+}
+
+libvlc_audio_output_device_t* libvlc_audio_output_device_enum( libvlc_media_player_t* )
+{
+    return libvlc_audio_output_device_list_get( nullptr, nullptr );
+}
+
+void libvlc_audio_output_device_list_release( libvlc_audio_output_device_t* list )
+{
+    while ( list != nullptr )
+    {
+        auto next = list->p_next;
+        free( list->psz_device );
+        free( list->psz_description );
+        free( list );
+        list = next;
+    }
+}
+
+/*
+ * Equalizer
+ */
+
+struct libvlc_equalizer_t
+{
+    explicit libvlc_equalizer_t( const EqualizerSettings& s )
+        : settings( s )
+    {
+        ++stats().equalizers;
+    }
+
+    ~libvlc_equalizer_t()
+    {
+        --stats().equalizers;
+    }
+
+    EqualizerSettings settings;
+};
+
+namespace
+{
+
+const float EqualizerFrequencies[EqualizerBands] = {
+    60.f, 170.f, 310.f, 600.f, 1000.f, 3000.f, 6000.f, 12000.f, 14000.f, 16000.f
+};
+
+struct EqualizerPreset
+{
+    const char* name;
+    EqualizerSettings settings;
+};
+
+// A few of the libvlc presets
+const EqualizerPreset EqualizerPresets[] = {
+    { "Flat", { 12.f, {{ 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f }} } },
+    { "Classical", { 12.f, {{ 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, -7.2f, -7.2f, -7.2f, -9.6f }} } },
+    { "Rock", { 5.6f, {{ 8.f, 4.8f, -5.6f, -8.f, -3.2f, 4.f, 8.8f, 11.2f, 11.2f, 11.2f }} } },
+};
+
+const unsigned int NbEqualizerPresets = sizeof( EqualizerPresets ) / sizeof( EqualizerPresets[0] );
+
+float clampAmp( float amp )
+{
+    return std::max( -20.f, std::min( 20.f, amp ) );
+}
+
+} // anonymous namespace
+
+unsigned libvlc_audio_equalizer_get_preset_count()
+{
+    return NbEqualizerPresets;
+}
+
+const char* libvlc_audio_equalizer_get_preset_name( unsigned index )
+{
+    return index < NbEqualizerPresets ? EqualizerPresets[index].name : nullptr;
+}
+
+unsigned libvlc_audio_equalizer_get_band_count()
+{
+    return EqualizerBands;
+}
+
+float libvlc_audio_equalizer_get_band_frequency( unsigned index )
+{
+    return index < EqualizerBands ? EqualizerFrequencies[index] : -1.f;
+}
+
+libvlc_equalizer_t* libvlc_audio_equalizer_new()
+{
+    return new libvlc_equalizer_t( EqualizerSettings{} );
+}
+
+libvlc_equalizer_t* libvlc_audio_equalizer_new_from_preset( unsigned index )
+{
+    if ( index >= NbEqualizerPresets )
+        return nullptr;
+    return new libvlc_equalizer_t( EqualizerPresets[index].settings );
+}
+
+void libvlc_audio_equalizer_release( libvlc_equalizer_t* equalizer )
+{
+    delete equalizer;
+}
+
+int libvlc_audio_equalizer_set_preamp( libvlc_equalizer_t* equalizer, float preamp )
+{
+    equalizer->settings.preamp = clampAmp( preamp );
+    return 0;
+}
+
+float libvlc_audio_equalizer_get_preamp( libvlc_equalizer_t* equalizer )
+{
+    return equalizer->settings.preamp;
+}
+
+int libvlc_audio_equalizer_set_amp_at_index( libvlc_equalizer_t* equalizer, float amp, unsigned band )
+{
+    if ( band >= EqualizerBands )
+        return -1;
+    equalizer->settings.amps[band] = clampAmp( amp );
+    return 0;
+}
+
+float libvlc_audio_equalizer_get_amp_at_index( libvlc_equalizer_t* equalizer, unsigned band )
+{
+    if ( band >= EqualizerBands )
+        return NAN;
+    return equalizer->settings.amps[band];
+}
+
+int libvlc_media_player_set_equalizer( libvlc_media_player_t* mp, libvlc_equalizer_t* equalizer )
+{
+    std::lock_guard<std::mutex> lock( mp->mutex );
+    mp->hasEqualizer = equalizer != nullptr;
+    if ( equalizer != nullptr )
+        mp->equalizer = equalizer->settings;
+    return 0;
+}
@@ -0,0 +1,1003 @@
+/*****************************************************************************
+ * regressions.cpp: Regression tests running against the mock libvlc
+ *****************************************************************************
+ * Copyright © 2015 libvlcpp authors & VideoLAN
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Each test drives the wrappers through the mock libvlc, which makes the
+ * event sequences deterministic. Build with -DVLCPP_MOCK_LIBVLC=ON, and run
+ * with ctest, or:
+ *
+ * usage: vlcpp_mock_tests [test name substring]
+ */
+
+#include "vlcpp/vlc.hpp"
+#include "vlcmock.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+int failures = 0;
+
+#define CHECK( cond ) \
+    do { \
+        if ( !( cond ) ) \
+        { \
+            fprintf( stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond ); \
+            ++failures; \
+        } \
+    } while ( 0 )
+
+// A stream without outputs, lasting duration ms
+vlcmock_stream_config_t shortStream( int64_t duration )
+{
+    vlcmock_stream_config_t cfg;
+    vlcmock_stream_config_init( &cfg );
+    cfg.video_fps = 0.;
+    cfg.audio_rate = 0;
+    cfg.time_changed_rate = 0.;
+    cfg.duration = duration;
+    return cfg;
+}
+
+template <typename Pred>
+bool waitFor( Pred pred, std::chrono::milliseconds timeout = std::chrono::seconds( 5 ) )
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while ( pred() == false )
+    {
+        if ( std::chrono::steady_clock::now() > deadline )
+            return false;
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    }
+    return true;
+}
+
+void sendTimeChanged( libvlc_event_manager_t* em, libvlc_time_t time )
+{
+    libvlc_event_t e;
+    memset( &e, 0, sizeof( e ) );
+    e.type = libvlc_MediaPlayerTimeChanged;
+    e.u.media_player_time_changed.new_time = time;
+    vlcmock_event_send( em, &e );
+}
+
+// Sends the time events of the ongoing playback, 40ms apart, until a time
+void playUntil( libvlc_event_manager_t* em, libvlc_time_t from, libvlc_time_t to )
+{
+    for ( auto t = from + 40; t <= to; t += 40 )
+    {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 40 ) );
+        sendTimeChanged( em, t );
+    }
+}
+
+int64_t liveMedias()
+{
+    vlcmock_stats_t s;
+    vlcmock_get_stats( &s );
+    return s.medias;
+}
+
+/*
+ * Plays a playlist much longer than the window through a MediaListPlayer:
+ * every entry must be played once and in order, while the window keeps a
+ * bounded number of materialized media.
+ */
+void virtualMediaListWindowIsBounded()
+{
+    const unsigned int Lookahead = 2;
+    const unsigned int History = 1;
+    const int NbEntries = 500;
+
+    auto cfg = shortStream( 1 );
+    vlcmock_set_default_stream_config( &cfg );
+    VLC::Instance instance( 0, nullptr );
+    VLC::VirtualMediaList list( instance, Lookahead, History );
+    for ( auto i = 0; i < NbEntries; ++i )
+        list.add( "mock://" + std::to_string( i ) );
+    auto medias = liveMedias();
+
+    VLC::MediaListPlayer mlp( instance );
+    list.attach( mlp );
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool done = false;
+    std::vector<std::string> played;
+    int64_t maxMedias = 0;
+    int maxMaterialized = 0;
+    {
+        VLC::MediaListPlayerEventManager em( mlp.eventManager() );
+        em.onNextItemSet( [&]( VLC::MediaPtr md ) {
+            int materialized = 0;
+            for ( auto& m : list.window().lockedView() )
+            {
+                if ( m.mrl() != "vlc://nop" )
+                    ++materialized;
+            }
+            std::lock_guard<std::mutex> lock( mutex );
+            played.push_back( md->mrl() );
+            maxMedias = std::max( maxMedias, liveMedias() - medias );
+            maxMaterialized = std::max( maxMaterialized, materialized );
+        });
+        em.onPlayed( [&]() {
+            std::lock_guard<std::mutex> lock( mutex );
+            done = true;
+            cond.notify_all();
+        });
+        list.playAt( mlp, 0 );
+        std::unique_lock<std::mutex> lock( mutex );
+        CHECK( cond.wait_for( lock, std::chrono::seconds( 30 ), [&done]() { return done; } ) );
+    }
+    mlp.stop();
+    list.detach();
+
+    CHECK( played.size() == NbEntries );
+    for ( size_t i = 0; i < played.size(); ++i )
+        CHECK( played[i] == "mock://" + std::to_string( i ) );
+    CHECK( maxMaterialized <= (int)( History + 1 + Lookahead ) );
+    // The window & its placeholder, the player's media and the event's one
+    CHECK( maxMedias <= History + 1 + Lookahead + 3 );
+}
+
+/*
+ * libvlc invokes the cleanup callbacks while the player is being released,
+ * so the callbacks must outlive the last wrapper, whether it is destroyed
+ * on the calling thread or by the reaper.
+ */
+void playerReleasedWhilePlayingWithCallbacks()
+{
+    auto cfg = shortStream( 1000 * 1000 );
+    cfg.video_fps = 1000.;
+    vlcmock_set_default_stream_config( &cfg );
+    VLC::Instance instance( 0, nullptr );
+    VLC::Media media( instance, "mock://clip", VLC::Media::FromLocation );
+
+    for ( auto async : { false, true } )
+    {
+        std::atomic<int> frames( 0 );
+        std::atomic<int> cleanups( 0 );
+        auto token = std::make_shared<int>( 0 );
+        std::weak_ptr<int> weakToken = token;
+        std::vector<char> buffer( cfg.video_width * cfg.video_height * 4 );
+        {
+            VLC::MediaPlayer mp( media );
+            mp.setVideoFormatCallbacks( [&cfg]( char* chroma, uint32_t* width, uint32_t* height,
+                                                uint32_t* pitch, uint32_t* lines ) -> int {
+                memcpy( chroma, "RV32", 4 );
+                *width = cfg.video_width;
+                *height = cfg.video_height;
+                *pitch = *width * 4;
+                *lines = *height;
+                return 1;
+            }, [&cleanups, token]() {
+                ++cleanups;
+            });
+            token.reset();
+            mp.setVideoCallbacks( [&buffer]( void** planes ) -> void* {
+                planes[0] = buffer.data();
+                return nullptr;
+            }, [&frames]( void*, void* const* ) {
+                ++frames;
+            }, [&frames]( void* ) {
+                ++frames;
+            });
+            mp.play();
+            CHECK( waitFor( [&frames]() { return frames > 100; } ) );
+            if ( async == true )
+            {
+                // Drop the other references first, so the reaper holds the last one
+                auto copy = mp;
+                mp = VLC::MediaPlayer();
+                copy.releaseAsync().wait();
+            }
+        }
+        CHECK( cleanups == 1 );
+        CHECK( weakToken.expired() );
+    }
+}
+
+/*
+ * A throwing task must neither take the reaper thread down, nor be lost
+ */
+void reaperForwardsExceptions()
+{
+    VLC::Reaper reaper( 1 );
+    auto failed = reaper.post( []() {
+        throw std::runtime_error( "failure" );
+    });
+    bool thrown = false;
+    try
+    {
+        failed.get();
+    }
+    catch ( const std::runtime_error& )
+    {
+        thrown = true;
+    }
+    CHECK( thrown == true );
+    bool ran = false;
+    reaper.post( [&ran]() { ran = true; } ).wait();
+    CHECK( ran == true );
+    // The captures are released by the time the future is ready
+    auto token = std::make_shared<int>( 0 );
+    std::weak_ptr<int> weakToken = token;
+    auto done = reaper.post( [token]() {} );
+    token.reset();
+    done.wait();
+    CHECK( weakToken.expired() == true );
+}
+
+/*
+ * The time events sent before a seek takes effect must neither complete it,
+ * nor let the following requests through.
+ */
+void seekControllerIgnoresPreSeekTimes()
+{
+    VLC::Instance instance( 0, nullptr );
+    VLC::MediaPlayer mp( instance );
+    auto em = libvlc_media_player_event_manager( mp );
+    VLC::SeekController seek( mp, VLC::SeekController::Policy::Fast, std::chrono::seconds( 10 ), 100 );
+    auto issued = [&seek]( uint64_t n ) {
+        return waitFor( [&seek, n]() { return seek.stats().issued == n; } );
+    };
+
+    sendTimeChanged( em, 1000 );
+    seek.seekTo( 60000 );
+    CHECK( issued( 1 ) );
+    playUntil( em, 1000, 1200 );
+    CHECK( seek.isSeeking() == true );
+    CHECK( seek.stats().completed == 0 );
+    seek.seekTo( 30000 );
+    seek.seekTo( 40000 );
+    playUntil( em, 1200, 1400 );
+    CHECK( seek.stats().issued == 1 );
+    // A fast seek lands on a keyframe, rather than on the target
+    sendTimeChanged( em, 58000 );
+    CHECK( issued( 2 ) );
+    auto stats = seek.stats();
+    CHECK( stats.completed == 1 );
+    CHECK( stats.coalesced == 1 );
+
+    // Backward
+    playUntil( em, 58000, 58200 );
+    CHECK( seek.stats().completed == 1 );
+    sendTimeChanged( em, 39000 );
+    CHECK( waitFor( [&seek]() { return seek.isSeeking() == false; } ) );
+    CHECK( seek.stats().completed == 2 );
+
+    // The player isn't playing, hence no length to resolve the target
+    seek.seekToPosition( .5f );
+    CHECK( issued( 3 ) );
+    playUntil( em, 39000, 39200 );
+    CHECK( seek.stats().completed == 2 );
+    sendTimeChanged( em, 90000 );
+    CHECK( waitFor( [&seek]() { return seek.isSeeking() == false; } ) );
+    stats = seek.stats();
+    CHECK( stats.completed == 3 );
+    CHECK( stats.timeouts == 0 );
+}
+
+/*
+ * libvlc drops the audio played above 4x, so a decode session with an audio
+ * sink must never play faster, while video only sessions use the maximum.
+ */
+void decodeSessionCapsAudioRate()
+{
+    VLC::Instance instance( 0, nullptr );
+    VLC::Media media( instance, "mock://clip", VLC::Media::FromLocation );
+
+    VLC::DecodeSession video( instance, media );
+    video.setVideoSink( []( void** ) -> void* { return nullptr; }, nullptr, nullptr );
+    CHECK( video.rate() == VLC::DecodeSession::MaxRate );
+    video.setRate( 8.f );
+    CHECK( video.rate() == 8.f );
+
+    VLC::DecodeSession audio( instance, media );
+    audio.setAudioSink( []( const void*, unsigned int, int64_t ) {},
+                        nullptr, nullptr, nullptr, nullptr );
+    CHECK( audio.rate() == VLC::DecodeSession::MaxAudioRate );
+    audio.setRate( VLC::DecodeSession::MaxRate );
+    CHECK( audio.rate() == VLC::DecodeSession::MaxAudioRate );
+    audio.setRate( 2.f );
+    CHECK( audio.rate() == 2.f );
+    // Unmodified samples
+    audio.setRate( 1.f );
+    CHECK( audio.rate() == 1.f );
+}
+
+/*
+ * Readers racing with the invalidations must always get a complete snapshot,
+ * while the replaced ones get freed. Meant to run under ASan & TSan.
+ */
+void trackDescriptionCacheConcurrentReads()
+{
+    // An audio and a video track
+    vlcmock_stream_config_t cfg;
+    vlcmock_stream_config_init( &cfg );
+    vlcmock_set_default_stream_config( &cfg );
+    VLC::Instance instance( 0, nullptr );
+    VLC::MediaPlayer mp( instance );
+    auto em = libvlc_media_player_event_manager( mp );
+    VLC::TrackDescriptionCache cache( mp );
+
+    std::atomic<bool> stop( false );
+    std::atomic<int> empty( 0 );
+    std::atomic<uint64_t> reads( 0 );
+    std::vector<std::thread> readers;
+    for ( auto i = 0; i < 4; ++i )
+    {
+        readers.emplace_back( [&]() {
+            while ( stop == false )
+            {
+                auto audio = cache.audioTracks();
+                auto video = cache.videoTracks();
+                if ( audio == nullptr || audio->empty() || video == nullptr || video->empty() )
+                    ++empty;
+                ++reads;
+            }
+        });
+    }
+    libvlc_event_t e;
+    memset( &e, 0, sizeof( e ) );
+    e.type = libvlc_MediaPlayerESAdded;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( 200 );
+    for ( auto i = 0; std::chrono::steady_clock::now() < deadline; ++i )
+    {
+        e.u.media_player_es_changed.i_type = i % 2 ? libvlc_track_audio : libvlc_track_video;
+        vlcmock_event_send( em, &e );
+        if ( i % 16 == 0 )
+            cache.invalidate();
+        std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+    }
+    stop = true;
+    for ( auto& t : readers )
+        t.join();
+    CHECK( empty == 0 );
+    CHECK( reads > 0 );
+}
+
+uint64_t audioDeviceEnums()
+{
+    vlcmock_stats_t s;
+    vlcmock_get_stats( &s );
+    return s.audio_device_enums;
+}
+
+/*
+ * The device lists enumerated through a player are cached and refreshed like
+ * the instance ones, and the shared registry is shared per instance.
+ */
+void audioOutputDeviceRegistryCachesPlayerDevices()
+{
+    VLC::Instance instance( 0, nullptr );
+    auto registry = VLC::AudioOutputDeviceRegistry::shared( instance );
+    CHECK( VLC::AudioOutputDeviceRegistry::shared( instance ) == registry );
+    VLC::Instance other( 0, nullptr );
+    CHECK( VLC::AudioOutputDeviceRegistry::shared( other ) != registry );
+
+    std::vector<std::string> notified;
+    registry->addListener( [&notified]( const std::string& aout,
+                                        VLC::AudioOutputDeviceRegistry::Devices ) {
+        notified.push_back( aout );
+    });
+    const char* first[] = { "default", "hdmi" };
+    vlcmock_set_audio_devices( first, 2 );
+    VLC::MediaPlayer mp( instance );
+    auto enums = audioDeviceEnums();
+    auto devices = registry->devices( mp, "pulse" );
+    CHECK( devices->size() == 2 );
+    CHECK( registry->devices( mp, "pulse" ) == devices );
+    CHECK( registry->devices( "alsa" )->size() == 2 );
+    CHECK( audioDeviceEnums() == enums + 2 );
+
+    registry->refresh();
+    CHECK( notified.empty() );
+    const char* second[] = { "default" };
+    vlcmock_set_audio_devices( second, 1 );
+    registry->refresh();
+    CHECK( notified.size() == 2 );
+    CHECK( registry->devices( mp, "pulse" )->size() == 1 );
+
+    // Without a live player, the list is kept
+    mp = VLC::MediaPlayer();
+    vlcmock_set_audio_devices( first, 2 );
+    registry->refresh();
+    CHECK( notified.size() == 3 && notified.back() == "alsa" );
+    vlcmock_set_audio_devices( first, 1 );
+
+    std::weak_ptr<VLC::AudioOutputDeviceRegistry> weak = registry;
+    registry.reset();
+    CHECK( weak.expired() );
+}
+
+/*
+ * A failed creation must be reported once, not cached for the process
+ * lifetime, while a successful one is shared.
+ */
+void instanceProviderRetriesFailures()
+{
+    VLC::InstanceProvider provider;
+    const VLC::InstanceProvider::Arguments args{ "--verbose=0" };
+    vlcmock_fail_instances( 1 );
+    bool thrown = false;
+    try
+    {
+        provider.get( args ).get();
+    }
+    catch ( const std::runtime_error& )
+    {
+        thrown = true;
+    }
+    CHECK( thrown == true );
+    auto instance = provider.get( args ).get();
+    CHECK( instance.isValid() == true );
+    CHECK( provider.get( args ).get() == instance );
+    CHECK( provider.timings( args ).ready == true );
+}
+
+/*
+ * Weak handles are equal, ordered & hashed by object address, whichever
+ * wrapper they were created from.
+ */
+void weakHandleComparesAddresses()
+{
+    VLC::Instance instance( 0, nullptr );
+    VLC::Media first( instance, "mock://first", VLC::Media::FromLocation );
+    VLC::Media second( instance, "mock://second", VLC::Media::FromLocation );
+    VLC::WeakHandle<VLC::Media> weakFirst( first );
+    VLC::WeakHandle<VLC::Media> weakSecond( second );
+
+    // A wrapper rebuilt around the same object, rather than a copy
+    auto rebuilt = weakFirst.lock();
+    CHECK( rebuilt.isValid() == true && rebuilt == first );
+    VLC::WeakHandle<VLC::Media> weakRebuilt( rebuilt );
+    CHECK( weakRebuilt == weakFirst );
+    CHECK( ( weakRebuilt < weakFirst ) == false && ( weakFirst < weakRebuilt ) == false );
+    CHECK( std::hash<VLC::WeakHandle<VLC::Media>>()( weakRebuilt ) ==
+           std::hash<VLC::WeakHandle<VLC::Media>>()( weakFirst ) );
+    CHECK( weakFirst != weakSecond );
+    // Wrapping the raw object again creates another owner
+    VLC::Media alias( first.get(), true );
+    VLC::WeakHandle<VLC::Media> weakAlias( alias );
+    CHECK( weakAlias == weakFirst );
+    CHECK( ( weakAlias < weakFirst ) == false && ( weakFirst < weakAlias ) == false );
+    CHECK( ( weakFirst < weakSecond ) == ( first.get() < second.get() ) );
+
+    std::map<VLC::WeakHandle<VLC::Media>, int> map;
+    map[weakFirst] = 1;
+    map[weakRebuilt] = 2;
+    map[weakSecond] = 3;
+    CHECK( map.size() == 2 && map[weakFirst] == 2 );
+
+    VLC::MediaPlayer mp( instance );
+    VLC::WeakHandle<VLC::MediaPlayer> weakPlayer( mp );
+    CHECK( weakPlayer.lock() == mp );
+    // The callbacks can be set through a locked player
+    auto cfg = shortStream( 1000 );
+    cfg.video_fps = 1000.;
+    vlcmock_media_player_set_stream_config( mp, &cfg );
+    std::atomic<int> frames( 0 );
+    std::array<uint8_t, 4> pixels;
+    {
+        auto locked = weakPlayer.lock();
+        locked.setVideoCallbacks( [&pixels]( void** planes ) -> void* {
+            planes[0] = pixels.data();
+            return nullptr;
+        }, nullptr, [&frames]( void* ) {
+            ++frames;
+        });
+        locked.setVideoFormat( "RV32", 1, 1, 4 );
+    }
+    VLC::Media clip( instance, "mock://clip", VLC::Media::FromLocation );
+    mp.setMedia( clip );
+    mp.play();
+    CHECK( waitFor( [&frames]() { return frames > 0; } ) );
+    mp.stopAsync().wait();
+    rebuilt = VLC::Media();
+    alias = VLC::Media();
+    first = VLC::Media();
+    CHECK( weakFirst.expired() == true );
+    CHECK( weakFirst.lock().isValid() == false );
+}
+
+/*
+ * The titles, durations and options of each format are read, whatever the
+ * case of the file extension.
+ */
+void playlistParserReadsEntries()
+{
+    struct Playlist
+    {
+        const char* path;
+        const char* content;
+        int64_t duration;
+        size_t nbOptions;
+    };
+    const Playlist playlists[] = {
+        { "vlcpp_playlist_test.M3U",
+          "#EXTM3U\n"
+          "#EXTINF:12.5,First, with a comma\r\n"
+          "#EXTVLCOPT:start-time=3\n"
+          "mock://first\n"
+          "#EXTINF:-1,Second\n"
+          "relative/second\n", 12500, 1 },
+        { "vlcpp_playlist_test.Pls",
+          "[playlist]\n"
+          "File2=relative/second\n"
+          "Title1=First, with a comma\n"
+          "File1=mock://first\n"
+          "Length1=12\n"
+          "NumberOfEntries=2\n", 12000, 0 },
+        { "vlcpp_playlist_test.xspf",
+          "<?xml version=\"1.0\"?>\n"
+          "<playlist version=\"1\"><trackList>\n"
+          "<track><location>mock://first</location><title>First, with a comma</title>"
+          "<duration>12500</duration></track>\n"
+          "<track><location>relative/second</location></track>\n"
+          "</trackList></playlist>\n", 12500, 0 },
+    };
+    VLC::PlaylistParser parser( 2 );
+    VLC::Instance instance( 0, nullptr );
+    for ( const auto& p : playlists )
+    {
+        {
+            std::ofstream f( p.path, std::ios::binary );
+            f << p.content;
+        }
+        auto entries = parser.parse( p.path );
+        CHECK( entries.size() == 2 );
+        if ( entries.size() == 2 )
+        {
+            CHECK( entries[0].mrl() == "mock://first" && entries[0].type() == VLC::Media::FromLocation );
+            CHECK( entries[0].title() == "First, with a comma" );
+            CHECK( entries[0].duration() == p.duration );
+            CHECK( entries[0].options().size() == p.nbOptions );
+            CHECK( entries[1].mrl() == "relative/second" && entries[1].type() == VLC::Media::FromPath );
+            CHECK( entries[1].duration() == -1 );
+        }
+
+        VLC::MediaList list( instance );
+        CHECK( parser.load( instance, list, p.path ) == 2 );
+        VLC::MediaList::Lock lock( list );
+        CHECK( list.count() == 2 );
+        if ( list.count() > 0 )
+            CHECK( list.itemAtIndex( 0 )->meta( libvlc_meta_Title ) == "First, with a comma" );
+        std::remove( p.path );
+    }
+}
+
+/*
+ * The decorated output callbacks can be given to the player, and timestamp
+ * the first frame and samples of each session.
+ */
+void startupProbeRecordsFirstOutputs()
+{
+    auto cfg = shortStream( 1000 );
+    cfg.video_fps = 100.;
+    cfg.audio_rate = 48000;
+    cfg.audio_channels = 2;
+    VLC::Instance instance( 0, nullptr );
+    VLC::Media media( instance, "mock://clip", VLC::Media::FromLocation );
+    VLC::MediaPlayer mp( media );
+    std::array<uint8_t, 4> pixels;
+    std::atomic<int> frames( 0 );
+    std::atomic<int> buffers( 0 );
+    VLC::StartupProbe probe( mp );
+    mp.setVideoCallbacks( probe.videoLock( [&pixels]( void** planes ) -> void* {
+        planes[0] = pixels.data();
+        return nullptr;
+    }), nullptr, probe.videoDisplay( [&frames]( void* ) {
+        ++frames;
+    }));
+    mp.setVideoFormat( "RV32", 1, 1, 4 );
+    mp.setAudioCallbacks( probe.audioPlay( [&buffers]( const void*, unsigned int, int64_t ) {
+        ++buffers;
+    }), nullptr, nullptr, nullptr, nullptr );
+    mp.setAudioFormat( "S16N", 48000, 2 );
+
+    using Stage = VLC::StartupProbe::Stage;
+    for ( auto i = 0; i < 2; ++i )
+    {
+        vlcmock_media_player_set_stream_config( mp, &cfg );
+        frames = 0;
+        buffers = 0;
+        CHECK( probe.play() == 0 );
+        CHECK( waitFor( [&frames, &buffers]() { return frames > 0 && buffers > 0; } ) );
+        auto session = probe.session();
+        CHECK( session[Stage::Play] >= 0 && session[Stage::Opening] >= session[Stage::Play] );
+        CHECK( session[Stage::FirstVideoLock] >= session[Stage::Play] );
+        CHECK( session[Stage::FirstVideoDisplay] >= session[Stage::FirstVideoLock] );
+        CHECK( session[Stage::FirstAudioPlay] >= session[Stage::Play] );
+        mp.stopAsync().wait();
+    }
+    CHECK( probe.sessionCount() == 2 );
+    CHECK( probe.histogram( Stage::FirstVideoDisplay ).count == 2 );
+    CHECK( probe.histogram( Stage::FirstAudioPlay ).count == 2 );
+}
+
+/*
+ * The mirror follows the player events, and readers racing with them always
+ * get a snapshot no older than the previous one. Meant to run under TSan.
+ */
+void playerStateMirrorFollowsEvents()
+{
+    auto cfg = shortStream( 200 );
+    cfg.time_changed_rate = 1000.;
+    VLC::Instance instance( 0, nullptr );
+    VLC::Media media( instance, "mock://clip", VLC::Media::FromLocation );
+    VLC::MediaPlayer mp( media );
+    VLC::PlayerStateMirror mirror( mp );
+    CHECK( mirror.state() == libvlc_NothingSpecial );
+
+    std::atomic<bool> stop( false );
+    std::atomic<int> regressions( 0 );
+    std::thread reader( [&mirror, &stop, &regressions]() {
+        uint32_t version = 0;
+        while ( stop == false )
+        {
+            auto s = mirror.snapshot();
+            if ( s.version < version )
+                ++regressions;
+            version = s.version;
+        }
+    });
+    vlcmock_media_player_set_stream_config( mp, &cfg );
+    mp.play();
+    CHECK( waitFor( [&mirror]() { return mirror.state() == libvlc_Ended; } ) );
+    stop = true;
+    reader.join();
+    CHECK( regressions == 0 );
+
+    auto s = mirror.snapshot();
+    CHECK( s.length == 200 && s.time > 0 && s.position > 0.f );
+    CHECK( s.seekable == true && s.pausable == true );
+    CHECK( s.buffering == 100.f && s.version > 0 );
+
+    CHECK( mirror.setRate( 2.f ) == 0 );
+    CHECK( mirror.rate() == 2.f && mp.rate() == 2.f );
+    CHECK( mirror.setVolume( 50 ) == true );
+    CHECK( mirror.volume() == 50 && mp.volume() == 50 );
+    mp.stopAsync().wait();
+    mirror.refresh();
+    CHECK( mirror.state() == libvlc_Stopped );
+}
+
+/*
+ * The presets & bands are read from libvlc, and an equalizer applies its own
+ * settings to every player of a collection.
+ */
+void equalizerAppliesToPlayers()
+{
+    CHECK( VLC::Equalizer::bandCount() == 10 && VLC::Equalizer::bandFrequency( 0 ) == 60.f );
+    CHECK( VLC::Equalizer::presetCount() > 1 && VLC::Equalizer::presetName( 0 ) == "Flat" );
+    CHECK( VLC::Equalizer::presetNames().size() == VLC::Equalizer::presetCount() );
+
+    VLC::Instance instance( 0, nullptr );
+    std::vector<VLC::MediaPlayer> players;
+    for ( auto i = 0; i < 3; ++i )
+        players.emplace_back( instance );
+    VLC::Equalizer preset( 1 );
+    VLC::Equalizer equalizer;
+    CHECK( equalizer.setPreamp( 4.f ) == 0 && equalizer.preamp() == 4.f );
+    std::vector<float> amps( VLC::Equalizer::bandCount() + 2, -3.f );
+    amps[1] = 30.f;
+    CHECK( equalizer.setAmps( amps ) == 0 );
+    CHECK( equalizer.amp( 1 ) == 20.f && equalizer.amps().size() == VLC::Equalizer::bandCount() );
+    CHECK( preset.amps() != equalizer.amps() );
+    CHECK( equalizer.apply( players ) == 0 );
+
+    // Moving an equalizer keeps its settings
+    auto moved = std::move( equalizer );
+    CHECK( moved.amps()[1] == 20.f );
+    for ( auto& mp : players )
+    {
+        float preamp;
+        std::array<float, 10> applied;
+        CHECK( vlcmock_media_player_get_equalizer( mp, &preamp, applied.data(), applied.size() ) == 0 );
+        CHECK( preamp == 4.f && applied[0] == -3.f && applied[1] == 20.f );
+    }
+    CHECK( players[0].unsetEqualizer() == 0 );
+    CHECK( vlcmock_media_player_get_equalizer( players[0], nullptr, nullptr, 0 ) == -1 );
+}
+
+/*
+ * Messages are filtered, rate limited, formatted within their slot, and
+ * dropped rather than blocking the logging thread when the ring is full.
+ */
+void logCaptureFiltersAndDrops()
+{
+    struct Message
+    {
+        int level;
+        std::string module;
+        std::string message;
+        bool truncated;
+    };
+    VLC::Instance instance( 0, nullptr );
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::vector<Message> messages;
+    bool block = false;
+    bool blocked = false;
+    uint64_t rateLimited;
+    {
+        VLC::LogCapture capture( 4 );
+        capture.addSink( [&]( const VLC::LogCapture::Record& r ) {
+            std::unique_lock<std::mutex> lock( mutex );
+            messages.push_back( Message{ r.level, r.module, r.message, r.truncated } );
+            blocked = block;
+            cond.notify_all();
+            cond.wait( lock, [&block]() { return block == false; } );
+        });
+        capture.attach( instance );
+        capture.setLevel( LIBVLC_NOTICE );
+        vlcmock_log( instance, LIBVLC_DEBUG, "core", "filtered" );
+        vlcmock_log( instance, LIBVLC_NOTICE, "core", "hello %d", 42 );
+        std::string longMessage( 1000, 'x' );
+        vlcmock_log( instance, LIBVLC_ERROR, "core", "%s", longMessage.c_str() );
+        CHECK( waitFor( [&capture]() { return capture.stats().captured == 2; } ) );
+        CHECK( capture.stats().filtered == 1 );
+        {
+            std::lock_guard<std::mutex> lock( mutex );
+            CHECK( messages.size() == 2 );
+            if ( messages.size() == 2 )
+            {
+                CHECK( messages[0].level == LIBVLC_NOTICE && messages[0].module == "core" );
+                CHECK( messages[0].message == "hello 42" && messages[0].truncated == false );
+                CHECK( messages[1].truncated == true && messages[1].message.size() < longMessage.size() );
+            }
+            block = true;
+        }
+
+        // Once the consumer is stuck in the sink, the ring only has room for
+        // 3 messages, since the slot being consumed is released afterward
+        vlcmock_log( instance, LIBVLC_NOTICE, "core", "blocking" );
+        {
+            std::unique_lock<std::mutex> lock( mutex );
+            CHECK( cond.wait_for( lock, std::chrono::seconds( 5 ), [&blocked]() { return blocked; } ) );
+        }
+        for ( auto i = 0; i < 10; ++i )
+            vlcmock_log( instance, LIBVLC_NOTICE, "core", "flood %d", i );
+        CHECK( capture.stats().dropped == 7 );
+        {
+            std::lock_guard<std::mutex> lock( mutex );
+            block = false;
+        }
+        cond.notify_all();
+        CHECK( waitFor( [&capture]() { return capture.stats().captured == 6; } ) );
+
+        // At most 3 messages per second go through, and 10 messages can
+        // straddle 2 seconds at most
+        capture.setRateLimit( 3 );
+        for ( auto i = 0; i < 10; ++i )
+            vlcmock_log( instance, LIBVLC_NOTICE, "chatty", "spam %d", i );
+        rateLimited = capture.stats().rateLimited;
+        CHECK( rateLimited >= 4 );
+
+        capture.detach();
+        vlcmock_log( instance, LIBVLC_ERROR, "core", "detached" );
+    }
+    // The pending messages are flushed upon destruction
+    CHECK( messages.size() == 6 + 10 - rateLimited );
+    CHECK( messages.empty() == false && messages.back().message != "detached" );
+}
+
+/*
+ * The strings of a track outlive the libvlc structure, and are only set for
+ * the tracks having them.
+ */
+void mediaTrackStrings()
+{
+    libvlc_subtitle_track_t subtitle{};
+    std::string encoding = "UTF-8";
+    subtitle.psz_encoding = &encoding[0];
+    libvlc_audio_track_t audio{};
+    std::string language = "eng";
+    std::string description = "A description longer than the small string buffer";
+    libvlc_media_track_t tracks[3] = {};
+    tracks[0].i_type = libvlc_track_text;
+    tracks[0].subtitle = &subtitle;
+    tracks[0].psz_language = &language[0];
+    tracks[1].i_type = libvlc_track_audio;
+    tracks[1].audio = &audio;
+    tracks[1].psz_description = &description[0];
+    tracks[2].i_type = libvlc_track_audio;
+    tracks[2].audio = &audio;
+
+    std::vector<VLC::MediaTrack> res;
+    for ( auto& t : tracks )
+        res.emplace_back( &t );
+    auto copy = res;
+    encoding.assign( encoding.size(), 'x' );
+    language.assign( language.size(), 'x' );
+    description.assign( description.size(), 'x' );
+    res.clear();
+
+    CHECK( copy[0].encoding() == "UTF-8" && copy[0].language() == "eng" );
+    CHECK( copy[0].description().empty() );
+    CHECK( copy[1].description() == "A description longer than the small string buffer" );
+    CHECK( copy[1].language().empty() && copy[1].encoding().empty() );
+    CHECK( copy[2].language().empty() && copy[2].description().empty() && copy[2].encoding().empty() );
+}
+
+/*
+ * Each item is prerolled on the standby player, which then takes over, until
+ * the end of the list.
+ */
+void gaplessPlaysThroughTheList()
+{
+    auto cfg = shortStream( 300 );
+    cfg.time_changed_rate = 50.;
+    cfg.paced = 1;
+    vlcmock_set_default_stream_config( &cfg );
+    VLC::Instance instance( 0, nullptr );
+    VLC::MediaList list( instance );
+    for ( auto i = 0; i < 3; ++i )
+    {
+        VLC::Media md( instance, "mock://" + std::to_string( i ), VLC::Media::FromLocation );
+        list.addMedia( md );
+    }
+    std::mutex mutex;
+    std::vector<std::pair<VLC::MediaPlayer, int>> switches;
+    {
+        VLC::GaplessMediaListPlayer gapless( instance, nullptr, 3000 );
+        gapless.setMediaList( list );
+        gapless.setSwitchCallback( [&mutex, &switches]( VLC::MediaPlayer& mp, int index ) {
+            std::lock_guard<std::mutex> lock( mutex );
+            switches.emplace_back( mp, index );
+        });
+        gapless.play().wait();
+        CHECK( waitFor( [&gapless]() { return gapless.currentIndex() < 0; } ) );
+        std::lock_guard<std::mutex> lock( mutex );
+        CHECK( switches.size() == 3 );
+        for ( auto i = 0u; i < switches.size(); ++i )
+        {
+            CHECK( switches[i].second == (int)i );
+            if ( i > 0 )
+                CHECK( switches[i].first != switches[i - 1].first );
+        }
+    }
+}
+
+/*
+ * After a jump, the new item's first time events may come before its length.
+ * They must not be compared to the previous item's length, which would
+ * preroll the next item right away.
+ */
+void gaplessIgnoresStaleLengths()
+{
+    auto cfg = shortStream( 10000 );
+    cfg.paced = 1;
+    vlcmock_set_default_stream_config( &cfg );
+    VLC::Instance instance( 0, nullptr );
+    VLC::MediaList list( instance );
+    for ( auto i = 0; i < 3; ++i )
+    {
+        VLC::Media md( instance, "mock://" + std::to_string( i ), VLC::Media::FromLocation );
+        list.addMedia( md );
+    }
+    std::vector<VLC::MediaPlayer> players;
+    {
+        VLC::GaplessMediaListPlayer gapless( instance, [&players]( VLC::MediaPlayer& mp ) {
+            players.push_back( mp );
+        }, 3000 );
+        gapless.setMediaList( list );
+        gapless.playItemAtIndex( 0 ).wait();
+        auto active = gapless.activePlayer();
+        CHECK( waitFor( [&active]() { return active.length() == 10000; } ) );
+
+        // The next item is longer, and reports a time close to the end of
+        // the previous one before its length
+        auto longer = shortStream( 60000 );
+        longer.paced = 1;
+        vlcmock_media_player_set_stream_config( active, &longer );
+        struct Injector
+        {
+            libvlc_event_manager_t* em;
+            std::atomic<bool> pending;
+        } injector;
+        injector.em = libvlc_media_player_event_manager( active );
+        injector.pending = true;
+        auto onPlaying = []( const libvlc_event_t*, void* data ) {
+            auto injector = static_cast<Injector*>( data );
+            if ( injector->pending.exchange( false ) == true )
+                sendTimeChanged( injector->em, 8000 );
+        };
+        libvlc_event_attach( injector.em, libvlc_MediaPlayerPlaying, onPlaying, &injector );
+        gapless.playItemAtIndex( 1 ).wait();
+        CHECK( waitFor( [&injector]() { return injector.pending == false; } ) );
+        // Let a wrongly queued Arm command run
+        gapless.pause().wait();
+        gapless.pause().wait();
+        libvlc_event_detach( injector.em, libvlc_MediaPlayerPlaying, onPlaying, &injector );
+        CHECK( gapless.currentIndex() == 1 );
+        for ( auto& mp : players )
+        {
+            if ( mp == active )
+                continue;
+            auto md = libvlc_media_player_get_media( mp );
+            CHECK( md == nullptr );
+            if ( md != nullptr )
+                libvlc_media_release( md );
+        }
+    }
+}
+
+struct Test
+{
+    const char* name;
+    void (*func)();
+};
+
+const Test tests[] = {
+    { "virtual_media_list/window_is_bounded", &virtualMediaListWindowIsBounded },
+    { "media_player/released_while_playing_with_callbacks", &playerReleasedWhilePlayingWithCallbacks },
+    { "reaper/forwards_exceptions", &reaperForwardsExceptions },
+    { "seek_controller/ignores_pre_seek_times", &seekControllerIgnoresPreSeekTimes },
+    { "decode_session/caps_audio_rate", &decodeSessionCapsAudioRate },
+    { "track_description_cache/concurrent_reads", &trackDescriptionCacheConcurrentReads },
+    { "audio_output_device_registry/caches_player_devices", &audioOutputDeviceRegistryCachesPlayerDevices },
+    { "instance_provider/retries_failures", &instanceProviderRetriesFailures },
+    { "weak_handle/compares_addresses", &weakHandleComparesAddresses },
+    { "media_track/strings", &mediaTrackStrings },
+    { "gapless/ignores_stale_lengths", &gaplessIgnoresStaleLengths },
+    { "gapless/plays_through_the_list", &gaplessPlaysThroughTheList },
+    { "playlist_parser/reads_entries", &playlistParserReadsEntries },
+    { "startup_probe/records_first_outputs", &startupProbeRecordsFirstOutputs },
+    { "player_state_mirror/follows_events", &playerStateMirrorFollowsEvents },
+    { "equalizer/applies_to_players", &equalizerAppliesToPlayers },
+    { "log_capture/filters_and_drops", &logCaptureFiltersAndDrops },
+};
+
+} // anonymous namespace
+
+int main( int argc, char** argv )
+{
+    std::string filter = argc > 1 ? argv[1] : "";
+    for ( const auto& t : tests )
+    {
+        if ( std::string( t.name ).find( filter ) == std::string::npos )
+            continue;
+        auto before = failures;
+        t.func();
+        printf( "[%s] %s\n", failures == before ? " OK " : "FAIL", t.name );
+    }
+    vlcmock_stats_t s;
+    vlcmock_get_stats( &s );
+    // Every wrapper is gone, so should the libvlc objects
+    CHECK( s.instances == 0 && s.medias == 0 && s.media_lists == 0 &&
+           s.media_players == 0 && s.listeners == 0 && s.equalizers == 0 );
+    return failures == 0 ? 0 : 1;
+}
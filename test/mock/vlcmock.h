@@ -0,0 +1,188 @@
+/*****************************************************************************
+ * vlcmock.h: Control API of the mock libvlc
+ *****************************************************************************
+ * Copyright © 2015 libvlcpp authors & VideoLAN
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * The mock libvlc implements the part of the libvlc API used by libvlcpp for
+ * events, media, media lists, players, media list players, the audio device
+ * lists, the equalizer, the logs and the video & audio callbacks, without
+ * decoding anything. Players produce a synthetic stream instead: frames,
+ * audio buffers and events at fixed rates, in a deterministic order. This
+ * lets benchmarks & stress tests run on machines without libvlc, nor any
+ * media file.
+ *
+ * Functions which aren't implemented (VLM, discoverers, ...) are left
+ * undefined, and fail at link time.
+ *
+ * Link with the vlcmock library instead of libvlc, see the VLCPP_MOCK_LIBVLC
+ * cmake option.
+ */
+
+#ifndef VLCMOCK_H
+#define VLCMOCK_H
+
+#include <vlc/vlc.h>
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Describes the stream played by a mock player.
+ *
+ * Stream times are in microseconds. All the rates are expressed in stream
+ * time, ie. a 25 fps stream played at rate 2 displays 50 frames per second.
+ */
+typedef struct vlcmock_stream_config_t
+{
+    /** Video frame rate, 0 disables the video track */
+    double video_fps;
+    unsigned video_width;
+    unsigned video_height;
+    /** Chroma offered to the format callback, ie. "RV32" */
+    char video_chroma[5];
+
+    /** Audio sample rate, 0 disables the audio track */
+    unsigned audio_rate;
+    unsigned audio_channels;
+    /** Number of samples per channel, in each audio buffer */
+    unsigned audio_samples_per_buffer;
+
+    /** Number of TimeChanged & PositionChanged events per second */
+    double time_changed_rate;
+
+    /** Stream duration, in ms */
+    int64_t duration;
+    /** Fires EncounteredError at this stream time (in ms), unless negative */
+    int64_t error_at;
+
+    /**
+     * Wait for each frame/buffer/event date, as a regular player would.
+     * Unpaced streams are produced as fast as the callbacks consume them.
+     */
+    int paced;
+} vlcmock_stream_config_t;
+
+/**
+ * Statistics collected by the mock since the process started
+ */
+typedef struct vlcmock_stats_t
+{
+    uint64_t events_sent;
+    uint64_t video_frames;
+    uint64_t audio_buffers;
+    uint64_t audio_samples;
+    /** Calls to libvlc_audio_output_device_list_get & _enum */
+    uint64_t audio_device_enums;
+
+    /* Objects and event listeners currently alive, for leak checks */
+    int64_t instances;
+    int64_t medias;
+    int64_t media_lists;
+    int64_t media_players;
+    int64_t listeners;
+    int64_t equalizers;
+} vlcmock_stats_t;
+
+/**
+ * Initializes a configuration with the defaults: 10s of 640x360 RV32 video
+ * at 25 fps, 48kHz stereo audio in 1024 samples buffers, 4 TimeChanged
+ * events per second, unpaced.
+ */
+void vlcmock_stream_config_init( vlcmock_stream_config_t* config );
+
+/**
+ * Sets the configuration used by the players created afterward, and as the
+ * source of the media tracks & durations.
+ */
+void vlcmock_set_default_stream_config( const vlcmock_stream_config_t* config );
+
+/**
+ * Sets the stream played by this player. It applies to the next play().
+ */
+void vlcmock_media_player_set_stream_config( libvlc_media_player_t* mp,
+                                             const vlcmock_stream_config_t* config );
+
+/**
+ * Gets the settings of the equalizer last set on the player.
+ *
+ * \param amps     Receives the amplification of the first count bands, may
+ *                 be NULL
+ * \return 0 on success, -1 if no equalizer is set
+ */
+int vlcmock_media_player_get_equalizer( libvlc_media_player_t* mp, float* preamp,
+                                        float* amps, unsigned count );
+
+/**
+ * Waits for the player to reach the end of the stream, or to be stopped.
+ *
+ * \param timeout   The timeout in ms, or a negative value to wait forever
+ * \return 0 when the stream is over, -1 on timeout
+ */
+int vlcmock_media_player_wait( libvlc_media_player_t* mp, int64_t timeout );
+
+/**
+ * Synchronously sends count events of the provided type through the event
+ * manager, from the calling thread.
+ *
+ * The events payloads depend on their index, ie. TimeChanged events carry
+ * their index as new_time. item is used as the media of the events which
+ * carry one (list items, sub items, player media changes), and may be NULL
+ * otherwise.
+ *
+ * \return 0 on success, -1 if the type isn't supported
+ */
+int vlcmock_event_emit( libvlc_event_manager_t* em, libvlc_event_type_t type,
+                        libvlc_media_t* item, unsigned count );
+
+/**
+ * Synchronously sends an event, whose type & payload are provided by the
+ * caller, through the event manager. The event p_obj is overwritten.
+ */
+void vlcmock_event_send( libvlc_event_manager_t* em, libvlc_event_t* event );
+
+/**
+ * Makes the next count libvlc_new calls fail
+ */
+void vlcmock_fail_instances( unsigned count );
+
+/**
+ * Sets the devices returned by libvlc_audio_output_device_list_get, for any
+ * module, and by libvlc_audio_output_device_enum. Defaults to "default".
+ */
+void vlcmock_set_audio_devices( const char* const* devices, unsigned count );
+
+/**
+ * Synchronously emits a log message from the calling thread, through the
+ * callback set with libvlc_log_set, if any.
+ */
+void vlcmock_log( libvlc_instance_t* instance, int level, const char* module,
+                  const char* fmt, ... );
+
+void vlcmock_get_stats( vlcmock_stats_t* stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,344 @@
+/*****************************************************************************
+ * AudioOutputDeviceRegistry.hpp: Cached audio output device lists
+ *****************************************************************************
+ * Copyright © 2015 libvlcpp authors & VideoLAN
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_CXX_AUDIOOUTPUTDEVICEREGISTRY_H
+#define LIBVLC_CXX_AUDIOOUTPUTDEVICEREGISTRY_H
+
+#include "common.hpp"
+#include "Instance.hpp"
+#include "MediaPlayer.hpp"
+#include "structures.hpp"
+#include "WeakHandle.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace VLC
+{
+
+/**
+ * @brief Caches the audio outputs and their devices
+ *
+ * Enumerating the devices probes the audio backend, which can take tens of
+ * ms. The registry enumerates the devices of an audio output module the
+ * first time they are requested, and serves the cached list afterward.
+ *
+ * Some modules (notably PulseAudio and MMDevice) can only enumerate their
+ * devices through a player, see MediaPlayer::outputDeviceEnum(). The lists
+ * enumerated through a player are cached separately, also by module.
+ *
+ * Lists are only updated by refresh(), which can be invoked on demand or
+ * periodically from a background thread (see startAutoRefresh()). Listeners
+ * are notified of the modules whose device list changed.
+ *
+ * The registry is meant to be shared by the whole application, see shared().
+ */
+class AudioOutputDeviceRegistry
+{
+public:
+    using Outputs = std::shared_ptr<const std::vector<AudioOutputDescription>>;
+    using Devices = std::shared_ptr<const std::vector<AudioOutputDeviceDescription>>;
+    /**
+     * Called with the name of the audio output module, and its new device
+     * list. This is invoked from the thread which called refresh()
+     */
+    using Listener = std::function<void(const std::string&, Devices)>;
+
+    AudioOutputDeviceRegistry(Instance& instance)
+        : m_instance( instance )
+        , m_nextListenerId( 0 )
+        , m_stopRefresh( false )
+    {
+    }
+
+    ~AudioOutputDeviceRegistry()
+    {
+        stopAutoRefresh();
+    }
+
+    AudioOutputDeviceRegistry(const AudioOutputDeviceRegistry&) = delete;
+    AudioOutputDeviceRegistry& operator=(const AudioOutputDeviceRegistry&) = delete;
+
+    /**
+     * The process wide registry of an instance.
+     *
+     * The registry is created upon the first request, and shared with the
+     * following ones until the last reference to it goes away.
+     */
+    static std::shared_ptr<AudioOutputDeviceRegistry> shared(Instance& instance)
+    {
+        static std::mutex mutex;
+        static std::map<libvlc_instance_t*, std::weak_ptr<AudioOutputDeviceRegistry>> registries;
+        std::lock_guard<std::mutex> lock( mutex );
+        for ( auto it = registries.begin(); it != registries.end(); )
+        {
+            if ( it->second.expired() == true )
+                it = registries.erase( it );
+            else
+                ++it;
+        }
+        // A live registry holds its instance, so the address can't be reused
+        auto& weak = registries[instance.get()];
+        auto registry = weak.lock();
+        if ( registry == nullptr )
+        {
+            registry = std::make_shared<AudioOutputDeviceRegistry>( instance );
+            weak = registry;
+        }
+        return registry;
+    }
+
+    /**
+     * The available audio output modules
+     *
+     * \see Instance::audioOutputList()
+     */
+    Outputs outputs()
+    {
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            if ( m_outputs != nullptr )
+                return m_outputs;
+        }
+        Outputs outputs = std::make_shared<const std::vector<AudioOutputDescription>>(
+                    m_instance.audioOutputList() );
+        std::lock_guard<std::mutex> lock( m_mutex );
+        if ( m_outputs == nullptr )
+            m_outputs = std::move( outputs );
+        return m_outputs;
+    }
+
+    /**
+     * The devices of an audio output module.
+     *
+     * This only probes the backend the first time a module is requested.
+     *
+     * \param aout  The audio output module name
+     * \see Instance::audioOutputDeviceList()
+     */
+    Devices devices(const std::string& aout)
+    {
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            auto it = m_devices.find( aout );
+            if ( it != m_devices.end() )
+                return it->second;
+        }
+        Devices devices = enumerate( aout );
+        std::lock_guard<std::mutex> lock( m_mutex );
+        // Another thread may have enumerated the same module meanwhile
+        auto res = m_devices.insert( std::make_pair( aout, devices ) );
+        return res.first->second;
+    }
+
+    /**
+     * The devices of the audio output module used by a player.
+     *
+     * This only probes the backend the first time a module is requested. The
+     * refreshes enumerate the devices through the latest player provided for
+     * the module, as long as it is alive.
+     *
+     * \param player    The player, which must use the aout module
+     * \param aout      The audio output module name, as provided to
+     *                  MediaPlayer::setAudioOutput()
+     * \see MediaPlayer::outputDeviceEnum()
+     */
+    Devices devices(MediaPlayer& player, const std::string& aout)
+    {
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            auto it = m_playerDevices.find( aout );
+            if ( it != m_playerDevices.end() )
+            {
+                it->second.player = WeakHandle<MediaPlayer>( player );
+                return it->second.devices;
+            }
+        }
+        Devices devices = enumerate( player );
+        std::lock_guard<std::mutex> lock( m_mutex );
+        auto& entry = m_playerDevices[aout];
+        entry.player = WeakHandle<MediaPlayer>( player );
+        if ( entry.devices == nullptr )
+            entry.devices = std::move( devices );
+        return entry.devices;
+    }
+
+    /**
+     * Enumerate the devices of all the modules requested so far, and notify
+     * the listeners of the lists which changed.
+     *
+     * This blocks while the backends are probed.
+     */
+    void refresh()
+    {
+        std::vector<std::string> modules;
+        std::vector<std::pair<std::string, WeakHandle<MediaPlayer>>> players;
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_outputs = nullptr;
+            for ( const auto& d : m_devices )
+                modules.push_back( d.first );
+            for ( const auto& d : m_playerDevices )
+                players.emplace_back( d.first, d.second.player );
+        }
+        std::vector<std::pair<std::string, Devices>> changed;
+        for ( const auto& aout : modules )
+        {
+            auto devices = enumerate( aout );
+            std::lock_guard<std::mutex> lock( m_mutex );
+            update( m_devices[aout], aout, std::move( devices ), changed );
+        }
+        for ( const auto& p : players )
+        {
+            auto player = p.second.lock();
+            // The list is kept as is until a live player is provided
+            if ( player.isValid() == false )
+                continue;
+            auto devices = enumerate( player );
+            std::lock_guard<std::mutex> lock( m_mutex );
+            update( m_playerDevices[p.first].devices, p.first, std::move( devices ), changed );
+        }
+        if ( changed.empty() )
+            return;
+        std::vector<Listener> listeners;
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            for ( const auto& l : m_listeners )
+                listeners.push_back( l.second );
+        }
+        for ( const auto& c : changed )
+        {
+            for ( const auto& l : listeners )
+                l( c.first, c.second );
+        }
+    }
+
+    /**
+     * Register a change listener
+     *
+     * \return An identifier, to be passed to removeListener()
+     */
+    unsigned int addListener(Listener listener)
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        auto id = m_nextListenerId++;
+        m_listeners.emplace( id, std::move( listener ) );
+        return id;
+    }
+
+    void removeListener(unsigned int id)
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_listeners.erase( id );
+    }
+
+    /**
+     * Start refreshing the lists periodically, from a background thread.
+     *
+     * \param period  The time between two refreshes
+     */
+    void startAutoRefresh(std::chrono::milliseconds period = std::chrono::seconds( 5 ))
+    {
+        stopAutoRefresh();
+        std::lock_guard<std::mutex> lock( m_refreshMutex );
+        m_stopRefresh = false;
+        m_refreshThread = std::thread( [this, period]() {
+            std::unique_lock<std::mutex> lock( m_refreshMutex );
+            while ( m_refreshCond.wait_for( lock, period, [this]() { return m_stopRefresh; } ) == false )
+            {
+                lock.unlock();
+                refresh();
+                lock.lock();
+            }
+        });
+    }
+
+    /**
+     * Stop the background refresh, waiting for an ongoing one to complete.
+     */
+    void stopAutoRefresh()
+    {
+        {
+            std::lock_guard<std::mutex> lock( m_refreshMutex );
+            m_stopRefresh = true;
+        }
+        m_refreshCond.notify_all();
+        if ( m_refreshThread.joinable() )
+            m_refreshThread.join();
+    }
+
+private:
+    struct PlayerDevices
+    {
+        Devices devices;
+        // The player to enumerate the devices through, upon refresh
+        WeakHandle<MediaPlayer> player;
+    };
+
+    Devices enumerate(const std::string& aout)
+    {
+        return std::make_shared<const std::vector<AudioOutputDeviceDescription>>(
+                    m_instance.audioOutputDeviceList( aout ) );
+    }
+
+    static Devices enumerate(MediaPlayer& player)
+    {
+        return std::make_shared<const std::vector<AudioOutputDeviceDescription>>(
+                    player.outputDeviceEnum() );
+    }
+
+    // Must be called with m_mutex held
+    static void update(Devices& current, const std::string& aout, Devices devices,
+                       std::vector<std::pair<std::string, Devices>>& changed)
+    {
+        if ( current != nullptr && *current == *devices )
+            return;
+        current = devices;
+        changed.emplace_back( aout, std::move( devices ) );
+    }
+
+private:
+    Instance m_instance;
+    Outputs m_outputs;
+    std::map<std::string, Devices> m_devices;
+    std::map<std::string, PlayerDevices> m_playerDevices;
+    std::map<unsigned int, Listener> m_listeners;
+    unsigned int m_nextListenerId;
+    std::mutex m_mutex;
+
+    bool m_stopRefresh;
+    std::mutex m_refreshMutex;
+    std::condition_variable m_refreshCond;
+    std::thread m_refreshThread;
+};
+
+} // namespace VLC
+
+#endif
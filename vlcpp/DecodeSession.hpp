@@ -0,0 +1,248 @@
+/*****************************************************************************
+ * DecodeSession.hpp: Faster than realtime decoding through callbacks
+ *****************************************************************************
+ * Copyright © 2015 libvlcpp authors & VideoLAN
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_CXX_DECODESESSION_H
+#define LIBVLC_CXX_DECODESESSION_H
+
+#include "common.hpp"
+#include "EventManager.hpp"
+#include "Instance.hpp"
+#include "Media.hpp"
+#include "MediaPlayer.hpp"
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <string>
+
+namespace VLC
+{
+
+/**
+ * @brief Decodes a media as fast as possible, for analysis purposes
+ *
+ * The media is played with the clock synchronization disabled, without
+ * dropping nor skipping late frames, at the highest rate its outputs accept.
+ * Decoded frames and samples are delivered through the sinks, which are the
+ * regular MediaPlayer video and audio callbacks. When no sink is provided for
+ * a kind of track, those tracks aren't decoded at all.
+ *
+ * libvlc 2.x can't disable the output clock altogether: the video output
+ * still waits for each picture date, divided by the rate, which libvlc caps
+ * to 32 (MaxRate).
+ *
+ * The audio output resamples the audio played at a rate other than 1, and
+ * drops it altogether above 4 (MaxAudioRate). When an audio sink is set, the
+ * rate therefore defaults, and is capped, to MaxAudioRate. The samples are
+ * then resampled: set the rate to 1 to get the decoded samples unmodified.
+ * Decode the video and audio tracks in separate sessions to get both at
+ * their highest rate.
+ *
+ * Sinks are invoked from libvlc threads. They must remain callable until the
+ * session has completed, or is destroyed.
+ */
+class DecodeSession
+{
+public:
+    /**
+     * The maximum rate supported by libvlc
+     */
+    static constexpr float MaxRate = 32.f;
+
+    /**
+     * The maximum rate at which libvlc still outputs audio, resampled
+     */
+    static constexpr float MaxAudioRate = 4.f;
+
+    /**
+     * \param instance  The instance used to create the player
+     * \param media     The media to decode. It isn't modified, the session
+     *                  options are set on a copy.
+     */
+    DecodeSession(Instance& instance, Media& media)
+        : m_player( instance )
+        , m_media( media )
+        , m_rate( 0.f )
+        , m_hasVideoSink( false )
+        , m_hasAudioSink( false )
+        , m_done( false )
+        , m_eventManager( m_player.eventManager() )
+    {
+        m_completion = m_promise.get_future().share();
+        m_eventManager.onEndReached( [this]() {
+            complete( true );
+        });
+        m_eventManager.onEncounteredError( [this]() {
+            complete( false );
+        });
+    }
+
+    ~DecodeSession()
+    {
+        // Ensures no sink gets called after we return
+        m_player.stop();
+        complete( false );
+    }
+
+    DecodeSession(const DecodeSession&) = delete;
+    DecodeSession& operator=(const DecodeSession&) = delete;
+
+    /**
+     * Set the video sink.
+     *
+     * \see MediaPlayer::setVideoCallbacks for the expected prototypes.
+     * The format must be provided through the player(), with either
+     * MediaPlayer::setVideoFormat or MediaPlayer::setVideoFormatCallbacks
+     */
+    template <typename LockCb, typename UnlockCb, typename DisplayCb>
+    void setVideoSink(LockCb&& lock, UnlockCb&& unlock, DisplayCb&& display)
+    {
+        m_player.setVideoCallbacks( std::forward<LockCb>( lock ),
+                                    std::forward<UnlockCb>( unlock ),
+                                    std::forward<DisplayCb>( display ) );
+        m_hasVideoSink = true;
+    }
+
+    /**
+     * Set the audio sink.
+     *
+     * \see MediaPlayer::setAudioCallbacks for the expected prototypes.
+     * The format must be provided through the player(), with either
+     * MediaPlayer::setAudioFormat or MediaPlayer::setAudioFormatCallbacks
+     */
+    template <typename PlayCb, typename PauseCb, typename ResumeCb, typename FlushCb, typename DrainCb>
+    void setAudioSink(PlayCb&& play, PauseCb&& pause, ResumeCb&& resume, FlushCb&& flush, DrainCb&& drain)
+    {
+        m_player.setAudioCallbacks( std::forward<PlayCb>( play ), std::forward<PauseCb>( pause ),
+                                    std::forward<ResumeCb>( resume ), std::forward<FlushCb>( flush ),
+                                    std::forward<DrainCb>( drain ) );
+        m_hasAudioSink = true;
+    }
+
+    /**
+     * Set the playback rate. This must be called before start()
+     *
+     * By default, the rate is MaxAudioRate when an audio sink is set, MaxRate
+     * otherwise. It is capped to MaxAudioRate when an audio sink is set, and
+     * must be 1 for the audio samples to be delivered unmodified.
+     */
+    void setRate(float rate)
+    {
+        m_rate = rate;
+    }
+
+    /**
+     * The rate used to decode, with the current sinks
+     */
+    float rate() const
+    {
+        // The copies avoid odr-using the constants, which have no definition
+        if ( m_hasAudioSink == false )
+            return m_rate > 0.f ? m_rate : float{ MaxRate };
+        return m_rate > 0.f && m_rate < MaxAudioRate ? m_rate : float{ MaxAudioRate };
+    }
+
+    /**
+     * The underlying player, used to set the sinks formats.
+     *
+     * The player must not be started nor stopped directly.
+     */
+    MediaPlayer& player()
+    {
+        return m_player;
+    }
+
+    /**
+     * Start decoding
+     *
+     * \return A future, holding true once the media has been entirely
+     *         decoded, or false if an error occured or the session was
+     *         cancelled.
+     */
+    std::shared_future<bool> start()
+    {
+        auto md = m_media.duplicate();
+        md->addOption( ":clock-synchro=0" );
+        md->addOption( ":clock-jitter=0" );
+        if ( m_hasVideoSink == true )
+        {
+            md->addOption( ":no-drop-late-frames" );
+            md->addOption( ":no-skip-frames" );
+            md->addOption( ":no-avcodec-hurry-up" );
+        }
+        else
+            md->addOption( ":no-video" );
+        if ( m_hasAudioSink == true )
+            md->addOption( ":no-audio-time-stretch" );
+        else
+            md->addOption( ":no-audio" );
+        m_player.setMedia( *md );
+        // The input inherits the player rate upon creation
+        m_player.setRate( rate() );
+        if ( m_player.play() != 0 )
+            complete( false );
+        return m_completion;
+    }
+
+    /**
+     * The completion future, as returned by start()
+     */
+    std::shared_future<bool> completion() const
+    {
+        return m_completion;
+    }
+
+    /**
+     * Stop decoding. The completion future holds false afterward.
+     *
+     * This blocks until the decoding threads are stopped, and must not be
+     * called from a sink nor an event callback.
+     */
+    void cancel()
+    {
+        m_player.stop();
+        complete( false );
+    }
+
+private:
+    void complete(bool success)
+    {
+        if ( m_done.exchange( true ) == false )
+            m_promise.set_value( success );
+    }
+
+private:
+    MediaPlayer m_player;
+    Media m_media;
+    float m_rate;
+    bool m_hasVideoSink;
+    bool m_hasAudioSink;
+    std::atomic<bool> m_done;
+    std::promise<bool> m_promise;
+    std::shared_future<bool> m_completion;
+    // Declared last, so our handlers are unregistered first
+    MediaPlayerEventManager m_eventManager;
+};
+
+} // namespace VLC
+
+#endif
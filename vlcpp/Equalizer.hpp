@@ -0,0 +1,278 @@
+/*****************************************************************************
+ * Equalizer.hpp: Equalizer API
+ *****************************************************************************
+ * Copyright © 2015 libvlcpp authors & VideoLAN
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_CXX_EQUALIZER_H
+#define LIBVLC_CXX_EQUALIZER_H
+
+#include "common.hpp"
+#include "Internal.hpp"
+#include "MediaPlayer.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace VLC
+{
+
+/**
+ * @brief An audio equalizer, to be applied to one or more MediaPlayer
+ *
+ * Equalizers are move-only: each instance owns its own settings.
+ *
+ * The presets and bands are static within libvlc, they are read once and
+ * cached for the whole process.
+ *
+ * \version LibVLC 2.2.0 or later
+ */
+class Equalizer : public Internal<libvlc_equalizer_t>
+{
+public:
+    /**
+     * Create a new default equalizer, with all frequency values zeroed.
+     */
+    Equalizer()
+        : Internal{ libvlc_audio_equalizer_new(), libvlc_audio_equalizer_release }
+    {
+    }
+
+    /**
+     * Create a new equalizer, with initial frequency values copied from an
+     * existing preset.
+     *
+     * \param index  index of the preset, counting from zero
+     */
+    explicit Equalizer( unsigned int index )
+        : Internal{ libvlc_audio_equalizer_new_from_preset( index ), libvlc_audio_equalizer_release }
+    {
+    }
+
+    Equalizer(const Equalizer&) = delete;
+    Equalizer& operator=(const Equalizer&) = delete;
+    Equalizer(Equalizer&&) = default;
+    Equalizer& operator=(Equalizer&&) = default;
+
+    /**
+     * Set a new pre-amplification value for an equalizer.
+     *
+     * The new equalizer settings are subsequently applied to a media player
+     * by invoking MediaPlayer::setEqualizer() or apply().
+     *
+     * The supplied amplification value will be clamped to the -20.0 to +20.0
+     * range.
+     *
+     * \param preamp  preamp value (-20.0 to 20.0 Hz)
+     *
+     * \return zero on success, -1 on error
+     */
+    int setPreamp( float preamp )
+    {
+        return libvlc_audio_equalizer_set_preamp( *this, preamp );
+    }
+
+    /**
+     * Get the current pre-amplification value from an equalizer.
+     *
+     * \return preamp value (Hz)
+     */
+    float preamp() const
+    {
+        return libvlc_audio_equalizer_get_preamp( *this );
+    }
+
+    /**
+     * Set a new amplification value for a particular equalizer frequency
+     * band.
+     *
+     * The supplied amplification value will be clamped to the -20.0 to +20.0
+     * range.
+     *
+     * \param amp  amplification value (-20.0 to 20.0 Hz)
+     *
+     * \param band  index, counting from zero, of the frequency band to set
+     *
+     * \return zero on success, -1 on error
+     */
+    int setAmp( float amp, unsigned int band )
+    {
+        return libvlc_audio_equalizer_set_amp_at_index( *this, amp, band );
+    }
+
+    /**
+     * Get the amplification value for a particular equalizer frequency band.
+     *
+     * \param band  index, counting from zero, of the frequency band to get
+     *
+     * \return amplification value (Hz); NaN if there is no such frequency
+     * band
+     */
+    float amp( unsigned int band ) const
+    {
+        return libvlc_audio_equalizer_get_amp_at_index( *this, band );
+    }
+
+    /**
+     * Set the amplification value of all bands at once
+     *
+     * \param amps  One value per band, extra values are ignored
+     *
+     * \return zero on success, -1 on error
+     */
+    int setAmps( const std::vector<float>& amps )
+    {
+        auto nbBands = std::min<size_t>( amps.size(), bandCount() );
+        for ( auto i = 0u; i < nbBands; ++i )
+        {
+            if ( setAmp( amps[i], i ) != 0 )
+                return -1;
+        }
+        return 0;
+    }
+
+    /**
+     * Get the amplification value of all bands
+     */
+    std::vector<float> amps() const
+    {
+        std::vector<float> res;
+        res.reserve( bandCount() );
+        for ( auto i = 0u; i < bandCount(); ++i )
+            res.push_back( amp( i ) );
+        return res;
+    }
+
+    /**
+     * Apply this equalizer to a range of MediaPlayer
+     *
+     * The players don't keep a reference to the equalizer, which can be
+     * modified and applied again afterward.
+     *
+     * \return The number of players which failed to apply the settings
+     */
+    template <typename Iterator>
+    size_t apply( Iterator begin, Iterator end )
+    {
+        size_t nbFailed = 0;
+        for ( auto it = begin; it != end; ++it )
+        {
+            MediaPlayer& mp = *it;
+            if ( mp.setEqualizer( *this ) != 0 )
+                ++nbFailed;
+        }
+        return nbFailed;
+    }
+
+    /**
+     * Apply this equalizer to a collection of MediaPlayer
+     *
+     * \see apply(Iterator, Iterator)
+     */
+    template <typename Container>
+    size_t apply( Container& players )
+    {
+        using std::begin;
+        using std::end;
+        return apply( begin( players ), end( players ) );
+    }
+
+    /**
+     * Get the number of equalizer presets.
+     */
+    static unsigned int presetCount()
+    {
+        return static_cast<unsigned int>( presetNames().size() );
+    }
+
+    /**
+     * Get the name of a particular equalizer preset.
+     *
+     * \param index  index of the preset, counting from zero
+     *
+     * \throw std::out_of_range if the index is invalid
+     */
+    static const std::string& presetName( unsigned int index )
+    {
+        return presetNames().at( index );
+    }
+
+    /**
+     * Get the names of all presets, ordered by index
+     */
+    static const std::vector<std::string>& presetNames()
+    {
+        static const std::vector<std::string> names = [] {
+            std::vector<std::string> res;
+            auto count = libvlc_audio_equalizer_get_preset_count();
+            res.reserve( count );
+            for ( auto i = 0u; i < count; ++i )
+            {
+                auto name = libvlc_audio_equalizer_get_preset_name( i );
+                res.emplace_back( name != nullptr ? name : "" );
+            }
+            return res;
+        }();
+        return names;
+    }
+
+    /**
+     * Get the number of distinct frequency bands for an equalizer.
+     */
+    static unsigned int bandCount()
+    {
+        return static_cast<unsigned int>( bandFrequencies().size() );
+    }
+
+    /**
+     * Get a particular equalizer band frequency.
+     *
+     * \param index  index of the band, counting from zero
+     *
+     * \return equalizer band frequency (Hz)
+     *
+     * \throw std::out_of_range if the index is invalid
+     */
+    static float bandFrequency( unsigned int index )
+    {
+        return bandFrequencies().at( index );
+    }
+
+    /**
+     * Get the frequencies of all bands, ordered by index
+     */
+    static const std::vector<float>& bandFrequencies()
+    {
+        static const std::vector<float> frequencies = [] {
+            std::vector<float> res;
+            auto count = libvlc_audio_equalizer_get_band_count();
+            res.reserve( count );
+            for ( auto i = 0u; i < count; ++i )
+                res.push_back( libvlc_audio_equalizer_get_band_frequency( i ) );
+            return res;
+        }();
+        return frequencies;
+    }
+};
+
+} // namespace VLC
+
+#endif
@@ -0,0 +1,569 @@
+/*****************************************************************************
+ * GaplessMediaListPlayer.hpp: MediaList player with pre-rolled transitions
+ *****************************************************************************
+ * Copyright © 2015 libvlcpp authors & VideoLAN
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_CXX_GAPLESSMEDIALISTPLAYER_H
+#define LIBVLC_CXX_GAPLESSMEDIALISTPLAYER_H
+
+#include "common.hpp"
+#include "EventManager.hpp"
+#include "Instance.hpp"
+#include "Media.hpp"
+#include "MediaList.hpp"
+#include "MediaPlayer.hpp"
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace VLC
+{
+
+/**
+ * @brief Plays a MediaList without gaps between items
+ *
+ * MediaListPlayer only opens the next item once the current one has ended,
+ * which results in a gap, and the full startup latency, at every transition.
+ *
+ * This player uses two MediaPlayer. When the remaining time of the current
+ * item drops below the preroll time, the next item is parsed and opened on
+ * the standby player, which pauses as soon as it is ready. When the current
+ * item reaches its end, the standby player is resumed and becomes the
+ * active one.
+ *
+ * Both players are configured by the provided setup function. Since libvlc
+ * can't move a video output from a player to another, the application is
+ * responsible for routing the output of the active player, ie. either by
+ * ignoring frames from the standby player in its video/audio callbacks (see
+ * isActive()) or by showing the window of the active player when notified
+ * through the switch callback.
+ *
+ * libvlc must not be called from its own event threads, so all transitions
+ * are performed by a worker thread.
+ */
+class GaplessMediaListPlayer
+{
+public:
+    /**
+     * Called once for each of the two players, upon construction. This is
+     * where the output, callbacks and event handlers should be set up.
+     */
+    using SetupCallback = std::function<void(MediaPlayer&)>;
+    /**
+     * Called from the worker thread when a player becomes active, with the
+     * index of the item it plays. The previous player is stopped afterward.
+     */
+    using SwitchCallback = std::function<void(MediaPlayer&, int)>;
+
+    /**
+     * @param instance  The instance used to create both players
+     * @param setup     Configures each player
+     * @param preroll   The remaining time, in ms, under which the next item
+     *                  gets opened on the standby player
+     */
+    GaplessMediaListPlayer(Instance& instance, SetupCallback setup = nullptr, libvlc_time_t preroll = 3000)
+        : m_preroll( preroll )
+        , m_mode( libvlc_playback_mode_default )
+        , m_active( 0 )
+        , m_index( -1 )
+        , m_armedIndex( -1 )
+        , m_armed( false )
+        , m_generation( 0 )
+        , m_userPaused( false )
+        , m_stopWorker( false )
+    {
+        for ( size_t i = 0; i < m_players.size(); ++i )
+        {
+            m_players[i] = MediaPlayer( instance );
+            m_lengths[i] = 0;
+            if ( setup != nullptr )
+                setup( m_players[i] );
+        }
+        for ( size_t i = 0; i < m_players.size(); ++i )
+            registerEvents( i );
+        m_worker = std::thread( &GaplessMediaListPlayer::run, this );
+    }
+
+    ~GaplessMediaListPlayer()
+    {
+        post( Command::Stop ).wait();
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_stopWorker = true;
+        }
+        m_cond.notify_all();
+        m_worker.join();
+    }
+
+    GaplessMediaListPlayer(const GaplessMediaListPlayer&) = delete;
+    GaplessMediaListPlayer& operator=(const GaplessMediaListPlayer&) = delete;
+
+    /**
+     * Set the media list to play. This doesn't interrupt the playback.
+     */
+    void setMediaList(const MediaList& list)
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_list = list;
+    }
+
+    /**
+     * Sets the playback mode for the playlist
+     */
+    void setPlaybackMode(libvlc_playback_mode_t mode)
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_mode = mode;
+    }
+
+    /**
+     * Set the switch notification callback
+     */
+    void setSwitchCallback(SwitchCallback cb)
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_switchCallback = std::move( cb );
+    }
+
+    /**
+     * Set the remaining time, in ms, under which the next item is prerolled
+     */
+    void setPrerollTime(libvlc_time_t preroll)
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_preroll = preroll;
+    }
+
+    /**
+     * Start playing the list from its first item, or resume playback if it
+     * was paused.
+     *
+     * \return A future, ready once the playback has been started
+     */
+    std::future<void> play()
+    {
+        return post( Command::Play );
+    }
+
+    /**
+     * Play the item at the provided index
+     *
+     * \return A future, ready once the playback has been started
+     */
+    std::future<void> playItemAtIndex(int index)
+    {
+        return post( Command::PlayIndex, index );
+    }
+
+    /**
+     * Skip to the next item, using the prerolled item if any.
+     */
+    std::future<void> next()
+    {
+        return post( Command::Switch );
+    }
+
+    /**
+     * Toggle pause on the active player
+     */
+    std::future<void> pause()
+    {
+        return post( Command::Pause );
+    }
+
+    /**
+     * Stop both players
+     *
+     * \return A future, ready once both players have been stopped
+     */
+    std::future<void> stop()
+    {
+        return post( Command::Stop );
+    }
+
+    /**
+     * Index of the item being played, or -1
+     */
+    int currentIndex() const
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_index;
+    }
+
+    /**
+     * Returns true if mp is the player currently on air.
+     *
+     * This is intended to be called from video/audio callbacks, to drop
+     * the output of the standby player.
+     */
+    bool isActive(const MediaPlayer& mp) const
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_players[m_active] == mp;
+    }
+
+    /**
+     * The player currently on air. It is replaced at every transition.
+     */
+    MediaPlayer activePlayer() const
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_players[m_active];
+    }
+
+private:
+    enum class Command
+    {
+        Play,
+        PlayIndex,
+        Arm,
+        Switch,
+        Pause,
+        Resume,
+        Stop,
+    };
+
+    struct Task
+    {
+        Command command;
+        unsigned int generation;
+        int index;
+        std::shared_ptr<std::promise<void>> done;
+    };
+
+    void registerEvents(size_t idx)
+    {
+        m_eventManagers[idx].reset( new MediaPlayerEventManager( m_players[idx].eventManager() ) );
+        auto& em = *m_eventManagers[idx];
+        em.onLengthChanged( [this, idx](libvlc_time_t length) {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_lengths[idx] = length;
+        });
+        em.onTimeChanged( [this, idx](libvlc_time_t time) {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            // Don't arm twice for the same item, even when it is the last
+            // one and there is nothing to arm
+            if ( idx != m_active || m_index < 0 || m_armed == true )
+                return;
+            if ( m_lengths[idx] <= 0 || m_lengths[idx] - time > m_preroll )
+                return;
+            m_armed = true;
+            postLocked( Command::Arm, -1 );
+        });
+        em.onEndReached( [this, idx]() {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            if ( idx == m_active && m_index >= 0 )
+                postLocked( Command::Switch, -1 );
+        });
+        em.onEncounteredError( [this, idx]() {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            if ( idx == m_active && m_index >= 0 )
+                postLocked( Command::Switch, -1 );
+        });
+        em.onPaused( [this, idx]() {
+            // The prerolled item may reach its paused state after it was
+            // asked to resume
+            std::lock_guard<std::mutex> lock( m_mutex );
+            if ( idx == m_active && m_index >= 0 && m_userPaused == false )
+                postLocked( Command::Resume, -1 );
+        });
+    }
+
+    std::future<void> post(Command c, int index = -1)
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return postLocked( c, index );
+    }
+
+    std::future<void> postLocked(Command c, int index)
+    {
+        auto done = std::make_shared<std::promise<void>>();
+        auto res = done->get_future();
+        // Commands issued by the user supersede the pending ones
+        if ( c == Command::Play || c == Command::PlayIndex || c == Command::Stop )
+            ++m_generation;
+        m_tasks.push_back( Task{ c, m_generation, index, done } );
+        m_cond.notify_all();
+        return res;
+    }
+
+    void run()
+    {
+        while ( true )
+        {
+            Task t;
+            {
+                std::unique_lock<std::mutex> lock( m_mutex );
+                m_cond.wait( lock, [this]() { return m_stopWorker || m_tasks.empty() == false; } );
+                if ( m_tasks.empty() )
+                    return;
+                t = std::move( m_tasks.front() );
+                m_tasks.pop_front();
+                if ( t.generation != m_generation )
+                {
+                    t.done->set_value();
+                    continue;
+                }
+            }
+            switch ( t.command )
+            {
+            case Command::Play:
+                resumeOrPlay();
+                break;
+            case Command::PlayIndex:
+                playIndex( t.index );
+                break;
+            case Command::Arm:
+                arm();
+                break;
+            case Command::Switch:
+                switchPlayers();
+                break;
+            case Command::Pause:
+                togglePause();
+                break;
+            case Command::Resume:
+                activePlayer().setPause( 0 );
+                break;
+            case Command::Stop:
+                stopAll();
+                break;
+            }
+            t.done->set_value();
+        }
+    }
+
+    MediaPtr itemAt(int index)
+    {
+        MediaList list;
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            list = m_list;
+        }
+        if ( index < 0 || list.isValid() == false )
+            return nullptr;
+        MediaList::Lock lock( list );
+        if ( index >= list.count() )
+            return nullptr;
+        return list.itemAtIndex( index );
+    }
+
+    // Must be called with m_mutex held
+    int nextIndex(int index)
+    {
+        if ( m_list.isValid() == false )
+            return -1;
+        if ( m_mode == libvlc_playback_mode_repeat )
+            return index;
+        int count;
+        {
+            MediaList::Lock lock( m_list );
+            count = m_list.count();
+        }
+        if ( index + 1 < count )
+            return index + 1;
+        if ( m_mode == libvlc_playback_mode_loop && count > 0 )
+            return 0;
+        return -1;
+    }
+
+    void resumeOrPlay()
+    {
+        MediaPlayer active;
+        bool playing;
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            active = m_players[m_active];
+            playing = m_index >= 0;
+            m_userPaused = false;
+        }
+        if ( playing )
+            active.setPause( 0 );
+        else
+            playIndex( 0 );
+    }
+
+    void playIndex(int index)
+    {
+        stopAll();
+        auto md = itemAt( index );
+        if ( md == nullptr )
+            return;
+        MediaPlayer active;
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            active = m_players[m_active];
+            m_index = index;
+            m_userPaused = false;
+        }
+        active.setMedia( *md );
+        active.play();
+        notifySwitch();
+    }
+
+    void arm()
+    {
+        MediaPlayer standby;
+        int next;
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            next = nextIndex( m_index );
+            standby = m_players[1 - m_active];
+            // Forget the length of the item the standby player last played
+            m_lengths[1 - m_active] = 0;
+            m_armedIndex = next;
+            m_armed = true;
+        }
+        auto md = itemAt( next );
+        if ( md == nullptr )
+            return;
+        // Work on a copy, so the option doesn't stick to the list's media
+        auto preroll = md->duplicate();
+        preroll->addOption( ":start-paused" );
+        preroll->parseAsync();
+        standby.setMedia( *preroll );
+        standby.play();
+    }
+
+    void switchPlayers()
+    {
+        int armed;
+        bool wasArmed;
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            armed = m_armedIndex;
+            wasArmed = m_armed;
+        }
+        // The item was too short to be prerolled. Otherwise, the Arm command
+        // was queued before this one, and already ran.
+        if ( wasArmed == false )
+        {
+            arm();
+            std::lock_guard<std::mutex> lock( m_mutex );
+            armed = m_armedIndex;
+        }
+        MediaPlayer previous;
+        MediaPlayer active;
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            previous = m_players[m_active];
+            if ( armed < 0 )
+            {
+                // End of the list
+                m_index = -1;
+                m_armedIndex = -1;
+                m_armed = false;
+            }
+            else
+            {
+                m_active = 1 - m_active;
+                m_index = armed;
+                m_armedIndex = -1;
+                m_armed = false;
+                m_userPaused = false;
+                active = m_players[m_active];
+            }
+        }
+        if ( active.isValid() )
+        {
+            active.setPause( 0 );
+            notifySwitch();
+        }
+        previous.stop();
+    }
+
+    void togglePause()
+    {
+        MediaPlayer active;
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            if ( m_index < 0 )
+                return;
+            m_userPaused = !m_userPaused;
+            active = m_players[m_active];
+        }
+        active.pause();
+    }
+
+    void stopAll()
+    {
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_index = -1;
+            m_armedIndex = -1;
+            m_armed = false;
+            m_userPaused = false;
+            // The next items' time must not be compared to these lengths
+            for ( auto& l : m_lengths )
+                l = 0;
+        }
+        for ( auto& p : m_players )
+            p.stop();
+    }
+
+    void notifySwitch()
+    {
+        SwitchCallback cb;
+        MediaPlayer active;
+        int index;
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            cb = m_switchCallback;
+            active = m_players[m_active];
+            index = m_index;
+        }
+        if ( cb != nullptr )
+            cb( active, index );
+    }
+
+private:
+    std::array<MediaPlayer, 2> m_players;
+    std::array<libvlc_time_t, 2> m_lengths;
+    MediaList m_list;
+    libvlc_time_t m_preroll;
+    libvlc_playback_mode_t m_mode;
+    SwitchCallback m_switchCallback;
+    size_t m_active;
+    int m_index;
+    // The prerolled item index, or -1 at the end of the list. Only
+    // meaningful once m_armed is set
+    int m_armedIndex;
+    // Set as soon as an Arm command is queued for the current item
+    bool m_armed;
+    unsigned int m_generation;
+    bool m_userPaused;
+    bool m_stopWorker;
+    std::deque<Task> m_tasks;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::thread m_worker;
+    // Declared last, so our handlers are unregistered first
+    std::array<std::unique_ptr<MediaPlayerEventManager>, 2> m_eventManagers;
+};
+
+} // namespace VLC
+
+#endif
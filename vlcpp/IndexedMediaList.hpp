@@ -0,0 +1,218 @@
+/*****************************************************************************
+ * IndexedMediaList.hpp: MediaList with constant time lookups
+ *****************************************************************************
+ * Copyright © 2015 libvlcpp authors & VideoLAN
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_CXX_INDEXEDMEDIALIST_H
+#define LIBVLC_CXX_INDEXEDMEDIALIST_H
+
+#include "common.hpp"
+#include "EventManager.hpp"
+#include "MediaList.hpp"
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace VLC
+{
+
+/**
+ * @brief Maintains hash indexes over a MediaList
+ *
+ * MediaList::indexOfItem() performs a linear scan, and there is no way to
+ * lookup an item by its MRL. This class keeps a media pointer -> index and a
+ * MRL -> index map up to date by listening to the list's ItemAdded and
+ * ItemDeleted events.
+ *
+ * Appending to the list is O(1). Inserting or removing an item anywhere else
+ * requires the following indexes to be shifted, which is O(n).
+ *
+ * Unless the list lock is held, a returned index may be outdated as soon as
+ * it is returned.
+ *
+ * The indexes are maintained until this object gets destroyed. It can not
+ * be copied nor moved, since the registered event handlers refer to it.
+ */
+class IndexedMediaList
+{
+public:
+    explicit IndexedMediaList(MediaList& list)
+        : m_list( list )
+        , m_count( 0 )
+        , m_eventManager( list.eventManager() )
+    {
+        // No item can be added nor removed while we hold the list lock, so
+        // registering before populating the indexes won't miss any change,
+        // nor index an item twice.
+        auto view = m_list.lockedView();
+        m_eventManager.onItemAdded( [this](MediaPtr md, int index) {
+            if ( md != nullptr )
+                added( *md, index );
+        });
+        m_eventManager.onItemDeleted( [this](MediaPtr md, int index) {
+            if ( md != nullptr )
+                deleted( *md, index );
+        });
+        std::lock_guard<std::mutex> lock( m_mutex );
+        for ( auto& md : view )
+        {
+            m_byPointer.emplace( md.get(), m_count );
+            m_byMrl.emplace( md.mrl(), m_count );
+            ++m_count;
+        }
+    }
+
+    IndexedMediaList(const IndexedMediaList&) = delete;
+    IndexedMediaList& operator=(const IndexedMediaList&) = delete;
+
+    /**
+     * The indexed MediaList
+     */
+    MediaList& list()
+    {
+        return m_list;
+    }
+
+    /**
+     * Find the position of a media in the list.
+     *
+     * \param md    The media to look for
+     * \return      The first position of md in the list, or -1 if not found
+     */
+    int indexOfItem(const Media& md) const
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return firstIndex( m_byPointer, md.get() );
+    }
+
+    /**
+     * Find the position of a media in the list, using its MRL
+     *
+     * \param mrl   The media resource locator, as returned by Media::mrl()
+     * \return      The first position of a media with this MRL in the list,
+     *              or -1 if not found
+     */
+    int indexOfMrl(const std::string& mrl) const
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return firstIndex( m_byMrl, mrl );
+    }
+
+    /**
+     * Check if a media with the provided MRL is present in the list
+     */
+    bool containsMrl(const std::string& mrl) const
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_byMrl.find( mrl ) != end( m_byMrl );
+    }
+
+    /**
+     * Number of indexed items
+     */
+    int count() const
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_count;
+    }
+
+private:
+    template <typename Map, typename Key>
+    static int firstIndex(const Map& map, const Key& key)
+    {
+        auto range = map.equal_range( key );
+        int res = -1;
+        for ( auto it = range.first; it != range.second; ++it )
+        {
+            if ( res == -1 || it->second < res )
+                res = it->second;
+        }
+        return res;
+    }
+
+    template <typename Map>
+    static void shift(Map& map, int from, int offset)
+    {
+        for ( auto& p : map )
+        {
+            if ( p.second >= from )
+                p.second += offset;
+        }
+    }
+
+    template <typename Map, typename Key>
+    static void erase(Map& map, const Key& key, int index)
+    {
+        auto range = map.equal_range( key );
+        for ( auto it = range.first; it != range.second; ++it )
+        {
+            if ( it->second == index )
+            {
+                map.erase( it );
+                return;
+            }
+        }
+    }
+
+    void added(Media& md, int index)
+    {
+        auto mrl = md.mrl();
+        std::lock_guard<std::mutex> lock( m_mutex );
+        if ( index < m_count )
+        {
+            shift( m_byPointer, index, 1 );
+            shift( m_byMrl, index, 1 );
+        }
+        m_byPointer.emplace( md.get(), index );
+        m_byMrl.emplace( std::move( mrl ), index );
+        ++m_count;
+    }
+
+    void deleted(Media& md, int index)
+    {
+        auto mrl = md.mrl();
+        std::lock_guard<std::mutex> lock( m_mutex );
+        erase( m_byPointer, md.get(), index );
+        erase( m_byMrl, mrl, index );
+        --m_count;
+        if ( index < m_count )
+        {
+            shift( m_byPointer, index + 1, -1 );
+            shift( m_byMrl, index + 1, -1 );
+        }
+    }
+
+private:
+    MediaList m_list;
+    mutable std::mutex m_mutex;
+    std::unordered_multimap<libvlc_media_t*, int> m_byPointer;
+    std::unordered_multimap<std::string, int> m_byMrl;
+    int m_count;
+    // A copy of the list's event manager: our handlers get unregistered when
+    // it is destroyed, without affecting the handlers registered by others.
+    // This must be the last member, so the handlers are unregistered before
+    // the state they use gets destroyed.
+    MediaListEventManager m_eventManager;
+};
+
+} // namespace VLC
+
+#endif
@@ -28,6 +28,9 @@
 #include "Internal.hpp"
 #include "structures.hpp"
 
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -61,6 +64,7 @@ public:
      */
     Instance(int argc, const char *const * argv)
         : Internal{ libvlc_new( argc, argv ), libvlc_release }
+        , m_cache( std::make_shared<Cache>() )
     {
     }
 
@@ -214,20 +218,23 @@ public:
      */
     std::vector<ModuleDescription> audioFilterList()
     {
-        auto releaser = [](libvlc_module_description_t* ptr) { libvlc_module_description_list_release(ptr); };
-        auto ptr = std::unique_ptr<libvlc_module_description_t, decltype(releaser)>( libvlc_audio_filter_list_get(*this), releaser );
-        if ( ptr == nullptr )
-            return {};
-        libvlc_module_description_t* p = ptr.get();
         std::vector<ModuleDescription> res;
-        while ( p != NULL )
-        {
-            res.emplace_back( p );
-            p = p->p_next;
-        }
+        audioFilterList( std::back_inserter( res ) );
         return res;
     }
 
+    /**
+     * Same as audioFilterList(), but writes the descriptions to an output
+     * iterator
+     *
+     * \return The iterator past the last written description
+     */
+    template <typename OutputIt>
+    OutputIt audioFilterList( OutputIt out )
+    {
+        return copyModules( libvlc_audio_filter_list_get(*this), out );
+    }
+
 
     /**
      * Returns a list of video filters that are available.
@@ -242,20 +249,23 @@ public:
      */
     std::vector<ModuleDescription> videoFilterList()
     {
-        auto releaser = [](libvlc_module_description_t* ptr) { libvlc_module_description_list_release(ptr); };
-        auto ptr = std::unique_ptr<libvlc_module_description_t, decltype(releaser)>( libvlc_video_filter_list_get(*this), releaser );
-        if ( ptr == nullptr )
-            return {};
-        libvlc_module_description_t* p = ptr.get();
         std::vector<ModuleDescription> res;
-        while ( p != NULL )
-        {
-            res.emplace_back( p );
-            p = p->p_next;
-        }
+        videoFilterList( std::back_inserter( res ) );
         return res;
     }
 
+    /**
+     * Same as videoFilterList(), but writes the descriptions to an output
+     * iterator
+     *
+     * \return The iterator past the last written description
+     */
+    template <typename OutputIt>
+    OutputIt videoFilterList( OutputIt out )
+    {
+        return copyModules( libvlc_video_filter_list_get(*this), out );
+    }
+
     /**
      * Gets the list of available audio output modules.
      *
@@ -267,20 +277,29 @@ public:
      */
     std::vector<AudioOutputDescription> audioOutputList()
     {
-        libvlc_audio_output_t* result = libvlc_audio_output_list_get(*this);
         std::vector<AudioOutputDescription> res;
-        if ( result == NULL )
-            return res;
-        libvlc_audio_output_t* p = result;
-        while ( p != NULL )
-        {
-            res.emplace_back( p );
-            p = p->p_next;
-        }
-        libvlc_audio_output_list_release(result);
+        audioOutputList( std::back_inserter( res ) );
         return res;
     }
 
+    /**
+     * Same as audioOutputList(), but writes the outputs to an output iterator
+     *
+     * \return The iterator past the last written output
+     */
+    template <typename OutputIt>
+    OutputIt audioOutputList( OutputIt out )
+    {
+        libvlc_audio_output_t* result = libvlc_audio_output_list_get(*this);
+        if ( result == NULL )
+            return out;
+        auto releaser = [](libvlc_audio_output_t* ptr) { libvlc_audio_output_list_release( ptr ); };
+        std::unique_ptr<libvlc_audio_output_t, decltype(releaser)> ptr( result, releaser );
+        for ( libvlc_audio_output_t* p = result; p != NULL; p = p->p_next )
+            *out++ = AudioOutputDescription( p );
+        return out;
+    }
+
     /**
      * Gets a list of audio output devices for a given audio output module,
      *
@@ -305,16 +324,127 @@ public:
      */
     std::vector<AudioOutputDeviceDescription> audioOutputDeviceList(const std::string& aout)
     {
-        libvlc_audio_output_device_t* devices = libvlc_audio_output_device_list_get( *this, aout.c_str() );
         std::vector<AudioOutputDeviceDescription> res;
+        audioOutputDeviceList( aout, std::back_inserter( res ) );
+        return res;
+    }
+
+    /**
+     * Same as audioOutputDeviceList(), but writes the devices to an output
+     * iterator
+     *
+     * \param aout  audio output name
+     *
+     * \return The iterator past the last written device
+     *
+     * \version LibVLC 2.1.0 or later.
+     */
+    template <typename OutputIt>
+    OutputIt audioOutputDeviceList(const std::string& aout, OutputIt out)
+    {
+        libvlc_audio_output_device_t* devices = libvlc_audio_output_device_list_get( *this, aout.c_str() );
         if ( devices == NULL )
-            return res;
+            return out;
+        auto releaser = [](libvlc_audio_output_device_t* ptr) { libvlc_audio_output_device_list_release( ptr ); };
+        std::unique_ptr<libvlc_audio_output_device_t, decltype(releaser)> ptr( devices, releaser );
         for ( libvlc_audio_output_device_t* p = devices; p != NULL; p = p->p_next )
-            res.emplace_back( p );
-        libvlc_audio_output_device_list_release( devices );
+            *out++ = AudioOutputDeviceDescription( p );
+        return out;
+    }
+
+    /**
+     * Returns the available audio filters.
+     *
+     * Unlike audioFilterList(), the list is only fetched once per instance,
+     * and shared by all callers, and all copies of this Instance.
+     */
+    std::shared_ptr<const ModuleDescriptionList> audioFilters()
+    {
+        if ( m_cache == nullptr )
+            return fetchModules( libvlc_audio_filter_list_get( *this ) );
+        std::call_once( m_cache->audioFiltersOnce, [this] {
+            m_cache->audioFilters = fetchModules( libvlc_audio_filter_list_get( *this ) );
+        });
+        return m_cache->audioFilters;
+    }
+
+    /**
+     * Returns the available video filters.
+     *
+     * Unlike videoFilterList(), the list is only fetched once per instance,
+     * and shared by all callers, and all copies of this Instance.
+     */
+    std::shared_ptr<const ModuleDescriptionList> videoFilters()
+    {
+        if ( m_cache == nullptr )
+            return fetchModules( libvlc_video_filter_list_get( *this ) );
+        std::call_once( m_cache->videoFiltersOnce, [this] {
+            m_cache->videoFilters = fetchModules( libvlc_video_filter_list_get( *this ) );
+        });
+        return m_cache->videoFilters;
+    }
+
+    /**
+     * Returns the available audio output modules.
+     *
+     * Unlike audioOutputList(), the list is only fetched once per instance,
+     * and shared by all callers, and all copies of this Instance.
+     */
+    std::shared_ptr<const AudioOutputDescriptionList> audioOutputs()
+    {
+        if ( m_cache == nullptr )
+            return fetchAudioOutputs();
+        std::call_once( m_cache->audioOutputsOnce, [this] {
+            m_cache->audioOutputs = fetchAudioOutputs();
+        });
+        return m_cache->audioOutputs;
+    }
+
+private:
+    // The module lists don't change during the lifetime of an instance
+    struct Cache
+    {
+        std::once_flag audioFiltersOnce;
+        std::once_flag videoFiltersOnce;
+        std::once_flag audioOutputsOnce;
+        std::shared_ptr<const ModuleDescriptionList> audioFilters;
+        std::shared_ptr<const ModuleDescriptionList> videoFilters;
+        std::shared_ptr<const AudioOutputDescriptionList> audioOutputs;
+    };
+
+    static std::shared_ptr<const ModuleDescriptionList> fetchModules( libvlc_module_description_t* list )
+    {
+        auto res = std::make_shared<const ModuleDescriptionList>( list );
+        if ( list != nullptr )
+            libvlc_module_description_list_release( list );
         return res;
     }
 
+    std::shared_ptr<const AudioOutputDescriptionList> fetchAudioOutputs()
+    {
+        auto list = libvlc_audio_output_list_get( *this );
+        auto res = std::make_shared<const AudioOutputDescriptionList>( list );
+        if ( list != nullptr )
+            libvlc_audio_output_list_release( list );
+        return res;
+    }
+
+    template <typename OutputIt>
+    static OutputIt copyModules( libvlc_module_description_t* list, OutputIt out )
+    {
+        if ( list == nullptr )
+            return out;
+        auto releaser = [](libvlc_module_description_t* ptr) { libvlc_module_description_list_release(ptr); };
+        std::unique_ptr<libvlc_module_description_t, decltype(releaser)> ptr( list, releaser );
+        for ( libvlc_module_description_t* p = list; p != NULL; p = p->p_next )
+            *out++ = ModuleDescription( p );
+        return out;
+    }
+
+private:
+    // Null for the instances which weren't created by Instance(argc, argv),
+    // ie. the ones returned by WeakHandle::lock(), which don't cache.
+    std::shared_ptr<Cache> m_cache;
 };
 
 } // namespace VLC
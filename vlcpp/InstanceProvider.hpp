@@ -0,0 +1,219 @@
+/*****************************************************************************
+ * InstanceProvider.hpp: Background and shared Instance construction
+ *****************************************************************************
+ * Copyright © 2015 libvlcpp authors & VideoLAN
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_CXX_INSTANCEPROVIDER_H
+#define LIBVLC_CXX_INSTANCEPROVIDER_H
+
+#include "common.hpp"
+#include "Instance.hpp"
+
+#include <chrono>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace VLC
+{
+
+/**
+ * @brief Creates Instance objects in the background, and shares them
+ *
+ * Creating an instance loads the plugins cache, which can take hundreds of
+ * ms. The provider creates instances on a background thread, as soon as they
+ * are requested, and returns a future to them. Requesting the same arguments
+ * again returns the same instance.
+ *
+ * The intended use is to prefetch() the instance as early as possible, ie.
+ * at the beginning of main(), and only get() it when it's actually needed:
+ *
+ * \code
+ * VLC::InstanceProvider::global().prefetch( { "--no-video-title-show" } );
+ * // ... parse the command line, set up the UI ...
+ * auto instance = VLC::InstanceProvider::global().get( { "--no-video-title-show" } ).get();
+ * \endcode
+ */
+class InstanceProvider
+{
+public:
+    using Arguments = std::vector<std::string>;
+
+    /**
+     * @brief The startup breakdown of an instance
+     */
+    struct Timings
+    {
+        std::chrono::steady_clock::time_point requested;
+        std::chrono::steady_clock::time_point started;
+        std::chrono::steady_clock::time_point completed;
+        bool ready;
+
+        /**
+         * Time between the request and the background thread starting
+         */
+        std::chrono::microseconds queued() const
+        {
+            return std::chrono::duration_cast<std::chrono::microseconds>( started - requested );
+        }
+
+        /**
+         * Time spent in libvlc_new
+         */
+        std::chrono::microseconds construction() const
+        {
+            return std::chrono::duration_cast<std::chrono::microseconds>( completed - started );
+        }
+
+        /**
+         * Time between the request and the instance being available
+         */
+        std::chrono::microseconds total() const
+        {
+            return std::chrono::duration_cast<std::chrono::microseconds>( completed - requested );
+        }
+    };
+
+    InstanceProvider() = default;
+    InstanceProvider(const InstanceProvider&) = delete;
+    InstanceProvider& operator=(const InstanceProvider&) = delete;
+
+    /**
+     * The process wide provider.
+     *
+     * It is intentionally leaked, along with its instances: releasing them
+     * during the static destruction would race with the objects still using
+     * them, ie. players owned by other static objects, or by threads still
+     * running. Use a provider of your own to control the instances lifetime.
+     */
+    static InstanceProvider& global()
+    {
+        static InstanceProvider* provider = new InstanceProvider;
+        return *provider;
+    }
+
+    /**
+     * Get the instance created with the provided arguments, creating it in
+     * the background if it wasn't requested before.
+     *
+     * If the creation fails, the future holds a std::runtime_error. Failures
+     * aren't cached: once it is reported, the next request tries again.
+     */
+    std::shared_future<Instance> get(const Arguments& args = {})
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        auto it = m_entries.find( args );
+        if ( it != m_entries.end() )
+        {
+            if ( hasFailed( it->second.future ) == false )
+                return it->second.future;
+            m_entries.erase( it );
+        }
+        auto timings = std::make_shared<Timings>();
+        timings->requested = std::chrono::steady_clock::now();
+        timings->ready = false;
+        Entry e;
+        e.timings = timings;
+        e.future = std::async( std::launch::async, [args, timings]() {
+            std::vector<const char*> argv;
+            argv.reserve( args.size() );
+            for ( const auto& a : args )
+                argv.push_back( a.c_str() );
+            auto start = std::chrono::steady_clock::now();
+            Instance instance( static_cast<int>( argv.size() ), argv.data() );
+            auto end = std::chrono::steady_clock::now();
+            // The timings are published through the future, which
+            // synchronizes with its readers
+            timings->started = start;
+            timings->completed = end;
+            timings->ready = true;
+            return instance;
+        }).share();
+        auto res = e.future;
+        m_entries.emplace( args, std::move( e ) );
+        return res;
+    }
+
+    /**
+     * Start creating an instance in the background
+     */
+    void prefetch(const Arguments& args = {})
+    {
+        get( args );
+    }
+
+    /**
+     * Returns the startup breakdown of an instance, or a Timings object
+     * with its ready flag unset if the instance isn't available yet.
+     */
+    Timings timings(const Arguments& args = {}) const
+    {
+        std::shared_future<Instance> future;
+        std::shared_ptr<Timings> timings;
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            auto it = m_entries.find( args );
+            if ( it == m_entries.end() )
+                return Timings{};
+            future = it->second.future;
+            timings = it->second.timings;
+        }
+        if ( future.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready )
+        {
+            Timings t{};
+            t.requested = timings->requested;
+            return t;
+        }
+        return *timings;
+    }
+
+private:
+    static bool hasFailed(const std::shared_future<Instance>& future)
+    {
+        if ( future.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready )
+            return false;
+        try
+        {
+            future.get();
+        }
+        catch ( ... )
+        {
+            return true;
+        }
+        return false;
+    }
+
+private:
+    struct Entry
+    {
+        std::shared_future<Instance> future;
+        std::shared_ptr<Timings> timings;
+    };
+
+    std::map<Arguments, Entry> m_entries;
+    mutable std::mutex m_mutex;
+};
+
+} // namespace VLC
+
+#endif
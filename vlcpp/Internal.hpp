@@ -25,20 +25,194 @@
 
 #include <cassert>
 #include <stdlib.h>
-#include <vlc/libvlc.h>
+#include <vlc/vlc.h>
+#include <cstdint>
 #include <memory>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
 
 namespace VLC
 {
 
+/**
+ * Describes how to retain & release a libvlc object.
+ *
+ * This is only specialized for the objects whose *_retain & *_release
+ * functions are thread safe, and can therefore be held by an IntrusivePtr,
+ * as long as their handle doesn't own anything else.
+ */
+template <typename T>
+struct RetainTraits
+{
+    static constexpr bool Supported = false;
+};
+
+template <>
+struct RetainTraits<libvlc_instance_t>
+{
+    static constexpr bool Supported = true;
+    static void retain( libvlc_instance_t* obj ) { libvlc_retain( obj ); }
+    static void release( libvlc_instance_t* obj ) { libvlc_release( obj ); }
+};
+
+template <>
+struct RetainTraits<libvlc_media_list_t>
+{
+    static constexpr bool Supported = true;
+    static void retain( libvlc_media_list_t* obj ) { libvlc_media_list_retain( obj ); }
+    static void release( libvlc_media_list_t* obj ) { libvlc_media_list_release( obj ); }
+};
+
+template <>
+struct RetainTraits<libvlc_media_list_player_t>
+{
+    static constexpr bool Supported = true;
+    static void retain( libvlc_media_list_player_t* obj ) { libvlc_media_list_player_retain( obj ); }
+    static void release( libvlc_media_list_player_t* obj ) { libvlc_media_list_player_release( obj ); }
+};
+
+// libvlc_media_t and libvlc_media_library_t aren't supported: up to libvlc
+// 3.0, their refcount is a plain integer, while Media objects are created &
+// dropped from the event threads.
+// libvlc_media_player_t isn't supported: its handle also owns the callbacks
+// given to libvlc, which must only be freed after the player, see MediaPlayer.
+
+/**
+ * @brief A single word smart pointer, relying on libvlc's own refcount.
+ *
+ * Copying the pointer retains the object, destroying it releases it. Unlike
+ * std::shared_ptr, there is no control block to allocate.
+ *
+ * The lowest bit flags borrowed pointers, which neither retain nor release
+ * their object. libvlc objects are heap allocated, so this bit is never set
+ * in their address.
+ *
+ * It exposes the subset of the std::shared_ptr interface used by Internal.
+ */
+template <typename T>
+class IntrusivePtr
+{
+    public:
+        IntrusivePtr() noexcept
+            : m_ptr( 0 )
+        {
+        }
+
+        // Adopts the caller's reference. The releaser is ignored, since
+        // RetainTraits<T>::release is the one matching *_retain
+        template <typename Releaser>
+        IntrusivePtr( T* obj, Releaser ) noexcept
+            : m_ptr( reinterpret_cast<uintptr_t>( obj ) )
+        {
+        }
+
+        IntrusivePtr( const IntrusivePtr& p ) noexcept
+            : m_ptr( p.m_ptr )
+        {
+            if ( isOwned() )
+                RetainTraits<T>::retain( get() );
+        }
+
+        IntrusivePtr( IntrusivePtr&& p ) noexcept
+            : m_ptr( p.m_ptr )
+        {
+            p.m_ptr = 0;
+        }
+
+        ~IntrusivePtr()
+        {
+            if ( isOwned() )
+                RetainTraits<T>::release( get() );
+        }
+
+        IntrusivePtr& operator=( IntrusivePtr p ) noexcept
+        {
+            std::swap( m_ptr, p.m_ptr );
+            return *this;
+        }
+
+        static IntrusivePtr borrow( T* obj ) noexcept
+        {
+            assert( ( reinterpret_cast<uintptr_t>( obj ) & Borrowed ) == 0 );
+            IntrusivePtr p;
+            if ( obj != nullptr )
+                p.m_ptr = reinterpret_cast<uintptr_t>( obj ) | Borrowed;
+            return p;
+        }
+
+        template <typename Releaser>
+        void reset( T* obj, Releaser releaser )
+        {
+            *this = IntrusivePtr{ obj, releaser };
+        }
+
+        T* get() const noexcept
+        {
+            return reinterpret_cast<T*>( m_ptr & ~Borrowed );
+        }
+
+        explicit operator bool() const noexcept
+        {
+            return m_ptr != 0;
+        }
+
+        bool operator==( const IntrusivePtr& p ) const noexcept
+        {
+            return get() == p.get();
+        }
+
+        bool operator!=( const IntrusivePtr& p ) const noexcept
+        {
+            return get() != p.get();
+        }
+
+    private:
+        bool isOwned() const noexcept
+        {
+            return m_ptr != 0 && ( m_ptr & Borrowed ) == 0;
+        }
+
+    private:
+        static constexpr uintptr_t Borrowed = 1;
+        uintptr_t m_ptr;
+};
+
+/**
+ * The smart pointer type used to hold a libvlc object.
+ *
+ * This is a std::shared_ptr by default. When VLCPP_INTRUSIVE_HANDLES is
+ * defined, only the instances, media lists and media list players are held
+ * by an IntrusivePtr instead, see RetainTraits. Their refcount is protected
+ * by a lock, so their handles can be copied from any thread, as with
+ * std::shared_ptr. Every other object, Media and MediaPlayer included, stays
+ * held by a std::shared_ptr.
+ *
+ * VLCPP_INTRUSIVE_HANDLES changes the layout of the handle classes. It must
+ * therefore be defined, or not, identically in every translation unit of a
+ * program, including the libraries exchanging libvlcpp objects with it, or
+ * the program violates the one definition rule.
+ */
+#ifdef VLCPP_INTRUSIVE_HANDLES
+template <typename T>
+using HandlePointer = typename std::conditional<RetainTraits<T>::Supported,
+                                                IntrusivePtr<T>, std::shared_ptr<T>>::type;
+#else
+template <typename T>
+using HandlePointer = std::shared_ptr<T>;
+#endif
+
+template <typename T>
+class WeakHandle;
+
 template <typename T, typename Releaser = void(*)(T*)>
 class Internal
 {
     public:
         using InternalType  = T;
         using InternalPtr   = T*;
-        using Pointer       = std::shared_ptr<T>;
+        using Pointer       = HandlePointer<T>;
+        using InternalBase  = Internal;
 
         InternalPtr get() const { return m_obj.get(); }
 
@@ -62,8 +236,32 @@ class Internal
         {
         }
 
+        // Wraps obj without owning a reference to it. Neither policy allocates
+        // nor touches the refcount, which makes this cheap enough to be
+        // used when iterating over large collections.
+        // obj must outlive the returned pointer, and all of its copies.
+        static Pointer borrowed( InternalPtr obj )
+        {
+            return borrowed( obj, static_cast<Pointer*>( nullptr ) );
+        }
+
+    private:
+        // Uses the aliasing constructor, which doesn't allocate a control block
+        static std::shared_ptr<T> borrowed( InternalPtr obj, std::shared_ptr<T>* )
+        {
+            return std::shared_ptr<T>{ std::shared_ptr<T>{}, obj };
+        }
+
+        static IntrusivePtr<T> borrowed( InternalPtr obj, IntrusivePtr<T>* )
+        {
+            return IntrusivePtr<T>::borrow( obj );
+        }
+
     protected:
         Pointer     m_obj;
+
+        template <typename>
+        friend class WeakHandle;
 };
 
 }
@@ -0,0 +1,411 @@
+/*****************************************************************************
+ * LogCapture.hpp: Asynchronous libvlc log capture
+ *****************************************************************************
+ * Copyright © 2015 libvlcpp authors & VideoLAN
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_CXX_LOGCAPTURE_H
+#define LIBVLC_CXX_LOGCAPTURE_H
+
+#include "common.hpp"
+#include "Instance.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace VLC
+{
+
+/**
+ * @brief Captures libvlc logs without blocking the libvlc threads
+ *
+ * Messages are filtered by level and rate limited per module before being
+ * formatted. They are then formatted, with a bounded length, directly into a
+ * slot of a lock-free ring buffer. Since a va_list can't outlive the log
+ * callback, the formatting itself can't be deferred, but this is the only
+ * work performed on the libvlc thread.
+ *
+ * A consumer thread drains the ring and forwards the records to the sinks.
+ * When the ring is full, messages are dropped and counted.
+ */
+class LogCapture
+{
+public:
+    /**
+     * @brief A captured message
+     *
+     * The strings are only valid for the duration of the sink invocation.
+     */
+    struct Record
+    {
+        int level;
+        const char* module;
+        const char* file;
+        unsigned int line;
+        // The object type, ie. "input", "decoder"...
+        const char* objectName;
+        const char* objectHeader;
+        uintptr_t objectId;
+        const char* message;
+        // True if the message didn't fit in the slot
+        bool truncated;
+        std::chrono::system_clock::time_point timestamp;
+    };
+
+    using Sink = std::function<void(const Record&)>;
+
+    struct Stats
+    {
+        // Messages forwarded to the sinks
+        uint64_t captured;
+        // Messages discarded because the ring was full
+        uint64_t dropped;
+        // Messages discarded by the per-module rate limit
+        uint64_t rateLimited;
+        // Messages discarded by the level filter
+        uint64_t filtered;
+    };
+
+    /**
+     * \param capacity    The number of messages the ring can hold, rounded up
+     *                    to a power of 2
+     * \param rateLimit   The maximum number of messages per second for each
+     *                    module, or 0 for no limit
+     */
+    explicit LogCapture(size_t capacity = 1024, unsigned int rateLimit = 0)
+        : m_minLevel( LIBVLC_DEBUG )
+        , m_rateLimit( rateLimit )
+        , m_enqueuePos( 0 )
+        , m_dequeuePos( 0 )
+        , m_captured( 0 )
+        , m_dropped( 0 )
+        , m_rateLimited( 0 )
+        , m_filtered( 0 )
+        , m_stop( false )
+    {
+        size_t size = 1;
+        while ( size < capacity )
+            size <<= 1;
+        m_mask = size - 1;
+        m_slots.reset( new Slot[size] );
+        for ( size_t i = 0; i < size; ++i )
+            m_slots[i].sequence.store( i, std::memory_order_relaxed );
+        for ( auto& b : m_buckets )
+        {
+            b.window.store( 0, std::memory_order_relaxed );
+            b.count.store( 0, std::memory_order_relaxed );
+        }
+        m_consumer = std::thread( &LogCapture::run, this );
+    }
+
+    /**
+     * Detaches from the instance, if any, and flushes the pending messages
+     * to the sinks.
+     */
+    ~LogCapture()
+    {
+        detach();
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_stop = true;
+        }
+        m_cond.notify_all();
+        m_consumer.join();
+    }
+
+    LogCapture(const LogCapture&) = delete;
+    LogCapture& operator=(const LogCapture&) = delete;
+
+    /**
+     * Start capturing the logs of an instance.
+     *
+     * This replaces any previous logging callback of the instance.
+     */
+    void attach(Instance& instance)
+    {
+        detach();
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_instance = instance;
+        m_instance.logSet( &LogCapture::onLog, this );
+    }
+
+    /**
+     * Stop capturing the logs. When this returns, the log callback won't be
+     * invoked anymore.
+     */
+    void detach()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        if ( m_instance.isValid() == false )
+            return;
+        m_instance.logUnset();
+        m_instance = Instance{};
+    }
+
+    /**
+     * Discard messages below the provided level (one of libvlc_log_level)
+     */
+    void setLevel(int minLevel)
+    {
+        m_minLevel.store( minLevel, std::memory_order_relaxed );
+    }
+
+    /**
+     * Set the maximum number of messages per second for each module, or 0
+     * for no limit.
+     *
+     * Modules are tracked through a fixed size hash table, so modules sharing
+     * a bucket share their budget.
+     */
+    void setRateLimit(unsigned int perSecond)
+    {
+        m_rateLimit.store( perSecond, std::memory_order_relaxed );
+    }
+
+    /**
+     * Add a sink. Sinks are invoked from the consumer thread.
+     */
+    void addSink(Sink sink)
+    {
+        std::lock_guard<std::mutex> lock( m_sinkMutex );
+        m_sinks.push_back( std::move( sink ) );
+    }
+
+    Stats stats() const
+    {
+        return Stats{
+            m_captured.load( std::memory_order_relaxed ),
+            m_dropped.load( std::memory_order_relaxed ),
+            m_rateLimited.load( std::memory_order_relaxed ),
+            m_filtered.load( std::memory_order_relaxed ),
+        };
+    }
+
+private:
+    static constexpr size_t MessageSize = 512;
+    static constexpr size_t NameSize = 32;
+    static constexpr size_t NbBuckets = 256;
+
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        int level;
+        unsigned int line;
+        uintptr_t objectId;
+        bool truncated;
+        const char* file;
+        std::chrono::system_clock::time_point timestamp;
+        char module[NameSize];
+        char objectName[NameSize];
+        char objectHeader[NameSize];
+        char message[MessageSize];
+    };
+
+    struct RateBucket
+    {
+        std::atomic<int64_t> window;
+        std::atomic<uint32_t> count;
+    };
+
+    static void copyString(char* dst, const char* src, size_t size)
+    {
+        if ( src == nullptr )
+        {
+            dst[0] = 0;
+            return;
+        }
+        strncpy( dst, src, size - 1 );
+        dst[size - 1] = 0;
+    }
+
+    static void onLog(void* data, int level, const libvlc_log_t* ctx, const char* fmt, va_list args)
+    {
+        reinterpret_cast<LogCapture*>( data )->capture( level, ctx, fmt, args );
+    }
+
+    bool allow(const char* module, std::chrono::system_clock::time_point now)
+    {
+        auto limit = m_rateLimit.load( std::memory_order_relaxed );
+        if ( limit == 0 )
+            return true;
+        // FNV-1a
+        uint32_t hash = 2166136261u;
+        for ( auto p = module; p != nullptr && *p != 0; ++p )
+            hash = ( hash ^ (uint8_t)*p ) * 16777619u;
+        // FNV low bits are poorly distributed
+        hash ^= hash >> 16;
+        auto& bucket = m_buckets[hash % NbBuckets];
+        int64_t second = std::chrono::duration_cast<std::chrono::seconds>(
+                    now.time_since_epoch() ).count();
+        auto window = bucket.window.load( std::memory_order_relaxed );
+        if ( window != second &&
+             bucket.window.compare_exchange_strong( window, second, std::memory_order_relaxed ) )
+            bucket.count.store( 0, std::memory_order_relaxed );
+        return bucket.count.fetch_add( 1, std::memory_order_relaxed ) < limit;
+    }
+
+    void capture(int level, const libvlc_log_t* ctx, const char* fmt, va_list args)
+    {
+        if ( level < m_minLevel.load( std::memory_order_relaxed ) )
+        {
+            m_filtered.fetch_add( 1, std::memory_order_relaxed );
+            return;
+        }
+        const char* module = nullptr;
+        const char* file = nullptr;
+        unsigned int line = 0;
+        libvlc_log_get_context( ctx, &module, &file, &line );
+        auto now = std::chrono::system_clock::now();
+        if ( allow( module, now ) == false )
+        {
+            m_rateLimited.fetch_add( 1, std::memory_order_relaxed );
+            return;
+        }
+
+        // Claim a slot (Vyukov's bounded MPMC queue)
+        auto pos = m_enqueuePos.load( std::memory_order_relaxed );
+        Slot* slot;
+        while ( true )
+        {
+            slot = &m_slots[pos & m_mask];
+            auto seq = slot->sequence.load( std::memory_order_acquire );
+            auto diff = (intptr_t)seq - (intptr_t)pos;
+            if ( diff == 0 )
+            {
+                if ( m_enqueuePos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+                    break;
+            }
+            else if ( diff < 0 )
+            {
+                m_dropped.fetch_add( 1, std::memory_order_relaxed );
+                return;
+            }
+            else
+                pos = m_enqueuePos.load( std::memory_order_relaxed );
+        }
+
+        const char* objectName = nullptr;
+        const char* objectHeader = nullptr;
+        uintptr_t objectId = 0;
+        libvlc_log_get_object( ctx, &objectName, &objectHeader, &objectId );
+        slot->level = level;
+        slot->line = line;
+        slot->file = file;
+        slot->objectId = objectId;
+        slot->timestamp = now;
+        copyString( slot->module, module, NameSize );
+        copyString( slot->objectName, objectName, NameSize );
+        copyString( slot->objectHeader, objectHeader, NameSize );
+        auto len = vsnprintf( slot->message, MessageSize, fmt, args );
+        slot->truncated = len >= (int)MessageSize;
+        if ( len < 0 )
+            slot->message[0] = 0;
+        slot->sequence.store( pos + 1, std::memory_order_release );
+    }
+
+    // Returns the number of consumed messages
+    size_t drain()
+    {
+        size_t nb = 0;
+        std::lock_guard<std::mutex> lock( m_sinkMutex );
+        while ( true )
+        {
+            auto& slot = m_slots[m_dequeuePos & m_mask];
+            if ( slot.sequence.load( std::memory_order_acquire ) != m_dequeuePos + 1 )
+                break;
+            Record r{
+                slot.level, slot.module, slot.file, slot.line, slot.objectName,
+                slot.objectHeader, slot.objectId, slot.message, slot.truncated,
+                slot.timestamp
+            };
+            for ( const auto& s : m_sinks )
+                s( r );
+            slot.sequence.store( m_dequeuePos + m_mask + 1, std::memory_order_release );
+            ++m_dequeuePos;
+            ++nb;
+        }
+        m_captured.fetch_add( nb, std::memory_order_relaxed );
+        return nb;
+    }
+
+    void run()
+    {
+        // Producers don't signal the consumer, since this would require
+        // locking on the libvlc threads. Poll instead, with a backoff.
+        auto delay = std::chrono::milliseconds( 1 );
+        const auto maxDelay = std::chrono::milliseconds( 20 );
+        std::unique_lock<std::mutex> lock( m_mutex );
+        while ( true )
+        {
+            lock.unlock();
+            auto nb = drain();
+            lock.lock();
+            if ( m_stop == true )
+            {
+                lock.unlock();
+                drain();
+                return;
+            }
+            if ( nb != 0 )
+                delay = std::chrono::milliseconds( 1 );
+            else if ( delay < maxDelay )
+                delay *= 2;
+            m_cond.wait_for( lock, delay, [this]() { return m_stop; } );
+        }
+    }
+
+private:
+    std::unique_ptr<Slot[]> m_slots;
+    size_t m_mask;
+    std::array<RateBucket, NbBuckets> m_buckets;
+    std::atomic<int> m_minLevel;
+    std::atomic<unsigned int> m_rateLimit;
+    std::atomic<size_t> m_enqueuePos;
+    // Only accessed by the consumer
+    size_t m_dequeuePos;
+
+    std::atomic<uint64_t> m_captured;
+    std::atomic<uint64_t> m_dropped;
+    std::atomic<uint64_t> m_rateLimited;
+    std::atomic<uint64_t> m_filtered;
+
+    std::vector<Sink> m_sinks;
+    std::mutex m_sinkMutex;
+
+    Instance m_instance;
+    bool m_stop;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::thread m_consumer;
+};
+
+} // namespace VLC
+
+#endif
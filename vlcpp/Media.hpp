@@ -26,6 +26,8 @@
 
 #include "common.hpp"
 
+#include <iterator>
+#include <memory>
 #include <vector>
 #include <stdexcept>
 
@@ -143,6 +145,23 @@ public:
             retain();
     }
 
+    /**
+     * Wrap a media without acquiring a reference to it.
+     *
+     * This doesn't allocate anything, but the caller has to guarantee that
+     * the underlying libvlc_media_t outlives the returned instance, and any
+     * copy of it. This is mostly used to iterate over MediaList.
+     *
+     * \see MediaList::lockedView()
+     * \see MediaList::snapshot()
+     */
+    static Media borrow( Internal::InternalPtr ptr )
+    {
+        Media m;
+        m.m_obj = Internal::borrowed( ptr );
+        return m;
+    }
+
     /**
      * Create an empty VLC Media instance.
      *
@@ -218,6 +237,14 @@ public:
         return str.get();
     }
 
+    /**
+     * Same as mrl(), but returns libvlc's buffer, rather than a copy of it
+     */
+    VlcString mrlView()
+    {
+        return VlcString( libvlc_media_get_mrl(*this) );
+    }
+
     /**
      * Duplicate a media descriptor object.
      */
@@ -255,6 +282,14 @@ public:
         return str.get();
     }
 
+    /**
+     * Same as meta(), but returns libvlc's buffer, rather than a copy of it
+     */
+    VlcString metaView(libvlc_meta_t e_meta)
+    {
+        return VlcString( libvlc_media_get_meta(*this, e_meta) );
+    }
+
     /**
      * Set the meta of the media (this function will not save the meta, call
      * libvlc_media_save_meta in order to save the meta)
@@ -420,18 +455,35 @@ public:
      * \return a vector containing all tracks
      */
     std::vector<MediaTrack> tracks()
+    {
+        std::vector<MediaTrack> res;
+        tracks( std::back_inserter( res ) );
+        return res;
+    }
+
+    /**
+     * Same as tracks(), but writes the tracks to an output iterator, which
+     * lets the caller choose the container and its allocator, ie. a
+     * std::pmr::vector<MediaTrack> backed by a monotonic buffer.
+     *
+     * \version LibVLC 2.1.0 and later.
+     *
+     * \return The iterator past the last written track
+     */
+    template <typename OutputIt>
+    OutputIt tracks( OutputIt out )
     {
         libvlc_media_track_t**  tracks;
         uint32_t                nbTracks = libvlc_media_tracks_get(*this, &tracks);
-        std::vector<MediaTrack> res;
 
         if ( nbTracks == 0 )
-            return res;
+            return out;
 
+        auto releaser = [nbTracks](libvlc_media_track_t** ptr) { libvlc_media_tracks_release( ptr, nbTracks ); };
+        std::unique_ptr<libvlc_media_track_t*, decltype(releaser)> ptr( tracks, releaser );
         for ( uint32_t i = 0; i < nbTracks; ++i )
-            res.emplace_back( tracks[i] );
-        libvlc_media_tracks_release( tracks, nbTracks );
-        return res;
+            *out++ = MediaTrack( tracks[i] );
+        return out;
     }
 
 private:
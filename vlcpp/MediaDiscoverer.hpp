@@ -57,6 +57,13 @@ public:
     {
     }
 
+    /**
+     * Create an empty VLC MediaDiscoverer instance.
+     *
+     * Calling any method on such an instance is undefined.
+    */
+    MediaDiscoverer() = default;
+
 #if LIBVLC_VERSION(3, 0, 0, 0) >= LIBVLC_VERSION_INT
     /**
      * Start media discovery.
@@ -97,6 +104,14 @@ public:
         return str.get();
     }
 
+    /**
+     * Same as localizedName(), but returns libvlc's buffer, rather than a copy of it
+     */
+    VlcString localizedNameView()
+    {
+        return VlcString( libvlc_media_discoverer_localized_name(*this) );
+    }
+
     /**
      * Get event manager from media service discover object.
      *
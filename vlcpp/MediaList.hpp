@@ -26,7 +26,9 @@
 
 #include "common.hpp"
 
+#include <iterator>
 #include <mutex>
+#include <vector>
 
 namespace VLC
 {
@@ -41,6 +43,199 @@ class MediaList : public Internal<libvlc_media_list_t>
 public:
     using Lock = std::lock_guard<MediaList>;
 
+    /**
+     * Input iterator over a View or a Snapshot.
+     *
+     * The yielded Media are borrowed: no reference is acquired and no
+     * allocation is performed while iterating. A yielded Media must not
+     * outlive the View or Snapshot it was obtained from. Use
+     * MediaList::itemAtIndex() if you need to keep a media around.
+     *
+     * The Media is stored in the iterator itself, so the reference returned
+     * by operator* is only valid until the iterator is incremented, which
+     * is why this isn't a forward iterator. Copy the Media if you need it
+     * past that point.
+     */
+    template <typename Source>
+    class BorrowedIterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Media;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Media*;
+        using reference = Media&;
+
+        BorrowedIterator(const Source* source, int index)
+            : m_source( source )
+            , m_index( index )
+        {
+        }
+
+        Media& operator*()
+        {
+            m_media = Media::borrow( m_source->rawItemAt( m_index ) );
+            return m_media;
+        }
+
+        Media* operator->()
+        {
+            return &**this;
+        }
+
+        BorrowedIterator& operator++()
+        {
+            ++m_index;
+            return *this;
+        }
+
+        BorrowedIterator operator++(int)
+        {
+            auto it = *this;
+            ++m_index;
+            return it;
+        }
+
+        bool operator==(const BorrowedIterator& it) const
+        {
+            return m_source == it.m_source && m_index == it.m_index;
+        }
+
+        bool operator!=(const BorrowedIterator& it) const
+        {
+            return !( *this == it );
+        }
+
+    private:
+        const Source* m_source;
+        int m_index;
+        Media m_media;
+    };
+
+    /**
+     * A range over the items of a MediaList, holding the list lock for its
+     * whole lifetime.
+     *
+     * \see MediaList::lockedView()
+     */
+    class View
+    {
+    public:
+        using iterator = BorrowedIterator<View>;
+
+        explicit View(MediaList& list)
+            : m_list( list.get() )
+        {
+            libvlc_media_list_lock( m_list );
+            m_count = libvlc_media_list_count( m_list );
+        }
+
+        ~View()
+        {
+            if ( m_list != nullptr )
+                libvlc_media_list_unlock( m_list );
+        }
+
+        View(View&& v)
+            : m_list( v.m_list )
+            , m_count( v.m_count )
+        {
+            v.m_list = nullptr;
+        }
+
+        View(const View&) = delete;
+        View& operator=(const View&) = delete;
+
+        iterator begin() const
+        {
+            return iterator{ this, 0 };
+        }
+
+        iterator end() const
+        {
+            return iterator{ this, m_count };
+        }
+
+        int size() const
+        {
+            return m_count;
+        }
+
+        libvlc_media_t* rawItemAt(int index) const
+        {
+            // The list holds a reference for as long as it is locked, we
+            // don't need the one libvlc acquires on our behalf.
+            auto ptr = libvlc_media_list_item_at_index( m_list, index );
+            if ( ptr != nullptr )
+                libvlc_media_release( ptr );
+            return ptr;
+        }
+
+    private:
+        libvlc_media_list_t* m_list;
+        int m_count;
+    };
+
+    /**
+     * A copy of the media pointers contained in a MediaList at a given time.
+     *
+     * All references are acquired in a single pass, with the list lock held.
+     * The list can then be modified freely while the snapshot is in use.
+     *
+     * \see MediaList::snapshot()
+     */
+    class Snapshot
+    {
+    public:
+        using iterator = BorrowedIterator<Snapshot>;
+
+        explicit Snapshot(MediaList& list)
+        {
+            View v( list );
+            m_items.reserve( v.size() );
+            for ( int i = 0; i < v.size(); ++i )
+            {
+                // Keep the reference libvlc acquired for us
+                auto ptr = libvlc_media_list_item_at_index( list, i );
+                if ( ptr != nullptr )
+                    m_items.push_back( ptr );
+            }
+        }
+
+        ~Snapshot()
+        {
+            for ( auto ptr : m_items )
+                libvlc_media_release( ptr );
+        }
+
+        Snapshot(Snapshot&& s) = default;
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+
+        iterator begin() const
+        {
+            return iterator{ this, 0 };
+        }
+
+        iterator end() const
+        {
+            return iterator{ this, size() };
+        }
+
+        int size() const
+        {
+            return (int)m_items.size();
+        }
+
+        libvlc_media_t* rawItemAt(int index) const
+        {
+            return m_items[index];
+        }
+
+    private:
+        std::vector<libvlc_media_t*> m_items;
+    };
+
     /**
      * Check if 2 MediaList objects contain the same libvlc_media_list_t.
      * \param another another MediaList
@@ -206,6 +401,36 @@ public:
         return libvlc_media_list_is_readonly(*this) == 1;
     }
 
+    /**
+     * Lock the list and iterate over its items.
+     *
+     * The lock is held until the returned View is destroyed. Media are
+     * yielded as borrowed references, without any per-item allocation:
+     *
+     * \code
+     * for ( auto& m : list.lockedView() )
+     *     std::cout << m.mrl() << std::endl;
+     * \endcode
+     *
+     * The list must not be locked by the calling thread already.
+     */
+    View lockedView()
+    {
+        return View{ *this };
+    }
+
+    /**
+     * Copy the media pointers contained in this list, acquiring a reference
+     * to each of them in a single pass.
+     *
+     * Unlike lockedView(), the list lock is only held while the snapshot is
+     * being built.
+     */
+    Snapshot snapshot()
+    {
+        return Snapshot{ *this };
+    }
+
     /**
      * Get lock on media list items
      */
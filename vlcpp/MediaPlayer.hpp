@@ -25,24 +25,32 @@
 #define LIBVLC_CXX_MEDIAPLAYER_H
 
 #include <array>
+#include <future>
+#include <iterator>
 #include <string>
 #include <vector>
 #include <memory>
 
 #include "common.hpp"
+#include "Reaper.hpp"
 
 namespace VLC
 {
 
 class AudioOutputDeviceDescription;
+class Equalizer;
 class TrackDescription;
 class Instance;
 class Media;
 class MediaPlayerEventManager;
 
-class MediaPlayer : public Internal<libvlc_media_player_t>, private EventOwner<13>
+// EventOwner comes first, so the callbacks exist when the handle is created
+class MediaPlayer : private EventOwner<13>,
+                    public Internal<libvlc_media_player_t, CallbacksReleaser<libvlc_media_player_t, 13>>
 {
 private:
+    using Releaser = CallbacksReleaser<libvlc_media_player_t, 13>;
+
     enum class EventIdx : unsigned int
     {
         AudioPlay,
@@ -79,7 +87,8 @@ public:
      * Player should be created.
      */
     MediaPlayer(Instance& instance )
-        : Internal{ libvlc_media_player_new( instance ), libvlc_media_player_release }
+        : EventOwner<13>( std::make_shared<Callbacks>() )
+        , Internal{ libvlc_media_player_new( instance ), Releaser{ libvlc_media_player_release, callbacks } }
     {
     }
 
@@ -90,9 +99,10 @@ public:
      * \param p_md  the media. Afterwards the p_md can be safely destroyed.
      */
     MediaPlayer( Media& md )
-        : Internal{ libvlc_media_player_new_from_media(
+        : EventOwner<13>( std::make_shared<Callbacks>() )
+        , Internal{ libvlc_media_player_new_from_media(
                         getInternalPtr<libvlc_media_t>( md ) ),
-                    libvlc_media_player_release }
+                    Releaser{ libvlc_media_player_release, callbacks } }
     {
     }
 
@@ -190,6 +200,36 @@ public:
         libvlc_media_player_stop(*this);
     }
 
+    /**
+     * Stop, without blocking the calling thread
+     *
+     * The player is stopped from one of the Reaper::instance() threads, which
+     * holds a reference to it until then.
+     *
+     * \return A future, ready once the player has been stopped
+     */
+    std::future<void> stopAsync()
+    {
+        MediaPlayer self( *this );
+        return Reaper::instance().post( [self]() mutable {
+            self.stop();
+        });
+    }
+
+    /**
+     * Drop this reference from a background thread
+     *
+     * If this was the last reference to the player, it is stopped and
+     * released by one of the Reaper::instance() threads. The callbacks
+     * remain valid until then. This object is left empty.
+     *
+     * \return A future, ready once the reference has been dropped
+     */
+    std::future<void> releaseAsync()
+    {
+        return Reaper::instance().release( std::move( *this ) );
+    }
+
     /**
      * Set the NSView handler where the media player should render its video
      * output.
@@ -669,6 +709,36 @@ public:
         return libvlc_media_player_set_equalizer(*this, p_equalizer);
     }
 
+    /**
+     * Apply new equalizer settings to a media player.
+     *
+     * The media player does not keep a reference to the equalizer, which
+     * can be modified or destroyed afterward.
+     *
+     * \param equalizer  The equalizer to apply
+     *
+     * \return zero on success, -1 on error
+     *
+     * \version LibVLC 2.2.0 or later
+     */
+    int setEqualizer(Equalizer& equalizer)
+    {
+        return libvlc_media_player_set_equalizer( *this,
+                    getInternalPtr<libvlc_equalizer_t>( equalizer ) );
+    }
+
+    /**
+     * Disable the equalizer for this media player
+     *
+     * \return zero on success, -1 on error
+     *
+     * \version LibVLC 2.2.0 or later
+     */
+    int unsetEqualizer()
+    {
+        return libvlc_media_player_set_equalizer( *this, nullptr );
+    }
+
     /**
      * Set callbacks and private data for decoded audio. Use
      * MediaPlayer::setFormat() or MediaPlayer::setFormatCallbacks() to configure the
@@ -706,9 +776,8 @@ public:
             CallbackWrapper<(int)EventIdx::AudioResume,   ResumeCb,libvlc_audio_resume_cb>::wrap( this, std::forward<ResumeCb>( resume ) ),
             CallbackWrapper<(int)EventIdx::AudioFlush,    FlushCb, libvlc_audio_flush_cb>::wrap(  this, std::forward<FlushCb>( flush ) ),
             CallbackWrapper<(int)EventIdx::AudioDrain,    DrainCb, libvlc_audio_drain_cb>::wrap(  this, std::forward<DrainCb>( drain ) ),
-            // We will receive the pointer as a void*, we need to offset the value *now*, otherwise we'd get
-            // a shifted value, resulting in an empty callback array.
-            static_cast<EventOwner<13>*>( this ) );
+            // The callbacks block is what the wrappers expect as their opaque pointer
+            EventOwner<13>::callbacks.get() );
     }
 
     /**
@@ -812,14 +881,30 @@ public:
      */
     std::vector<AudioOutputDeviceDescription> outputDeviceEnum()
     {
-        libvlc_audio_output_device_t* devices = libvlc_audio_output_device_enum(*this);
         std::vector<AudioOutputDeviceDescription> res;
+        outputDeviceEnum( std::back_inserter( res ) );
+        return res;
+    }
+
+    /**
+     * Same as outputDeviceEnum(), but writes the devices to an output
+     * iterator
+     *
+     * \return The iterator past the last written device
+     *
+     * \version LibVLC 2.2.0 or later.
+     */
+    template <typename OutputIt>
+    OutputIt outputDeviceEnum( OutputIt out )
+    {
+        libvlc_audio_output_device_t* devices = libvlc_audio_output_device_enum(*this);
         if ( devices == NULL )
-            return res;
+            return out;
+        auto releaser = [](libvlc_audio_output_device_t* ptr) { libvlc_audio_output_device_list_release( ptr ); };
+        std::unique_ptr<libvlc_audio_output_device_t, decltype(releaser)> ptr( devices, releaser );
         for ( auto* p = devices; p != NULL; p = p->p_next )
-            res.emplace_back( p );
-        libvlc_audio_output_device_list_release( devices );
-        return res;
+            *out++ = AudioOutputDeviceDescription( p );
+        return out;
     }
 
     /**
@@ -944,8 +1029,20 @@ public:
      */
     std::vector<TrackDescription> audioTrackDescription()
     {
-        libvlc_track_description_t* result = libvlc_audio_get_track_description( *this );
-        return getTracksDescription( result );
+        std::vector<TrackDescription> res;
+        audioTrackDescription( std::back_inserter( res ) );
+        return res;
+    }
+
+    /**
+     * Same as audioTrackDescription(), but writes the descriptions to an output iterator
+     *
+     * \return The iterator past the last written description
+     */
+    template <typename OutputIt>
+    OutputIt audioTrackDescription(OutputIt out)
+    {
+        return copyTracksDescription( libvlc_audio_get_track_description( *this ), out );
     }
 
     /**
@@ -1051,9 +1148,8 @@ public:
                 CallbackWrapper<(int)EventIdx::VideoLock, LockCb, libvlc_video_lock_cb>::wrap( this, std::forward<LockCb>( lock ) ),
                 CallbackWrapper<(int)EventIdx::VideoUnlock, UnlockCb, libvlc_video_unlock_cb>::wrap( this, std::forward<UnlockCb>( unlock ) ),
                 CallbackWrapper<(int)EventIdx::VideoDisplay, DisplayCb, libvlc_video_display_cb>::wrap( this, std::forward<DisplayCb>( display ) ),
-                // We will receive the pointer as a void*, we need to offset the value *now*, otherwise we'd get
-                // a shifted value, resulting in an empty callback array.
-                static_cast<EventOwner<13>*>( this ) );
+                // The callbacks block is what the wrappers expect as their opaque pointer
+                EventOwner<13>::callbacks.get() );
     }
 
     /**
@@ -1102,7 +1198,7 @@ public:
         static_assert(signature_match_or_nullptr<CleanupCb, void()>::value, "Unmatched prototype for cleanup callback");
 
         libvlc_video_set_format_callbacks(*this,
-                CallbackWrapper<(int)EventIdx::VideoFormat, FormatCb, libvlc_video_format_cb>::wrap( static_cast<EventOwner<13>*>( this ), std::forward<FormatCb>( setup ) ),
+                CallbackWrapper<(int)EventIdx::VideoFormat, FormatCb, libvlc_video_format_cb>::wrap( this, std::forward<FormatCb>( setup ) ),
                 CallbackWrapper<(int)EventIdx::VideoCleanup, CleanupCb, libvlc_video_cleanup_cb>::wrap( this, std::forward<CleanupCb>( cleanup ) ) );
     }
 
@@ -1226,6 +1322,14 @@ public:
         return str.get();
     }
 
+    /**
+     * Same as aspectRatio(), but returns libvlc's buffer, rather than a copy of it
+     */
+    VlcString aspectRatioView()
+    {
+        return VlcString( libvlc_video_get_aspect_ratio(*this) );
+    }
+
     /**
      * Set new video aspect ratio.
      *
@@ -1265,8 +1369,20 @@ public:
      */
     std::vector<TrackDescription> spuDescription()
     {
-        libvlc_track_description_t* result = libvlc_video_get_spu_description( *this );
-        return getTracksDescription( result );
+        std::vector<TrackDescription> res;
+        spuDescription( std::back_inserter( res ) );
+        return res;
+    }
+
+    /**
+     * Same as spuDescription(), but writes the descriptions to an output iterator
+     *
+     * \return The iterator past the last written description
+     */
+    template <typename OutputIt>
+    OutputIt spuDescription(OutputIt out)
+    {
+        return copyTracksDescription( libvlc_video_get_spu_description( *this ), out );
     }
 
     /**
@@ -1335,8 +1451,20 @@ public:
      */
     std::vector<TrackDescription> titleDescription()
     {
-        libvlc_track_description_t* result = libvlc_video_get_title_description( *this );
-        return getTracksDescription( result );
+        std::vector<TrackDescription> res;
+        titleDescription( std::back_inserter( res ) );
+        return res;
+    }
+
+    /**
+     * Same as titleDescription(), but writes the descriptions to an output iterator
+     *
+     * \return The iterator past the last written description
+     */
+    template <typename OutputIt>
+    OutputIt titleDescription(OutputIt out)
+    {
+        return copyTracksDescription( libvlc_video_get_title_description( *this ), out );
     }
 
     /**
@@ -1349,8 +1477,20 @@ public:
      */
     std::vector<TrackDescription> chapterDescription(int i_title)
     {
-        libvlc_track_description_t* result = libvlc_video_get_chapter_description( *this, i_title );
-        return getTracksDescription( result );
+        std::vector<TrackDescription> res;
+        chapterDescription( i_title, std::back_inserter( res ) );
+        return res;
+    }
+
+    /**
+     * Same as chapterDescription(), but writes the descriptions to an output iterator
+     *
+     * \return The iterator past the last written description
+     */
+    template <typename OutputIt>
+    OutputIt chapterDescription(int i_title, OutputIt out)
+    {
+        return copyTracksDescription( libvlc_video_get_chapter_description( *this, i_title ), out );
     }
 
     /**
@@ -1366,6 +1506,14 @@ public:
         return str.get();
     }
 
+    /**
+     * Same as cropGeometry(), but returns libvlc's buffer, rather than a copy of it
+     */
+    VlcString cropGeometryView()
+    {
+        return VlcString( libvlc_video_get_crop_geometry(*this) );
+    }
+
     /**
      * Set new crop filter geometry.
      *
@@ -1414,8 +1562,20 @@ public:
      */
     std::vector<TrackDescription> videoTrackDescription()
     {
-        libvlc_track_description_t* result = libvlc_video_get_track_description( *this );
-        return getTracksDescription( result );
+        std::vector<TrackDescription> res;
+        videoTrackDescription( std::back_inserter( res ) );
+        return res;
+    }
+
+    /**
+     * Same as videoTrackDescription(), but writes the descriptions to an output iterator
+     *
+     * \return The iterator past the last written description
+     */
+    template <typename OutputIt>
+    OutputIt videoTrackDescription(OutputIt out)
+    {
+        return copyTracksDescription( libvlc_video_get_track_description( *this ), out );
     }
 
     /**
@@ -1498,6 +1658,14 @@ public:
         return str.get();
     }
 
+    /**
+     * Same as marqueeString(), but returns libvlc's buffer, rather than a copy of it
+     */
+    VlcString marqueeStringView(unsigned option)
+    {
+        return VlcString( libvlc_video_get_marquee_string(*this, option) );
+    }
+
     /**
      * Enable, disable or set an integer marquee option
      *
@@ -1629,21 +1797,31 @@ public:
     }
 
 private:
-    std::vector<TrackDescription> getTracksDescription( libvlc_track_description_t* tracks ) const
+    template <typename OutputIt>
+    static OutputIt copyTracksDescription( libvlc_track_description_t* tracks, OutputIt out )
     {
-        std::vector<TrackDescription> result;
         if ( tracks == NULL )
-            return result;
-        libvlc_track_description_t* p = tracks;
-        while ( p != NULL )
-        {
-            result.emplace_back( p );
-            p = p->p_next;
-        }
-        libvlc_track_description_list_release(tracks);
-        return result;
+            return out;
+        auto releaser = [](libvlc_track_description_t* ptr) { libvlc_track_description_list_release( ptr ); };
+        std::unique_ptr<libvlc_track_description_t, decltype(releaser)> ptr( tracks, releaser );
+        for ( libvlc_track_description_t* p = tracks; p != NULL; p = p->p_next )
+            *out++ = TrackDescription( p );
+        return out;
+    }
+
+    // Gives a wrapper rebuilt around an existing player, ie. by
+    // WeakHandle::lock(), the callbacks of the wrapper which created it.
+    // The deleter of the handle keeps them alive along with the player.
+    void adoptCallbacks()
+    {
+        auto releaser = std::get_deleter<Releaser>( m_obj );
+        if ( releaser != nullptr )
+            EventOwner<13>::callbacks = releaser->callbacks;
     }
 
+    template <typename>
+    friend class WeakHandle;
+
 private:
     std::shared_ptr<MediaPlayerEventManager> m_eventManager;
 };
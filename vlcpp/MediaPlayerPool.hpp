@@ -0,0 +1,309 @@
+/*****************************************************************************
+ * MediaPlayerPool.hpp: A pool of pre-configured MediaPlayer
+ *****************************************************************************
+ * Copyright © 2015 libvlcpp authors & VideoLAN
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_CXX_MEDIAPLAYERPOOL_H
+#define LIBVLC_CXX_MEDIAPLAYERPOOL_H
+
+#include "common.hpp"
+#include "Instance.hpp"
+#include "Media.hpp"
+#include "MediaPlayer.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace VLC
+{
+
+/**
+ * @brief Keeps a set of pre-configured MediaPlayer ready to be used
+ *
+ * Creating a player and setting up its callbacks, formats and event handlers
+ * takes time, which adds up to the startup latency when switching from a
+ * media to another. The pool creates and configures its players upfront and
+ * hands them out through a Lease, which gives the player back to the pool
+ * when destroyed.
+ *
+ * When no player is available, a new one is created and configured, which
+ * counts as a miss in the statistics.
+ *
+ * Players are heap allocated and never move, so the callbacks set up by the
+ * configurator stay valid for the whole lifetime of the player.
+ * The pool must outlive all of its leases.
+ */
+class MediaPlayerPool
+{
+public:
+    /**
+     * Sets up a newly created player: callbacks, formats, event handlers...
+     */
+    using Configurator = std::function<void(MediaPlayer&)>;
+    /**
+     * Restores the state of a player returned to the pool, on top of the
+     * default reset (stop and normal playback rate).
+     */
+    using Resetter = std::function<void(MediaPlayer&)>;
+
+    /**
+     * Acquisition statistics, used to size the pool
+     */
+    struct Stats
+    {
+        uint64_t acquisitions;
+        uint64_t hits;
+        uint64_t misses;
+        // Time spent in acquire(), in µs
+        uint64_t totalLatency;
+        uint64_t maxLatency;
+
+        double hitRate() const
+        {
+            return acquisitions ? (double)hits / acquisitions : 0.0;
+        }
+
+        uint64_t averageLatency() const
+        {
+            return acquisitions ? totalLatency / acquisitions : 0;
+        }
+    };
+
+    /**
+     * @brief A player borrowed from the pool
+     *
+     * The player is reset and given back to the pool when the lease is
+     * destroyed, or when release() is called.
+     * Since releasing the player stops it, a lease must not be released from
+     * a libvlc event callback.
+     */
+    class Lease
+    {
+    public:
+        Lease() : m_pool( nullptr ) {}
+
+        ~Lease()
+        {
+            release();
+        }
+
+        Lease(Lease&& lease)
+            : m_pool( lease.m_pool )
+            , m_player( std::move( lease.m_player ) )
+        {
+            lease.m_pool = nullptr;
+        }
+
+        Lease& operator=(Lease&& lease)
+        {
+            if ( this != &lease )
+            {
+                release();
+                m_pool = lease.m_pool;
+                m_player = std::move( lease.m_player );
+                lease.m_pool = nullptr;
+            }
+            return *this;
+        }
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        MediaPlayer& operator*() const { return *m_player; }
+        MediaPlayer* operator->() const { return m_player.get(); }
+        MediaPlayer& player() const { return *m_player; }
+
+        explicit operator bool() const { return m_player != nullptr; }
+
+        /**
+         * Gives the player back to the pool ahead of the lease destruction
+         */
+        void release()
+        {
+            if ( m_player == nullptr )
+                return;
+            m_pool->giveBack( std::move( m_player ) );
+            m_pool = nullptr;
+        }
+
+    private:
+        Lease(MediaPlayerPool* pool, std::unique_ptr<MediaPlayer> player)
+            : m_pool( pool )
+            , m_player( std::move( player ) )
+        {
+        }
+
+    private:
+        MediaPlayerPool* m_pool;
+        std::unique_ptr<MediaPlayer> m_player;
+
+        friend class MediaPlayerPool;
+    };
+
+    /**
+     * Create a pool and its players
+     *
+     * \param instance      The instance used to create the players
+     * \param size          The number of idle players kept by the pool
+     * \param configurator  Called once for each new player
+     * \param resetter      Called for each player given back to the pool
+     */
+    MediaPlayerPool(Instance& instance, size_t size, Configurator configurator,
+                    Resetter resetter = nullptr)
+        : m_instance( instance )
+        , m_capacity( size )
+        , m_configurator( std::move( configurator ) )
+        , m_resetter( std::move( resetter ) )
+        , m_stats{}
+    {
+        m_idle.reserve( size );
+        for ( size_t i = 0; i < size; ++i )
+            m_idle.push_back( createPlayer() );
+    }
+
+    MediaPlayerPool(const MediaPlayerPool&) = delete;
+    MediaPlayerPool& operator=(const MediaPlayerPool&) = delete;
+
+    /**
+     * Borrow a player from the pool, or create one if none is idle
+     */
+    Lease acquire()
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto player = take();
+        bool hit = player != nullptr;
+        if ( player == nullptr )
+            player = createPlayer();
+        record( start, hit );
+        return Lease{ this, std::move( player ) };
+    }
+
+    /**
+     * Borrow a player from the pool and set its media
+     *
+     * The time spent setting the media is included in the acquisition
+     * latency.
+     */
+    Lease acquire(Media& md)
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto player = take();
+        bool hit = player != nullptr;
+        if ( player == nullptr )
+            player = createPlayer();
+        player->setMedia( md );
+        record( start, hit );
+        return Lease{ this, std::move( player ) };
+    }
+
+    /**
+     * Number of players currently available
+     */
+    size_t idleCount() const
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_idle.size();
+    }
+
+    /**
+     * Maximum number of idle players kept by the pool
+     */
+    size_t capacity() const
+    {
+        return m_capacity;
+    }
+
+    Stats stats() const
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_stats;
+    }
+
+    void resetStats()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_stats = Stats{};
+    }
+
+private:
+    std::unique_ptr<MediaPlayer> createPlayer()
+    {
+        std::unique_ptr<MediaPlayer> player( new MediaPlayer( m_instance ) );
+        if ( m_configurator != nullptr )
+            m_configurator( *player );
+        return player;
+    }
+
+    std::unique_ptr<MediaPlayer> take()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        if ( m_idle.empty() )
+            return nullptr;
+        auto player = std::move( m_idle.back() );
+        m_idle.pop_back();
+        return player;
+    }
+
+    void record(std::chrono::steady_clock::time_point start, bool hit)
+    {
+        auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start ).count();
+        std::lock_guard<std::mutex> lock( m_mutex );
+        ++m_stats.acquisitions;
+        if ( hit )
+            ++m_stats.hits;
+        else
+            ++m_stats.misses;
+        m_stats.totalLatency += latency;
+        if ( (uint64_t)latency > m_stats.maxLatency )
+            m_stats.maxLatency = latency;
+    }
+
+    void giveBack(std::unique_ptr<MediaPlayer> player)
+    {
+        player->stop();
+        player->setRate( 1.f );
+        // Don't keep the previous media, and its resources, around
+        libvlc_media_player_set_media( *player, nullptr );
+        if ( m_resetter != nullptr )
+            m_resetter( *player );
+        std::lock_guard<std::mutex> lock( m_mutex );
+        // Players created on a miss are only kept if there is room for them
+        if ( m_idle.size() < m_capacity )
+            m_idle.push_back( std::move( player ) );
+    }
+
+private:
+    Instance m_instance;
+    size_t m_capacity;
+    Configurator m_configurator;
+    Resetter m_resetter;
+    std::vector<std::unique_ptr<MediaPlayer>> m_idle;
+    Stats m_stats;
+    mutable std::mutex m_mutex;
+};
+
+} // namespace VLC
+
+#endif
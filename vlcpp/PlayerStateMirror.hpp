@@ -0,0 +1,334 @@
+/*****************************************************************************
+ * PlayerStateMirror.hpp: Lock free, event driven MediaPlayer state
+ *****************************************************************************
+ * Copyright © 2015 libvlcpp authors & VideoLAN
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_CXX_PLAYERSTATEMIRROR_H
+#define LIBVLC_CXX_PLAYERSTATEMIRROR_H
+
+#include "common.hpp"
+#include "EventManager.hpp"
+#include "MediaPlayer.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace VLC
+{
+
+/**
+ * @brief A consistent copy of a MediaPlayer state
+ */
+struct PlayerState
+{
+    libvlc_time_t time;
+    libvlc_time_t length;
+    float position;
+    float rate;
+    // Last buffering progress, in percent
+    float buffering;
+    libvlc_state_t state;
+    int volume;
+    bool seekable;
+    bool pausable;
+    // Incremented each time the state is updated
+    uint32_t version;
+
+    bool isPlaying() const
+    {
+        return state == libvlc_Playing;
+    }
+};
+
+/**
+ * @brief Mirrors the state of a MediaPlayer, without calling libvlc
+ *
+ * Polling MediaPlayer::time(), position(), state()... takes the player and
+ * input locks, which contend with the decoding threads. The mirror keeps
+ * a copy of those values, updated from the player events, and readable from
+ * any thread without locking, through a sequence lock.
+ *
+ * libvlc doesn't send events for the rate and volume changes. They are read
+ * from the player when it starts playing, and when they are changed through
+ * the mirror's setRate() and setVolume(). refresh() resynchronizes all
+ * values with the player.
+ */
+class PlayerStateMirror
+{
+public:
+    /**
+     * \param player  The player to mirror. It is queried once upon creation.
+     */
+    PlayerStateMirror(MediaPlayer& player)
+        : m_player( player )
+        , m_sequence( 0 )
+        , m_time( -1 )
+        , m_length( 0 )
+        , m_position( 0.f )
+        , m_rate( 1.f )
+        , m_buffering( 0.f )
+        , m_state( libvlc_NothingSpecial )
+        , m_volume( -1 )
+        , m_seekable( false )
+        , m_pausable( false )
+        , m_eventManager( player.eventManager() )
+    {
+        refresh();
+        m_eventManager.onTimeChanged( [this](libvlc_time_t time) {
+            Writer w( *this );
+            m_time.store( time, std::memory_order_relaxed );
+        });
+        m_eventManager.onPositionChanged( [this](float position) {
+            Writer w( *this );
+            m_position.store( position, std::memory_order_relaxed );
+        });
+        m_eventManager.onLengthChanged( [this](libvlc_time_t length) {
+            Writer w( *this );
+            m_length.store( length, std::memory_order_relaxed );
+        });
+        m_eventManager.onSeekableChanged( [this](bool seekable) {
+            Writer w( *this );
+            m_seekable.store( seekable, std::memory_order_relaxed );
+        });
+        m_eventManager.onPausableChanged( [this](bool pausable) {
+            Writer w( *this );
+            m_pausable.store( pausable, std::memory_order_relaxed );
+        });
+        m_eventManager.onBuffering( [this](float buffering) {
+            Writer w( *this );
+            m_buffering.store( buffering, std::memory_order_relaxed );
+        });
+        m_eventManager.onMediaChanged( [this](MediaPtr) {
+            Writer w( *this );
+            m_time.store( -1, std::memory_order_relaxed );
+            m_position.store( 0.f, std::memory_order_relaxed );
+            m_length.store( 0, std::memory_order_relaxed );
+            m_buffering.store( 0.f, std::memory_order_relaxed );
+            m_state.store( libvlc_NothingSpecial, std::memory_order_relaxed );
+        });
+        m_eventManager.onOpening( [this]() {
+            setState( libvlc_Opening );
+        });
+        m_eventManager.onPlaying( [this]() {
+            // Those are plain variable reads, which are safe to perform from
+            // an event callback.
+            auto rate = m_player.rate();
+            auto volume = m_player.volume();
+            Writer w( *this );
+            m_state.store( libvlc_Playing, std::memory_order_relaxed );
+            m_rate.store( rate, std::memory_order_relaxed );
+            m_volume.store( volume, std::memory_order_relaxed );
+        });
+        m_eventManager.onPaused( [this]() {
+            setState( libvlc_Paused );
+        });
+        m_eventManager.onStopped( [this]() {
+            setState( libvlc_Stopped );
+        });
+        m_eventManager.onEndReached( [this]() {
+            setState( libvlc_Ended );
+        });
+        m_eventManager.onEncounteredError( [this]() {
+            setState( libvlc_Error );
+        });
+    }
+
+    PlayerStateMirror(const PlayerStateMirror&) = delete;
+    PlayerStateMirror& operator=(const PlayerStateMirror&) = delete;
+
+    /**
+     * Returns a consistent copy of the player state.
+     *
+     * This doesn't call libvlc nor take any lock, and can be called from any
+     * thread.
+     */
+    PlayerState snapshot() const
+    {
+        PlayerState s;
+        uint32_t before;
+        uint32_t after;
+        do
+        {
+            before = m_sequence.load( std::memory_order_acquire );
+            s.time = m_time.load( std::memory_order_relaxed );
+            s.length = m_length.load( std::memory_order_relaxed );
+            s.position = m_position.load( std::memory_order_relaxed );
+            s.rate = m_rate.load( std::memory_order_relaxed );
+            s.buffering = m_buffering.load( std::memory_order_relaxed );
+            s.state = (libvlc_state_t)m_state.load( std::memory_order_relaxed );
+            s.volume = m_volume.load( std::memory_order_relaxed );
+            s.seekable = m_seekable.load( std::memory_order_relaxed );
+            s.pausable = m_pausable.load( std::memory_order_relaxed );
+            std::atomic_thread_fence( std::memory_order_acquire );
+            after = m_sequence.load( std::memory_order_relaxed );
+        // An odd sequence means an update was in progress
+        } while ( before != after || ( before & 1 ) != 0 );
+        s.version = before / 2;
+        return s;
+    }
+
+    libvlc_time_t time() const
+    {
+        return m_time.load( std::memory_order_relaxed );
+    }
+
+    float position() const
+    {
+        return m_position.load( std::memory_order_relaxed );
+    }
+
+    libvlc_time_t length() const
+    {
+        return m_length.load( std::memory_order_relaxed );
+    }
+
+    libvlc_state_t state() const
+    {
+        return (libvlc_state_t)m_state.load( std::memory_order_relaxed );
+    }
+
+    bool isPlaying() const
+    {
+        return state() == libvlc_Playing;
+    }
+
+    float rate() const
+    {
+        return m_rate.load( std::memory_order_relaxed );
+    }
+
+    int volume() const
+    {
+        return m_volume.load( std::memory_order_relaxed );
+    }
+
+    /**
+     * Sets the player rate, and updates the mirrored value
+     *
+     * \return 0 on success, -1 if the rate isn't supported
+     */
+    int setRate(float rate)
+    {
+        auto res = m_player.setRate( rate );
+        if ( res == 0 )
+        {
+            Writer w( *this );
+            m_rate.store( rate, std::memory_order_relaxed );
+        }
+        return res;
+    }
+
+    /**
+     * Sets the player volume, and updates the mirrored value
+     *
+     * \return true on success
+     */
+    bool setVolume(int volume)
+    {
+        auto res = m_player.setVolume( volume );
+        if ( res == true )
+        {
+            Writer w( *this );
+            m_volume.store( volume, std::memory_order_relaxed );
+        }
+        return res;
+    }
+
+    /**
+     * Reads all values from the player.
+     *
+     * This must not be called from an event callback.
+     */
+    void refresh()
+    {
+        auto time = m_player.time();
+        auto length = m_player.length();
+        auto position = m_player.position();
+        auto rate = m_player.rate();
+        auto state = m_player.state();
+        auto volume = m_player.volume();
+        auto seekable = m_player.isSeekable();
+        auto pausable = m_player.canPause();
+        Writer w( *this );
+        m_time.store( time, std::memory_order_relaxed );
+        m_length.store( length, std::memory_order_relaxed );
+        m_position.store( position, std::memory_order_relaxed );
+        m_rate.store( rate, std::memory_order_relaxed );
+        m_state.store( state, std::memory_order_relaxed );
+        m_volume.store( volume, std::memory_order_relaxed );
+        m_seekable.store( seekable, std::memory_order_relaxed );
+        m_pausable.store( pausable, std::memory_order_relaxed );
+    }
+
+private:
+    // Serializes the writers, and marks the update in the sequence counter
+    class Writer
+    {
+    public:
+        Writer(PlayerStateMirror& mirror)
+            : m_mirror( mirror )
+            , m_lock( mirror.m_writeMutex )
+        {
+            auto seq = m_mirror.m_sequence.load( std::memory_order_relaxed );
+            m_mirror.m_sequence.store( seq + 1, std::memory_order_relaxed );
+            std::atomic_thread_fence( std::memory_order_release );
+        }
+
+        ~Writer()
+        {
+            auto seq = m_mirror.m_sequence.load( std::memory_order_relaxed );
+            m_mirror.m_sequence.store( seq + 1, std::memory_order_release );
+        }
+
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+    private:
+        PlayerStateMirror& m_mirror;
+        std::lock_guard<std::mutex> m_lock;
+    };
+
+    void setState(libvlc_state_t state)
+    {
+        Writer w( *this );
+        m_state.store( state, std::memory_order_relaxed );
+    }
+
+private:
+    MediaPlayer m_player;
+    std::mutex m_writeMutex;
+    std::atomic<uint32_t> m_sequence;
+    std::atomic<libvlc_time_t> m_time;
+    std::atomic<libvlc_time_t> m_length;
+    std::atomic<float> m_position;
+    std::atomic<float> m_rate;
+    std::atomic<float> m_buffering;
+    std::atomic<int> m_state;
+    std::atomic<int> m_volume;
+    std::atomic<bool> m_seekable;
+    std::atomic<bool> m_pausable;
+    // Declared last, so our handlers are unregistered first
+    MediaPlayerEventManager m_eventManager;
+};
+
+} // namespace VLC
+
+#endif
@@ -0,0 +1,811 @@
+/*****************************************************************************
+ * PlaylistParser.hpp: Parallel M3U/PLS/XSPF playlist parser
+ *****************************************************************************
+ * Copyright © 2015 libvlcpp authors & VideoLAN
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_CXX_PLAYLISTPARSER_H
+#define LIBVLC_CXX_PLAYLISTPARSER_H
+
+#include "common.hpp"
+#include "Instance.hpp"
+#include "Media.hpp"
+#include "MediaList.hpp"
+#include "VirtualMediaList.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#else
+# include <fstream>
+#endif
+
+namespace VLC
+{
+
+/**
+ * @brief An entry read from a playlist file.
+ */
+class PlaylistEntry
+{
+public:
+    PlaylistEntry(std::string mrl, Media::FromType type, std::string title, int64_t duration)
+        : m_mrl( std::move( mrl ) )
+        , m_type( type )
+        , m_title( std::move( title ) )
+        , m_duration( duration )
+    {
+    }
+
+    /**
+     * The location or path of the entry. Relative paths are resolved
+     * against the playlist directory.
+     */
+    const std::string& mrl() const
+    {
+        return m_mrl;
+    }
+
+    /**
+     * Media::FromLocation or Media::FromPath, depending on mrl()
+     */
+    Media::FromType type() const
+    {
+        return m_type;
+    }
+
+    /**
+     * The title provided by the playlist, if any
+     */
+    const std::string& title() const
+    {
+        return m_title;
+    }
+
+    /**
+     * The duration provided by the playlist, in ms, or -1 if unknown
+     */
+    int64_t duration() const
+    {
+        return m_duration;
+    }
+
+    /**
+     * Options provided by #EXTVLCOPT directives
+     */
+    const std::vector<std::string>& options() const
+    {
+        return m_options;
+    }
+
+    void addOption(std::string option)
+    {
+        m_options.push_back( std::move( option ) );
+    }
+
+private:
+    std::string m_mrl;
+    Media::FromType m_type;
+    std::string m_title;
+    int64_t m_duration;
+    std::vector<std::string> m_options;
+};
+
+/**
+ * @brief Parses playlist files without going through libvlc
+ *
+ * Having libvlc open a playlist as a media with subitems parses it serially
+ * and sends an event per subitem. This parser maps the file in memory,
+ * splits it in chunks which are parsed concurrently, and creates all the
+ * media at once. Titles and durations are read from the playlist, and
+ * returned by parse(). load() sets the titles on the created media, but
+ * can't set their durations, which libvlc only gets by parsing them.
+ *
+ * M3U/M3U8 (#EXTINF, #EXTVLCOPT), PLS and XSPF files are supported.
+ */
+class PlaylistParser
+{
+public:
+    enum class Format
+    {
+        /**
+         * Guess the format from the file extension, then its content
+         */
+        Auto,
+        M3U,
+        PLS,
+        XSPF,
+    };
+    // To be able to write PlaylistParser::M3U
+    constexpr static Format Auto = Format::Auto;
+    constexpr static Format M3U = Format::M3U;
+    constexpr static Format PLS = Format::PLS;
+    constexpr static Format XSPF = Format::XSPF;
+
+    /**
+     * @param nbThreads The maximum number of threads used to parse a
+     *                  playlist. 0 means the number of hardware threads.
+     */
+    explicit PlaylistParser(unsigned int nbThreads = 0)
+        : m_nbThreads( nbThreads != 0 ? nbThreads : std::thread::hardware_concurrency() )
+    {
+        if ( m_nbThreads == 0 )
+            m_nbThreads = 1;
+    }
+
+    /**
+     * Parse a playlist file.
+     *
+     * \param path      The playlist path
+     * \param format    The playlist format
+     * \return          The playlist entries, in order
+     *
+     * \throws std::runtime_error if the file can't be read or the format
+     *         can't be guessed
+     */
+    std::vector<PlaylistEntry> parse(const std::string& path, Format format = Auto)
+    {
+        MappedFile file( path );
+        const char* data = file.data();
+        size_t size = file.size();
+        // Skip UTF-8 BOM
+        if ( size >= 3 && memcmp( data, "\xEF\xBB\xBF", 3 ) == 0 )
+        {
+            data += 3;
+            size -= 3;
+        }
+        if ( format == Auto )
+            format = guessFormat( path, data, size );
+        auto baseDir = directory( path );
+        switch ( format )
+        {
+        case M3U:
+            return parseM3U( data, size, baseDir );
+        case PLS:
+            return parsePLS( data, size, baseDir );
+        case XSPF:
+            return parseXSPF( data, size, baseDir );
+        default:
+            throw std::runtime_error( "Unknown playlist format" );
+        }
+    }
+
+    /**
+     * Parse a playlist file, and append its entries to a MediaList.
+     *
+     * The media are created concurrently, their title is set from the
+     * playlist, and they are then added to the list while holding its lock
+     * once. The durations are dropped: use parse() to get them.
+     *
+     * \return The number of added media
+     */
+    int load(Instance& instance, MediaList& list, const std::string& path, Format format = Auto)
+    {
+        auto entries = parse( path, format );
+        auto chunks = split( entries.size() );
+        std::vector<std::future<std::vector<Media>>> futures;
+        for ( const auto& c : chunks )
+        {
+            futures.push_back( std::async( std::launch::async, [&instance, &entries, c]() {
+                std::vector<Media> res;
+                res.reserve( c.second - c.first );
+                for ( auto i = c.first; i < c.second; ++i )
+                {
+                    const auto& e = entries[i];
+                    res.emplace_back( instance, e.mrl(), e.type() );
+                    if ( e.title().empty() == false )
+                        res.back().setMeta( libvlc_meta_Title, e.title() );
+                    for ( const auto& opt : e.options() )
+                        res.back().addOption( opt );
+                }
+                return res;
+            }));
+        }
+        std::vector<std::vector<Media>> media;
+        for ( auto& f : futures )
+            media.push_back( f.get() );
+        int nbAdded = 0;
+        MediaList::Lock lock( list );
+        for ( auto& chunk : media )
+        {
+            for ( auto& md : chunk )
+            {
+                if ( list.addMedia( md ) )
+                    ++nbAdded;
+            }
+        }
+        return nbAdded;
+    }
+
+    /**
+     * Parse a playlist file, and append its entries to a VirtualMediaList.
+     *
+     * No media is created. Titles, durations and options are not kept.
+     *
+     * \return The number of added entries
+     */
+    int load(VirtualMediaList& list, const std::string& path, Format format = Auto)
+    {
+        auto entries = parse( path, format );
+        size_t bytes = 0;
+        for ( const auto& e : entries )
+            bytes += e.mrl().size();
+        list.reserve( entries.size(), bytes );
+        for ( const auto& e : entries )
+            list.add( e.mrl(), e.type() );
+        return (int)entries.size();
+    }
+
+private:
+    using Chunk = std::pair<size_t, size_t>;
+
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const std::string& path)
+            : m_data( nullptr )
+            , m_size( 0 )
+        {
+#ifndef _WIN32
+            int fd = open( path.c_str(), O_RDONLY );
+            if ( fd < 0 )
+                throw std::runtime_error( "Failed to open " + path );
+            struct stat st;
+            if ( fstat( fd, &st ) != 0 )
+            {
+                close( fd );
+                throw std::runtime_error( "Failed to stat " + path );
+            }
+            m_size = (size_t)st.st_size;
+            if ( m_size > 0 )
+            {
+                void* ptr = mmap( nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+                if ( ptr == MAP_FAILED )
+                {
+                    close( fd );
+                    throw std::runtime_error( "Failed to map " + path );
+                }
+                madvise( ptr, m_size, MADV_SEQUENTIAL );
+                m_data = static_cast<const char*>( ptr );
+            }
+            close( fd );
+#else
+            std::ifstream f( path, std::ios::binary );
+            if ( f.is_open() == false )
+                throw std::runtime_error( "Failed to open " + path );
+            m_buffer.assign( std::istreambuf_iterator<char>( f ), std::istreambuf_iterator<char>() );
+            m_data = m_buffer.data();
+            m_size = m_buffer.size();
+#endif
+        }
+
+        ~MappedFile()
+        {
+#ifndef _WIN32
+            if ( m_data != nullptr )
+                munmap( const_cast<char*>( m_data ), m_size );
+#endif
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const char* data() const
+        {
+            return m_data;
+        }
+
+        size_t size() const
+        {
+            return m_size;
+        }
+
+    private:
+        const char* m_data;
+        size_t m_size;
+#ifdef _WIN32
+        std::vector<char> m_buffer;
+#endif
+    };
+
+    // Below this size, spawning threads costs more than it saves
+    static constexpr size_t MinChunkSize = 64 * 1024;
+
+    static Format guessFormat(const std::string& path, const char* data, size_t size)
+    {
+        auto dot = path.find_last_of( '.' );
+        if ( dot != std::string::npos )
+        {
+            auto ext = path.substr( dot + 1 );
+            toLower( ext );
+            if ( ext == "m3u" || ext == "m3u8" )
+                return M3U;
+            if ( ext == "pls" )
+                return PLS;
+            if ( ext == "xspf" )
+                return XSPF;
+        }
+        std::string head( data, std::min<size_t>( size, 256 ) );
+        if ( head.find( "#EXTM3U" ) != std::string::npos )
+            return M3U;
+        if ( head.find( "[playlist]" ) != std::string::npos )
+            return PLS;
+        if ( head.find( "<playlist" ) != std::string::npos )
+            return XSPF;
+        throw std::runtime_error( "Can't guess the format of " + path );
+    }
+
+    static void toLower(std::string& str)
+    {
+        // std::tolower's behavior is undefined for negative chars
+        std::transform( begin( str ), end( str ), begin( str ), [](unsigned char c) {
+            return static_cast<char>( std::tolower( c ) );
+        });
+    }
+
+    static std::string directory(const std::string& path)
+    {
+        auto pos = path.find_last_of( "/\\" );
+        if ( pos == std::string::npos )
+            return {};
+        return path.substr( 0, pos + 1 );
+    }
+
+    static bool isAbsolutePath(const std::string& p)
+    {
+        if ( p.empty() )
+            return false;
+        if ( p[0] == '/' || p[0] == '\\' )
+            return true;
+        return p.size() > 2 && isalpha( (unsigned char)p[0] ) && p[1] == ':' &&
+                ( p[2] == '\\' || p[2] == '/' );
+    }
+
+    static bool hasScheme(const std::string& p)
+    {
+        auto pos = p.find( "://" );
+        if ( pos == std::string::npos || pos == 0 )
+            return false;
+        for ( size_t i = 0; i < pos; ++i )
+        {
+            if ( isalnum( (unsigned char)p[i] ) == 0 && p[i] != '+' && p[i] != '-' && p[i] != '.' )
+                return false;
+        }
+        return true;
+    }
+
+    static PlaylistEntry makeEntry(std::string mrl, const std::string& baseDir, std::string title, int64_t duration)
+    {
+        if ( hasScheme( mrl ) )
+            return PlaylistEntry{ std::move( mrl ), Media::FromLocation, std::move( title ), duration };
+        if ( isAbsolutePath( mrl ) == false )
+            mrl = baseDir + mrl;
+        return PlaylistEntry{ std::move( mrl ), Media::FromPath, std::move( title ), duration };
+    }
+
+    // Split [0; size) in at most m_nbThreads ranges
+    std::vector<Chunk> split(size_t size) const
+    {
+        std::vector<Chunk> res;
+        size_t nbChunks = std::max<size_t>( 1, std::min<size_t>( m_nbThreads, size ) );
+        size_t chunkSize = size / nbChunks;
+        size_t start = 0;
+        for ( size_t i = 0; i < nbChunks; ++i )
+        {
+            size_t end = i == nbChunks - 1 ? size : start + chunkSize;
+            res.emplace_back( start, end );
+            start = end;
+        }
+        return res;
+    }
+
+    // Split a text buffer in chunks of whole lines. isBoundary(line, length)
+    // tells whether a chunk may start right after the provided line.
+    template <typename IsBoundary>
+    std::vector<Chunk> splitLines(const char* data, size_t size, IsBoundary isBoundary) const
+    {
+        std::vector<Chunk> res;
+        size_t nbChunks = std::min<size_t>( m_nbThreads, std::max<size_t>( 1, size / MinChunkSize ) );
+        size_t start = 0;
+        for ( size_t i = 1; i < nbChunks && start < size; ++i )
+        {
+            size_t pos = std::max( start, size * i / nbChunks );
+            while ( pos < size )
+            {
+                auto eol = static_cast<const char*>( memchr( data + pos, '\n', size - pos ) );
+                if ( eol == nullptr )
+                {
+                    pos = size;
+                    break;
+                }
+                // Find the beginning of the line we just went through
+                auto sol = data + pos;
+                while ( sol > data && sol[-1] != '\n' )
+                    --sol;
+                pos = eol - data + 1;
+                if ( isBoundary( sol, eol - sol ) )
+                    break;
+            }
+            if ( pos > start )
+            {
+                res.emplace_back( start, pos );
+                start = pos;
+            }
+        }
+        if ( start < size )
+            res.emplace_back( start, size );
+        return res;
+    }
+
+    // Run parseChunk concurrently on all chunks, and concatenate the results
+    template <typename Result, typename ParseChunk>
+    static std::vector<Result> parseChunks(const std::vector<Chunk>& chunks, ParseChunk parseChunk)
+    {
+        std::vector<Result> res;
+        if ( chunks.size() == 1 )
+        {
+            res.push_back( parseChunk( chunks[0] ) );
+            return res;
+        }
+        std::vector<std::future<Result>> futures;
+        for ( const auto& c : chunks )
+            futures.push_back( std::async( std::launch::async, parseChunk, c ) );
+        for ( auto& f : futures )
+            res.push_back( f.get() );
+        return res;
+    }
+
+    template <typename Func>
+    static void forEachLine(const char* data, size_t size, Func f)
+    {
+        size_t pos = 0;
+        while ( pos < size )
+        {
+            auto eol = static_cast<const char*>( memchr( data + pos, '\n', size - pos ) );
+            size_t end = eol != nullptr ? eol - data : size;
+            size_t len = end - pos;
+            // Trim leading & trailing whitespaces, including \r
+            const char* line = data + pos;
+            while ( len > 0 && isspace( (unsigned char)line[len - 1] ) )
+                --len;
+            while ( len > 0 && isspace( (unsigned char)*line ) )
+            {
+                ++line;
+                --len;
+            }
+            f( line, len );
+            pos = end + 1;
+        }
+    }
+
+    static bool startsWith(const char* line, size_t len, const char* prefix)
+    {
+        auto prefixLen = strlen( prefix );
+        return len >= prefixLen && strncmp( line, prefix, prefixLen ) == 0;
+    }
+
+    std::vector<PlaylistEntry> parseM3U(const char* data, size_t size, const std::string& baseDir) const
+    {
+        // A chunk can't start in between an #EXTINF line and its URI
+        auto chunks = splitLines( data, size, [](const char* line, size_t len) {
+            return len > 0 && line[0] != '#' && line[0] != '\r';
+        });
+        auto results = parseChunks<std::vector<PlaylistEntry>>( chunks, [data, &baseDir](Chunk c) {
+            std::vector<PlaylistEntry> res;
+            std::string title;
+            int64_t duration = -1;
+            std::vector<std::string> options;
+            forEachLine( data + c.first, c.second - c.first, [&](const char* line, size_t len) {
+                if ( len == 0 )
+                    return;
+                if ( line[0] != '#' )
+                {
+                    res.push_back( makeEntry( std::string( line, len ), baseDir, std::move( title ), duration ) );
+                    for ( auto& o : options )
+                        res.back().addOption( std::move( o ) );
+                    title.clear();
+                    options.clear();
+                    duration = -1;
+                }
+                else if ( startsWith( line, len, "#EXTINF:" ) )
+                {
+                    std::string info( line + 8, len - 8 );
+                    auto seconds = strtod( info.c_str(), nullptr );
+                    duration = seconds >= 0. ? (int64_t)( seconds * 1000. ) : -1;
+                    // The title follows the first comma which isn't part of
+                    // a quoted attribute value
+                    bool quoted = false;
+                    for ( size_t i = 0; i < info.size(); ++i )
+                    {
+                        if ( info[i] == '"' )
+                            quoted = !quoted;
+                        else if ( info[i] == ',' && quoted == false )
+                        {
+                            title = info.substr( i + 1 );
+                            break;
+                        }
+                    }
+                }
+                else if ( startsWith( line, len, "#EXTVLCOPT:" ) )
+                    options.emplace_back( line + 11, len - 11 );
+            });
+            return res;
+        });
+        return concat( results );
+    }
+
+    std::vector<PlaylistEntry> parsePLS(const char* data, size_t size, const std::string& baseDir) const
+    {
+        struct PLSEntry
+        {
+            PLSEntry() : duration( -1 ) {}
+            std::string file;
+            std::string title;
+            int64_t duration;
+        };
+        using PLSEntries = std::map<long, PLSEntry>;
+
+        // Entries are numbered, so any line can be a boundary
+        auto chunks = splitLines( data, size, [](const char*, size_t) { return true; } );
+        auto results = parseChunks<PLSEntries>( chunks, [data](Chunk c) {
+            PLSEntries res;
+            forEachLine( data + c.first, c.second - c.first, [&res](const char* line, size_t len) {
+                auto eq = static_cast<const char*>( memchr( line, '=', len ) );
+                if ( eq == nullptr )
+                    return;
+                std::string key( line, eq - line );
+                std::string value( eq + 1, len - ( eq - line ) - 1 );
+                auto digit = key.find_first_of( "0123456789" );
+                if ( digit == std::string::npos )
+                    return;
+                auto idx = strtol( key.c_str() + digit, nullptr, 10 );
+                auto name = key.substr( 0, digit );
+                toLower( name );
+                if ( name == "file" )
+                    res[idx].file = std::move( value );
+                else if ( name == "title" )
+                    res[idx].title = std::move( value );
+                else if ( name == "length" )
+                {
+                    auto seconds = strtol( value.c_str(), nullptr, 10 );
+                    res[idx].duration = seconds >= 0 ? seconds * 1000 : -1;
+                }
+            });
+            return res;
+        });
+        PLSEntries merged;
+        for ( auto& r : results )
+        {
+            for ( auto& p : r )
+            {
+                auto& e = merged[p.first];
+                if ( p.second.file.empty() == false )
+                    e.file = std::move( p.second.file );
+                if ( p.second.title.empty() == false )
+                    e.title = std::move( p.second.title );
+                if ( p.second.duration >= 0 )
+                    e.duration = p.second.duration;
+            }
+        }
+        std::vector<PlaylistEntry> res;
+        res.reserve( merged.size() );
+        for ( auto& p : merged )
+        {
+            if ( p.second.file.empty() == false )
+                res.push_back( makeEntry( std::move( p.second.file ), baseDir,
+                                          std::move( p.second.title ), p.second.duration ) );
+        }
+        return res;
+    }
+
+    std::vector<PlaylistEntry> parseXSPF(const char* data, size_t size, const std::string& baseDir) const
+    {
+        // Split on <track> elements
+        std::vector<Chunk> chunks;
+        size_t nbChunks = std::min<size_t>( m_nbThreads, std::max<size_t>( 1, size / MinChunkSize ) );
+        size_t start = 0;
+        for ( size_t i = 1; i < nbChunks; ++i )
+        {
+            auto pos = find( data, size, std::max( start, size * i / nbChunks ), "<track>" );
+            if ( pos == std::string::npos )
+                break;
+            if ( pos > start )
+            {
+                chunks.emplace_back( start, pos );
+                start = pos;
+            }
+        }
+        chunks.emplace_back( start, size );
+        auto results = parseChunks<std::vector<PlaylistEntry>>( chunks, [data, &baseDir](Chunk c) {
+            std::vector<PlaylistEntry> res;
+            auto pos = c.first;
+            while ( true )
+            {
+                auto trackStart = find( data, c.second, pos, "<track>" );
+                if ( trackStart == std::string::npos )
+                    break;
+                auto trackEnd = find( data, c.second, trackStart, "</track>" );
+                if ( trackEnd == std::string::npos )
+                    break;
+                auto location = element( data, trackStart, trackEnd, "location" );
+                if ( location.empty() == false )
+                {
+                    auto duration = element( data, trackStart, trackEnd, "duration" );
+                    // Relative locations are relative URIs
+                    if ( hasScheme( location ) == false )
+                        location = percentDecode( location );
+                    res.push_back( makeEntry( std::move( location ), baseDir,
+                                              element( data, trackStart, trackEnd, "title" ),
+                                              duration.empty() ? -1 : strtoll( duration.c_str(), nullptr, 10 ) ) );
+                }
+                pos = trackEnd;
+            }
+            return res;
+        });
+        return concat( results );
+    }
+
+    static size_t find(const char* data, size_t size, size_t from, const char* needle)
+    {
+        auto len = strlen( needle );
+        for ( auto i = from; i + len <= size; ++i )
+        {
+            auto p = static_cast<const char*>( memchr( data + i, needle[0], size - i ) );
+            if ( p == nullptr )
+                return std::string::npos;
+            i = p - data;
+            if ( i + len <= size && memcmp( p, needle, len ) == 0 )
+                return i;
+        }
+        return std::string::npos;
+    }
+
+    // Returns the unescaped content of the first <name> element in [from; to)
+    static std::string element(const char* data, size_t from, size_t to, const std::string& name)
+    {
+        auto open = "<" + name + ">";
+        auto close = "</" + name + ">";
+        auto start = find( data, to, from, open.c_str() );
+        if ( start == std::string::npos )
+            return {};
+        start += open.size();
+        auto end = find( data, to, start, close.c_str() );
+        if ( end == std::string::npos )
+            return {};
+        return xmlDecode( data + start, end - start );
+    }
+
+    static std::string xmlDecode(const char* str, size_t len)
+    {
+        std::string res;
+        res.reserve( len );
+        for ( size_t i = 0; i < len; ++i )
+        {
+            if ( str[i] != '&' )
+            {
+                res += str[i];
+                continue;
+            }
+            auto semicolon = static_cast<const char*>( memchr( str + i, ';', len - i ) );
+            if ( semicolon == nullptr )
+            {
+                res += str[i];
+                continue;
+            }
+            std::string entity( str + i + 1, semicolon - str - i - 1 );
+            if ( entity == "amp" )
+                res += '&';
+            else if ( entity == "lt" )
+                res += '<';
+            else if ( entity == "gt" )
+                res += '>';
+            else if ( entity == "quot" )
+                res += '"';
+            else if ( entity == "apos" )
+                res += '\'';
+            else if ( entity.size() > 1 && entity[0] == '#' )
+                appendUtf8( res, entity[1] == 'x' ? strtoul( entity.c_str() + 2, nullptr, 16 )
+                                                  : strtoul( entity.c_str() + 1, nullptr, 10 ) );
+            else
+            {
+                res += str[i];
+                continue;
+            }
+            i = semicolon - str;
+        }
+        return res;
+    }
+
+    static void appendUtf8(std::string& str, unsigned long c)
+    {
+        if ( c < 0x80 )
+            str += (char)c;
+        else if ( c < 0x800 )
+        {
+            str += (char)( 0xC0 | ( c >> 6 ) );
+            str += (char)( 0x80 | ( c & 0x3F ) );
+        }
+        else if ( c < 0x10000 )
+        {
+            str += (char)( 0xE0 | ( c >> 12 ) );
+            str += (char)( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+            str += (char)( 0x80 | ( c & 0x3F ) );
+        }
+        else
+        {
+            str += (char)( 0xF0 | ( c >> 18 ) );
+            str += (char)( 0x80 | ( ( c >> 12 ) & 0x3F ) );
+            str += (char)( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+            str += (char)( 0x80 | ( c & 0x3F ) );
+        }
+    }
+
+    static std::string percentDecode(const std::string& str)
+    {
+        std::string res;
+        res.reserve( str.size() );
+        for ( size_t i = 0; i < str.size(); ++i )
+        {
+            if ( str[i] == '%' && i + 2 < str.size() &&
+                 isxdigit( (unsigned char)str[i + 1] ) && isxdigit( (unsigned char)str[i + 2] ) )
+            {
+                res += (char)strtoul( str.substr( i + 1, 2 ).c_str(), nullptr, 16 );
+                i += 2;
+            }
+            else
+                res += str[i];
+        }
+        return res;
+    }
+
+    static std::vector<PlaylistEntry> concat(std::vector<std::vector<PlaylistEntry>>& results)
+    {
+        if ( results.size() == 1 )
+            return std::move( results[0] );
+        size_t total = 0;
+        for ( const auto& r : results )
+            total += r.size();
+        std::vector<PlaylistEntry> res;
+        res.reserve( total );
+        for ( auto& r : results )
+            std::move( begin( r ), end( r ), std::back_inserter( res ) );
+        return res;
+    }
+
+private:
+    unsigned int m_nbThreads;
+};
+
+} // namespace VLC
+
+#endif
@@ -0,0 +1,174 @@
+/*****************************************************************************
+ * Reaper.hpp: Background execution of blocking teardown operations
+ *****************************************************************************
+ * Copyright © 2015 libvlcpp authors & VideoLAN
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_CXX_REAPER_H
+#define LIBVLC_CXX_REAPER_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace VLC
+{
+
+/**
+ * @brief Runs blocking teardown operations on background threads
+ *
+ * Stopping or releasing the last reference to a player waits for its input
+ * and output threads to terminate, which often takes hundreds of ms.
+ * The reaper performs those operations on its own threads, so that the
+ * calling thread doesn't block.
+ *
+ * Pending tasks are all executed before the reaper is destroyed.
+ */
+class Reaper
+{
+public:
+    /**
+     * Create a reaper
+     *
+     * \param nbThreads The number of threads running the tasks concurrently
+     */
+    explicit Reaper( unsigned int nbThreads = 4 )
+        : m_stop( false )
+    {
+        if ( nbThreads == 0 )
+            nbThreads = 1;
+        m_threads.reserve( nbThreads );
+        for ( auto i = 0u; i < nbThreads; ++i )
+            m_threads.emplace_back( &Reaper::run, this );
+    }
+
+    ~Reaper()
+    {
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_stop = true;
+        }
+        m_cond.notify_all();
+        for ( auto& t : m_threads )
+            t.join();
+    }
+
+    Reaper(const Reaper&) = delete;
+    Reaper& operator=(const Reaper&) = delete;
+
+    /**
+     * The reaper used by MediaPlayer::stopAsync()
+     */
+    static Reaper& instance()
+    {
+        static Reaper reaper;
+        return reaper;
+    }
+
+    /**
+     * Run a task on one of the reaper threads
+     *
+     * \return A future, ready once the task has been executed and destroyed.
+     *         Unlike the ones returned by std::async, it doesn't block upon
+     *         destruction. It holds the exception thrown by the task, if any.
+     */
+    std::future<void> post(std::function<void()> task)
+    {
+        auto done = std::make_shared<std::promise<void>>();
+        auto res = done->get_future();
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_tasks.push_back( [task, done]() mutable {
+                std::exception_ptr error;
+                try
+                {
+                    task();
+                }
+                catch ( ... )
+                {
+                    error = std::current_exception();
+                }
+                // Release what the task captured first, so that the objects
+                // it referenced are gone once the future is ready
+                task = nullptr;
+                if ( error != nullptr )
+                    done->set_exception( error );
+                else
+                    done->set_value();
+            });
+        }
+        m_cond.notify_one();
+        return res;
+    }
+
+    /**
+     * Drop a reference on one of the reaper threads
+     *
+     * If obj holds the last reference to its libvlc object, the object is
+     * released in the background. obj is left empty.
+     *
+     * \return A future, ready once the reference has been dropped
+     */
+    template <typename T>
+    std::future<void> release(T&& obj)
+    {
+        using Type = typename std::decay<T>::type;
+        auto holder = std::make_shared<Type>( std::forward<T>( obj ) );
+        return post( [holder]() mutable {
+            holder.reset();
+        });
+    }
+
+private:
+    void run()
+    {
+        while ( true )
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock( m_mutex );
+                m_cond.wait( lock, [this]() { return m_stop || m_tasks.empty() == false; } );
+                if ( m_tasks.empty() )
+                    return;
+                task = std::move( m_tasks.front() );
+                m_tasks.pop_front();
+            }
+            // post() stores the exceptions in the task's future
+            task();
+        }
+    }
+
+private:
+    std::deque<std::function<void()>> m_tasks;
+    bool m_stop;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::vector<std::thread> m_threads;
+};
+
+} // namespace VLC
+
+#endif
@@ -0,0 +1,358 @@
+/*****************************************************************************
+ * SeekController.hpp: Coalesces seek requests on a MediaPlayer
+ *****************************************************************************
+ * Copyright © 2015 libvlcpp authors & VideoLAN
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_CXX_SEEKCONTROLLER_H
+#define LIBVLC_CXX_SEEKCONTROLLER_H
+
+#include "common.hpp"
+#include "EventManager.hpp"
+#include "Media.hpp"
+#include "MediaPlayer.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+namespace VLC
+{
+
+/**
+ * @brief Coalesces seek requests, for scrubbing
+ *
+ * libvlc queues every seek it is asked to perform, so dragging a seek bar
+ * results in a backlog of seeks which are all performed, one after the other.
+ *
+ * The controller only keeps the latest requested target, and only issues it
+ * once the previous seek has completed. A seek is considered completed when
+ * the player reports a time showing the seek was applied, or after a
+ * timeout, since libvlc doesn't always send an event, for instance when
+ * seeking while paused.
+ *
+ * The time events sent by the ongoing playback before the seek takes effect
+ * must not complete it. libvlc doesn't tell which seek an event follows, so
+ * a seek is considered applied when the reported time lands within the
+ * tolerance of the target, or when it is discontinuous: ordinary playback
+ * never goes backward, and doesn't get further ahead than the elapsed time
+ * multiplied by the playback rate.
+ *
+ * Seeks are issued from a worker thread, so seekTo() never blocks.
+ */
+class SeekController
+{
+public:
+    enum class Policy
+    {
+        /**
+         * A seek is completed as soon as the player reports a discontinuous
+         * time, wherever it lands, or has buffered again after the seek
+         * flushed its buffers. Best used along with the fast seek option,
+         * see enableFastSeek().
+         */
+        Fast,
+        /**
+         * A seek is completed once the player reports a time within the
+         * tolerance of the target.
+         */
+        Precise,
+    };
+
+    struct Stats
+    {
+        // Number of calls to seekTo/seekToPosition
+        uint64_t requested;
+        // Number of seeks actually sent to the player
+        uint64_t issued;
+        // Number of requests replaced by a more recent one before being issued
+        uint64_t coalesced;
+        uint64_t completed;
+        uint64_t timeouts;
+        // Time between a seek being issued and its completion, in µs
+        uint64_t totalLatency;
+        uint64_t maxLatency;
+
+        uint64_t averageLatency() const
+        {
+            return completed ? totalLatency / completed : 0;
+        }
+    };
+
+    /**
+     * \param player    The player to seek
+     * \param policy    Defines when a seek is considered completed
+     * \param timeout   The time after which a seek is considered completed,
+     *                  when the player didn't report it.
+     * \param tolerance The maximum distance, in ms, between the requested
+     *                  and reported time for a seek to complete. It is also
+     *                  the drift allowed to ordinary playback before a time
+     *                  is considered discontinuous.
+     */
+    SeekController(MediaPlayer& player, Policy policy = Policy::Fast,
+                   std::chrono::milliseconds timeout = std::chrono::milliseconds( 500 ),
+                   libvlc_time_t tolerance = 100 )
+        : m_player( player )
+        , m_policy( policy )
+        , m_timeout( timeout )
+        , m_tolerance( tolerance )
+        , m_stats{}
+        , m_pending( false )
+        , m_pendingTime( 0 )
+        , m_pendingPosition( 0.f )
+        , m_pendingIsPosition( false )
+        , m_inFlight( false )
+        , m_target( -1 )
+        , m_rate( 1.f )
+        , m_rebuffering( false )
+        , m_lastTime( -1 )
+        , m_stop( false )
+        , m_eventManager( player.eventManager() )
+    {
+        m_eventManager.onTimeChanged( [this](libvlc_time_t time) {
+            auto now = std::chrono::steady_clock::now();
+            std::lock_guard<std::mutex> lock( m_mutex );
+            auto discontinuous = m_inFlight == true && isDiscontinuous( time, now );
+            m_lastTime = time;
+            m_lastTimeAt = now;
+            if ( m_inFlight == false )
+                return;
+            if ( m_target >= 0 && std::llabs( time - m_target ) <= m_tolerance )
+                completeLocked();
+            // The target is unknown when seeking by position in a media which
+            // doesn't have a length yet, so any discontinuity will do
+            else if ( discontinuous == true && ( m_policy == Policy::Fast || m_target < 0 ) )
+                completeLocked();
+        });
+        m_eventManager.onBuffering( [this](float buffering) {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            if ( m_inFlight == false || m_policy != Policy::Fast )
+                return;
+            // Only a buffering which started after the seek was issued
+            // tells it was applied
+            if ( buffering < 100.f )
+                m_rebuffering = true;
+            else if ( m_rebuffering == true )
+                completeLocked();
+        });
+        m_worker = std::thread( &SeekController::run, this );
+    }
+
+    ~SeekController()
+    {
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_stop = true;
+        }
+        m_cond.notify_all();
+        m_worker.join();
+    }
+
+    SeekController(const SeekController&) = delete;
+    SeekController& operator=(const SeekController&) = delete;
+
+    /**
+     * Request a seek to the provided time, in ms.
+     *
+     * Any request which hasn't been issued yet is discarded.
+     */
+    void seekTo(libvlc_time_t time)
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        request();
+        m_pendingTime = time;
+        m_pendingIsPosition = false;
+        m_cond.notify_all();
+    }
+
+    /**
+     * Request a seek to the provided position, from 0.0 to 1.0
+     *
+     * Any request which hasn't been issued yet is discarded.
+     */
+    void seekToPosition(float position)
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        request();
+        m_pendingPosition = position;
+        m_pendingIsPosition = true;
+        m_cond.notify_all();
+    }
+
+    /**
+     * Returns true if a seek is pending or being performed
+     */
+    bool isSeeking() const
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_pending || m_inFlight;
+    }
+
+    void setPolicy(Policy policy)
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_policy = policy;
+    }
+
+    void setTolerance(libvlc_time_t tolerance)
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_tolerance = tolerance;
+    }
+
+    Stats stats() const
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_stats;
+    }
+
+    void resetStats()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_stats = Stats{};
+    }
+
+    /**
+     * Favor the seek speed over its precision when playing this media.
+     *
+     * libvlc 2.x has no per-seek fast flag, so this has to be set as a media
+     * option, before the playback starts.
+     */
+    static void enableFastSeek(Media& md)
+    {
+        md.addOption( ":input-fast-seek" );
+    }
+
+private:
+    // Must be called with m_mutex held
+    void request()
+    {
+        ++m_stats.requested;
+        if ( m_pending == true )
+            ++m_stats.coalesced;
+        m_pending = true;
+    }
+
+    // Must be called with m_mutex held
+    bool isDiscontinuous(libvlc_time_t time, std::chrono::steady_clock::time_point now) const
+    {
+        if ( m_lastTime < 0 )
+            return false;
+        if ( time < m_lastTime )
+            return true;
+        // This overestimates the progress after a pause, hence a missed
+        // discontinuity at worst, which the timeout covers
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>( now - m_lastTimeAt ).count();
+        return time > m_lastTime + (libvlc_time_t)( elapsed * m_rate ) + m_tolerance;
+    }
+
+    // Must be called with m_mutex held
+    void completeLocked()
+    {
+        auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - m_issuedAt ).count();
+        ++m_stats.completed;
+        m_stats.totalLatency += latency;
+        if ( (uint64_t)latency > m_stats.maxLatency )
+            m_stats.maxLatency = latency;
+        m_inFlight = false;
+        m_cond.notify_all();
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        while ( true )
+        {
+            m_cond.wait( lock, [this]() { return m_stop || m_pending; } );
+            if ( m_stop == true )
+                return;
+            bool isPosition = m_pendingIsPosition;
+            auto time = m_pendingTime;
+            auto position = m_pendingPosition;
+            m_pending = false;
+            lock.unlock();
+
+            // Resolve the target before seeking, so the completion can be
+            // detected from the time events
+            libvlc_time_t target = time;
+            if ( isPosition == true )
+            {
+                auto length = m_player.length();
+                target = length > 0 ? (libvlc_time_t)( position * length ) : -1;
+            }
+            auto rate = m_player.rate();
+
+            lock.lock();
+            m_target = target;
+            m_rate = rate > 0.f ? rate : 1.f;
+            m_rebuffering = false;
+            m_inFlight = true;
+            m_issuedAt = std::chrono::steady_clock::now();
+            ++m_stats.issued;
+            lock.unlock();
+
+            if ( isPosition == true )
+                m_player.setPosition( position );
+            else
+                m_player.setTime( time );
+
+            lock.lock();
+            if ( m_cond.wait_until( lock, m_issuedAt + m_timeout,
+                        [this]() { return m_stop || m_inFlight == false; } ) == false )
+            {
+                ++m_stats.timeouts;
+                m_inFlight = false;
+            }
+        }
+    }
+
+private:
+    MediaPlayer m_player;
+    Policy m_policy;
+    std::chrono::milliseconds m_timeout;
+    libvlc_time_t m_tolerance;
+    Stats m_stats;
+    bool m_pending;
+    libvlc_time_t m_pendingTime;
+    float m_pendingPosition;
+    bool m_pendingIsPosition;
+    bool m_inFlight;
+    libvlc_time_t m_target;
+    // The playback rate when the seek was issued
+    float m_rate;
+    bool m_rebuffering;
+    libvlc_time_t m_lastTime;
+    // When m_lastTime was reported
+    std::chrono::steady_clock::time_point m_lastTimeAt;
+    std::chrono::steady_clock::time_point m_issuedAt;
+    bool m_stop;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::thread m_worker;
+    // Declared last, so our handlers are unregistered first
+    MediaPlayerEventManager m_eventManager;
+};
+
+} // namespace VLC
+
+#endif
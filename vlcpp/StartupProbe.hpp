@@ -0,0 +1,328 @@
+/*****************************************************************************
+ * StartupProbe.hpp: Startup latency instrumentation for MediaPlayer
+ *****************************************************************************
+ * Copyright © 2015 libvlcpp authors & VideoLAN
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_CXX_STARTUPPROBE_H
+#define LIBVLC_CXX_STARTUPPROBE_H
+
+#include "common.hpp"
+#include "EventManager.hpp"
+#include "MediaPlayer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace VLC
+{
+
+/**
+ * @brief Measures the startup latency of a MediaPlayer
+ *
+ * A session starts when play() is called on the probe, or upon the Opening
+ * event if the player was started directly. Each stage of the startup is
+ * timestamped the first time it is reached during a session, relative to the
+ * session start, and accumulated in a per-stage histogram.
+ *
+ * The first video lock & display and audio play can only be observed from the
+ * output callbacks: wrap them with videoLock(), videoDisplay() and
+ * audioPlay() before giving them to MediaPlayer::setVideoCallbacks() and
+ * MediaPlayer::setAudioCallbacks(). Once a stage has been reached, the
+ * decorators only cost an atomic load.
+ */
+class StartupProbe
+{
+public:
+    enum class Stage
+    {
+        Play,
+        Opening,
+        FirstBuffering,
+        Buffered,
+        Playing,
+        Vout,
+        FirstVideoLock,
+        FirstVideoDisplay,
+        FirstAudioPlay,
+    };
+
+    static constexpr unsigned int NbStages = (unsigned int)Stage::FirstAudioPlay + 1;
+
+    /**
+     * @brief The startup breakdown of a single playback
+     */
+    struct Session
+    {
+        // Time in µs, relative to the session start. -1 if not reached.
+        std::array<int64_t, NbStages> stages;
+        // Every buffering event received before Playing, as a
+        // (percentage, time in µs) pair
+        std::vector<std::pair<float, int64_t>> buffering;
+
+        int64_t operator[](Stage s) const
+        {
+            return stages[(unsigned int)s];
+        }
+    };
+
+    /**
+     * @brief Log2 histogram of durations, in µs
+     *
+     * Bucket 0 holds the null durations, bucket n holds the durations in the
+     * [2^(n-1), 2^n[ range.
+     */
+    struct Histogram
+    {
+        static constexpr unsigned int NbBuckets = 40;
+
+        std::array<uint64_t, NbBuckets> buckets;
+        uint64_t count;
+        int64_t min;
+        int64_t max;
+        int64_t sum;
+
+        void add(int64_t value)
+        {
+            unsigned int idx = 0;
+            while ( idx < NbBuckets - 1 && ( value >> idx ) != 0 )
+                ++idx;
+            ++buckets[idx];
+            if ( count == 0 || value < min )
+                min = value;
+            if ( count == 0 || value > max )
+                max = value;
+            sum += value;
+            ++count;
+        }
+
+        int64_t average() const
+        {
+            return count ? sum / (int64_t)count : 0;
+        }
+
+        /**
+         * Returns an upper bound of the provided percentile (0 to 100)
+         */
+        int64_t percentile(double p) const
+        {
+            if ( count == 0 )
+                return 0;
+            uint64_t target = (uint64_t)( p / 100.0 * count );
+            uint64_t acc = 0;
+            for ( unsigned int i = 0; i < NbBuckets; ++i )
+            {
+                acc += buckets[i];
+                if ( acc > target || acc == count )
+                    return i == 0 ? 0 : std::min<int64_t>( (int64_t)1 << i, max );
+            }
+            return max;
+        }
+    };
+
+    /**
+     * @brief Timestamps a stage, then forwards the call to the decorated
+     * callback
+     */
+    template <Stage S, typename Func>
+    class Decorator
+    {
+    public:
+        Decorator(StartupProbe& probe, Func&& func)
+            : m_probe( &probe )
+            , m_func( std::forward<Func>( func ) )
+        {
+        }
+
+        template <typename... Args>
+        auto operator()(Args&&... args) -> decltype(std::declval<Func&>()(std::forward<Args>(args)...))
+        {
+            m_probe->mark( S );
+            return m_func( std::forward<Args>( args )... );
+        }
+
+    private:
+        StartupProbe* m_probe;
+        typename std::decay<Func>::type m_func;
+    };
+
+    StartupProbe(MediaPlayer& player)
+        : m_player( player )
+        , m_session{}
+        , m_histograms{}
+        , m_sessions( 0 )
+        , m_eventManager( player.eventManager() )
+    {
+        resetSession( false );
+        m_eventManager.onOpening( [this]() {
+            {
+                std::lock_guard<std::mutex> lock( m_mutex );
+                // The player was started without going through play()
+                if ( m_active == false || m_session[Stage::Opening] >= 0 )
+                    startSessionLocked();
+            }
+            mark( Stage::Opening );
+        });
+        m_eventManager.onBuffering( [this](float percent) {
+            mark( Stage::FirstBuffering );
+            if ( percent >= 100.f )
+                mark( Stage::Buffered );
+            std::lock_guard<std::mutex> lock( m_mutex );
+            if ( m_active == true && m_session[Stage::Playing] < 0 )
+                m_session.buffering.emplace_back( percent, elapsedLocked() );
+        });
+        m_eventManager.onPlaying( [this]() {
+            mark( Stage::Playing );
+        });
+        m_eventManager.onVout( [this](int) {
+            mark( Stage::Vout );
+        });
+    }
+
+    StartupProbe(const StartupProbe&) = delete;
+    StartupProbe& operator=(const StartupProbe&) = delete;
+
+    /**
+     * Start a new session, and start the player
+     *
+     * \return 0 if playback started, -1 on error
+     */
+    int play()
+    {
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            startSessionLocked();
+        }
+        mark( Stage::Play );
+        return m_player.play();
+    }
+
+    template <typename LockCb>
+    Decorator<Stage::FirstVideoLock, LockCb> videoLock(LockCb&& f)
+    {
+        return Decorator<Stage::FirstVideoLock, LockCb>( *this, std::forward<LockCb>( f ) );
+    }
+
+    template <typename DisplayCb>
+    Decorator<Stage::FirstVideoDisplay, DisplayCb> videoDisplay(DisplayCb&& f)
+    {
+        return Decorator<Stage::FirstVideoDisplay, DisplayCb>( *this, std::forward<DisplayCb>( f ) );
+    }
+
+    template <typename PlayCb>
+    Decorator<Stage::FirstAudioPlay, PlayCb> audioPlay(PlayCb&& f)
+    {
+        return Decorator<Stage::FirstAudioPlay, PlayCb>( *this, std::forward<PlayCb>( f ) );
+    }
+
+    /**
+     * Timestamps a stage, if it wasn't reached yet during the current session
+     */
+    void mark(Stage s)
+    {
+        auto idx = (unsigned int)s;
+        if ( m_reached[idx].load( std::memory_order_relaxed ) == true )
+            return;
+        std::lock_guard<std::mutex> lock( m_mutex );
+        if ( m_active == false || m_reached[idx].load( std::memory_order_relaxed ) == true )
+            return;
+        auto elapsed = elapsedLocked();
+        m_session.stages[idx] = elapsed;
+        m_histograms[idx].add( elapsed );
+        m_reached[idx].store( true, std::memory_order_relaxed );
+    }
+
+    /**
+     * The breakdown of the current, or last, session
+     */
+    Session session() const
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_session;
+    }
+
+    /**
+     * The distribution of the time to reach the provided stage, across all
+     * sessions.
+     */
+    Histogram histogram(Stage s) const
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_histograms[(unsigned int)s];
+    }
+
+    uint64_t sessionCount() const
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_sessions;
+    }
+
+    void resetHistograms()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_histograms = decltype( m_histograms ){};
+        m_sessions = 0;
+    }
+
+private:
+    // Must be called with m_mutex held
+    void startSessionLocked()
+    {
+        resetSession( true );
+        m_start = std::chrono::steady_clock::now();
+        ++m_sessions;
+    }
+
+    void resetSession(bool active)
+    {
+        m_session.stages.fill( -1 );
+        m_session.buffering.clear();
+        for ( auto& r : m_reached )
+            r.store( false, std::memory_order_relaxed );
+        m_active = active;
+    }
+
+    int64_t elapsedLocked() const
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - m_start ).count();
+    }
+
+private:
+    MediaPlayer m_player;
+    Session m_session;
+    std::array<Histogram, NbStages> m_histograms;
+    std::array<std::atomic<bool>, NbStages> m_reached;
+    std::chrono::steady_clock::time_point m_start;
+    uint64_t m_sessions;
+    bool m_active;
+    mutable std::mutex m_mutex;
+    // Declared last, so our handlers are unregistered first
+    MediaPlayerEventManager m_eventManager;
+};
+
+} // namespace VLC
+
+#endif
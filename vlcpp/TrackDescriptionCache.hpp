@@ -0,0 +1,294 @@
+/*****************************************************************************
+ * TrackDescriptionCache.hpp: Cached MediaPlayer track descriptions
+ *****************************************************************************
+ * Copyright © 2015 libvlcpp authors & VideoLAN
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_CXX_TRACKDESCRIPTIONCACHE_H
+#define LIBVLC_CXX_TRACKDESCRIPTIONCACHE_H
+
+#include "common.hpp"
+#include "EventManager.hpp"
+#include "MediaPlayer.hpp"
+#include "structures.hpp"
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace VLC
+{
+
+/**
+ * @brief Caches the track, title and chapter descriptions of a MediaPlayer
+ *
+ * Fetching the descriptions from the player walks libvlc lists and copies
+ * every name. The cache does it once, and keeps the result until the player
+ * reports a change: ES added or deleted, title or media changed.
+ *
+ * Descriptions are returned as immutable shared snapshots. Once a snapshot is
+ * cached, fetching it neither locks nor calls libvlc: the snapshots are
+ * published through atomic pointers, and a replaced one is only freed once no
+ * reader is in flight. Updates are serialized by a mutex.
+ *
+ * Accessors may query the player on a cache miss, and therefore must not be
+ * called from an event callback.
+ */
+class TrackDescriptionCache
+{
+public:
+    using Snapshot = std::shared_ptr<const std::vector<TrackDescription>>;
+
+    TrackDescriptionCache(MediaPlayer& player)
+        : m_player( player )
+        , m_readers( 0 )
+        , m_eventManager( player.eventManager() )
+    {
+        for ( auto& e : m_entries )
+            e.generation = 0;
+        m_chaptersGeneration = 0;
+        m_eventManager.onESAdded( [this](libvlc_track_type_t type, int) {
+            invalidate( type );
+        });
+        m_eventManager.onESDeleted( [this](libvlc_track_type_t type, int) {
+            invalidate( type );
+        });
+        m_eventManager.onTitleChanged( [this](int) {
+            invalidate( m_entries[Title] );
+            invalidateChapters();
+        });
+        m_eventManager.onMediaChanged( [this](MediaPtr) {
+            invalidate();
+        });
+    }
+
+    TrackDescriptionCache(const TrackDescriptionCache&) = delete;
+    TrackDescriptionCache& operator=(const TrackDescriptionCache&) = delete;
+
+    /**
+     * \see MediaPlayer::audioTrackDescription
+     */
+    Snapshot audioTracks()
+    {
+        return get( m_entries[Audio], &MediaPlayer::audioTrackDescription );
+    }
+
+    /**
+     * \see MediaPlayer::videoTrackDescription
+     */
+    Snapshot videoTracks()
+    {
+        return get( m_entries[Video], &MediaPlayer::videoTrackDescription );
+    }
+
+    /**
+     * \see MediaPlayer::spuDescription
+     */
+    Snapshot spus()
+    {
+        return get( m_entries[Spu], &MediaPlayer::spuDescription );
+    }
+
+    /**
+     * \see MediaPlayer::titleDescription
+     */
+    Snapshot titles()
+    {
+        return get( m_entries[Title], &MediaPlayer::titleDescription );
+    }
+
+    /**
+     * \see MediaPlayer::chapterDescription
+     */
+    Snapshot chapters(int title)
+    {
+        {
+            ReadGuard guard( m_readers );
+            auto map = m_chapters.value.load();
+            if ( map != nullptr )
+            {
+                auto it = map->find( title );
+                if ( it != map->end() )
+                    return it->second;
+            }
+        }
+        auto generation = m_chaptersGeneration.load( std::memory_order_acquire );
+        Snapshot s = std::make_shared<const std::vector<TrackDescription>>(
+                    m_player.chapterDescription( title ) );
+        std::lock_guard<std::mutex> lock( m_mutex );
+        if ( m_chaptersGeneration.load( std::memory_order_relaxed ) == generation )
+        {
+            // Copy on write, so readers never observe a partially updated map
+            auto current = m_chapters.value.load( std::memory_order_relaxed );
+            std::unique_ptr<ChapterMap> updated( current != nullptr ? new ChapterMap( *current )
+                                                                    : new ChapterMap );
+            (*updated)[title] = s;
+            publish( m_chapters, updated.release() );
+        }
+        return s;
+    }
+
+    /**
+     * Drop all cached descriptions
+     */
+    void invalidate()
+    {
+        for ( auto& e : m_entries )
+            invalidate( e );
+        invalidateChapters();
+    }
+
+private:
+    enum Kind
+    {
+        Audio,
+        Video,
+        Spu,
+        Title,
+        NbKinds,
+    };
+
+    // A value published to the readers, and owned by the slot
+    template <typename T>
+    struct Slot
+    {
+        Slot() : value( nullptr ) {}
+        ~Slot() { delete value.load( std::memory_order_relaxed ); }
+        Slot(const Slot&) = delete;
+        Slot& operator=(const Slot&) = delete;
+
+        std::atomic<const T*> value;
+    };
+
+    // Counts the readers which may be reading a published value
+    class ReadGuard
+    {
+    public:
+        explicit ReadGuard(std::atomic<unsigned int>& readers)
+            : m_readers( readers )
+        {
+            m_readers.fetch_add( 1 );
+        }
+
+        ~ReadGuard()
+        {
+            m_readers.fetch_sub( 1 );
+        }
+
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+    private:
+        std::atomic<unsigned int>& m_readers;
+    };
+
+    struct Entry
+    {
+        // Incremented upon each invalidation, so that a snapshot fetched
+        // before an invalidation doesn't get cached after it.
+        std::atomic<unsigned int> generation;
+        Slot<Snapshot> snapshot;
+    };
+
+    using ChapterMap = std::map<int, Snapshot>;
+
+    Snapshot get(Entry& e, std::vector<TrackDescription> (MediaPlayer::*fetch)())
+    {
+        {
+            ReadGuard guard( m_readers );
+            auto s = e.snapshot.value.load();
+            if ( s != nullptr )
+                return *s;
+        }
+        auto generation = e.generation.load( std::memory_order_acquire );
+        auto s = std::make_shared<const std::vector<TrackDescription>>( (m_player.*fetch)() );
+        std::lock_guard<std::mutex> lock( m_mutex );
+        if ( e.generation.load( std::memory_order_relaxed ) == generation )
+            publish( e.snapshot, new Snapshot( s ) );
+        return s;
+    }
+
+    // Must be called with m_mutex held
+    template <typename T>
+    void publish(Slot<T>& slot, const T* value)
+    {
+        auto old = slot.value.exchange( value );
+        if ( old != nullptr )
+            m_retired.emplace_back( old );
+        // A reader which got the old value was counted before loading it, and
+        // therefore before the exchange. Once no reader is counted, none of
+        // them can still be using a retired value.
+        if ( m_readers.load() == 0 )
+            m_retired.clear();
+    }
+
+    void invalidate(Entry& e)
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        e.generation.fetch_add( 1, std::memory_order_release );
+        publish<Snapshot>( e.snapshot, nullptr );
+    }
+
+    void invalidate(libvlc_track_type_t type)
+    {
+        switch ( type )
+        {
+        case libvlc_track_audio:
+            invalidate( m_entries[Audio] );
+            break;
+        case libvlc_track_video:
+            invalidate( m_entries[Video] );
+            break;
+        case libvlc_track_text:
+            invalidate( m_entries[Spu] );
+            break;
+        default:
+            invalidate();
+            break;
+        }
+    }
+
+    void invalidateChapters()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_chaptersGeneration.fetch_add( 1, std::memory_order_release );
+        publish<ChapterMap>( m_chapters, nullptr );
+    }
+
+private:
+    MediaPlayer m_player;
+    std::array<Entry, NbKinds> m_entries;
+    Slot<ChapterMap> m_chapters;
+    std::atomic<unsigned int> m_chaptersGeneration;
+    std::atomic<unsigned int> m_readers;
+    // The values replaced while readers were in flight, freed once there are
+    // none left. Type erased, as they are either snapshots or chapter maps.
+    std::vector<std::shared_ptr<const void>> m_retired;
+    // Serializes the cache updates. Readers don't take it.
+    std::mutex m_mutex;
+    // Declared last, so our handlers are unregistered first
+    MediaPlayerEventManager m_eventManager;
+};
+
+} // namespace VLC
+
+#endif
@@ -0,0 +1,331 @@
+/*****************************************************************************
+ * VirtualMediaList.hpp: Lazily materialized playlist
+ *****************************************************************************
+ * Copyright © 2015 libvlcpp authors & VideoLAN
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_CXX_VIRTUALMEDIALIST_H
+#define LIBVLC_CXX_VIRTUALMEDIALIST_H
+
+#include "common.hpp"
+#include "EventManager.hpp"
+#include "Instance.hpp"
+#include "Media.hpp"
+#include "MediaList.hpp"
+#include "MediaListPlayer.hpp"
+#include "MediaPlayer.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace VLC
+{
+
+/**
+ * @brief A playlist which only materializes the media it is about to play
+ *
+ * Entries are stored as MRLs (or paths) packed in a single arena, which costs
+ * a few bytes per entry on top of the string itself, while a libvlc_media_t
+ * is only created for the current item and the following lookahead items.
+ *
+ * Those are held by a small, real MediaList, the window, which can be fed to
+ * a MediaListPlayer (see attach()) or used to pick media for a MediaPlayer
+ * (see mediaAt()).
+ *
+ * libvlc's media list player keeps track of its current item by index, so
+ * already played items can't be removed from the window while it is playing
+ * without skipping entries. Instead, the items played more than history
+ * entries ago are replaced by a single shared placeholder, which releases
+ * their libvlc_media_t: while a MediaListPlayer advances, the window holds at
+ * most history + 1 + lookahead real media, plus one pointer per played entry.
+ * The placeholders are dropped when the window is rebuilt by setCurrent() or
+ * playAt().
+ *
+ * MediaListPlayer::previous() is therefore only supported within the
+ * history, use playAt() to go further back.
+ */
+class VirtualMediaList
+{
+public:
+    /**
+     * @param instance  The instance used to create the media
+     * @param lookahead The number of items following the current one that
+     *                  must be materialized in the window
+     * @param history   The number of items preceding the current one that
+     *                  are kept materialized in the window
+     */
+    explicit VirtualMediaList(Instance& instance, unsigned int lookahead = 2, unsigned int history = 1)
+        : m_instance( instance )
+        , m_window( instance )
+        , m_windowStart( 0 )
+        , m_liveStart( 0 )
+        , m_current( 0 )
+        , m_lookahead( lookahead )
+        , m_history( history )
+    {
+    }
+
+    VirtualMediaList(const VirtualMediaList&) = delete;
+    VirtualMediaList& operator=(const VirtualMediaList&) = delete;
+
+    /**
+     * Preallocate storage for count more entries, totalizing mrlBytes
+     * characters, on top of the already added ones.
+     */
+    void reserve(size_t count, size_t mrlBytes)
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_offsets.reserve( m_offsets.size() + count );
+        m_arena.reserve( m_arena.size() + mrlBytes + count * 2 );
+    }
+
+    /**
+     * Append an entry to the playlist.
+     *
+     * No media is created, unless the new entry falls in the current window.
+     *
+     * \param mrl   A location, or a path, depending on the 2nd parameter
+     * \param type  Media::FromLocation or Media::FromPath
+     */
+    void add(const std::string& mrl, Media::FromType type = Media::FromLocation)
+    {
+        if ( type == Media::AsNode )
+            throw std::invalid_argument( "Nodes can't be added to a VirtualMediaList" );
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_offsets.push_back( m_arena.size() );
+        m_arena.push_back( type == Media::FromPath ? 'p' : 'l' );
+        m_arena.insert( end( m_arena ), begin( mrl ), end( mrl ) );
+        m_arena.push_back( '\0' );
+        if ( m_offsets.size() - 1 <= m_current + m_lookahead )
+            fillWindow();
+    }
+
+    /**
+     * Number of entries in the playlist
+     */
+    size_t count() const
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_offsets.size();
+    }
+
+    /**
+     * Get the MRL or path of an entry, as it was provided to add()
+     */
+    std::string mrlAt(size_t index) const
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return entry( index ) + 1;
+    }
+
+    /**
+     * Create a Media for an entry.
+     *
+     * If the entry is materialized in the window, that Media is returned.
+     */
+    MediaPtr mediaAt(size_t index)
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        if ( index >= m_liveStart )
+        {
+            MediaList::Lock l( m_window );
+            auto pos = index - m_windowStart;
+            if ( pos < (size_t)m_window.count() )
+                return m_window.itemAtIndex( (int)pos );
+        }
+        return materialize( index );
+    }
+
+    /**
+     * The real MediaList containing the current, lookahead and history
+     * items, preceded by placeholders for the older played items.
+     *
+     * It is owned by this VirtualMediaList and must not be modified.
+     */
+    MediaList& window()
+    {
+        return m_window;
+    }
+
+    /**
+     * Index of the first entry of the window
+     */
+    size_t windowStart() const
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_windowStart;
+    }
+
+    /**
+     * Rebuild the window so it starts at the provided entry.
+     *
+     * If the window is being played by a MediaListPlayer, playback should be
+     * restarted with MediaListPlayer::playItemAtIndex(0), or use playAt().
+     */
+    void setCurrent(size_t index)
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        if ( index >= m_offsets.size() )
+            throw std::out_of_range( "Invalid VirtualMediaList index" );
+        {
+            MediaList::Lock l( m_window );
+            while ( m_window.count() > 0 )
+                m_window.removeIndex( m_window.count() - 1 );
+        }
+        m_windowStart = index;
+        m_liveStart = index;
+        m_current = index;
+        fillWindow();
+    }
+
+    /**
+     * Feed the window to a MediaListPlayer, and keep it filled & trimmed
+     * while the player advances.
+     *
+     * Only one player can be attached at a time.
+     */
+    void attach(MediaListPlayer& mlp)
+    {
+        mlp.setMediaList( m_window );
+        m_playerEventManager.reset( new MediaListPlayerEventManager( mlp.eventManager() ) );
+        m_playerEventManager->onNextItemSet( [this](MediaPtr md) {
+            if ( md == nullptr )
+                return;
+            std::lock_guard<std::mutex> lock( m_mutex );
+            if ( m_placeholder != nullptr && *md == *m_placeholder )
+                return;
+            int pos;
+            {
+                MediaList::Lock l( m_window );
+                pos = m_window.indexOfItem( *md );
+            }
+            if ( pos < 0 )
+                return;
+            m_current = m_windowStart + pos;
+            fillWindow();
+            trimWindow();
+        });
+    }
+
+    /**
+     * Stop following the attached MediaListPlayer, if any
+     */
+    void detach()
+    {
+        m_playerEventManager.reset();
+    }
+
+    /**
+     * Start playing an arbitrary entry with a MediaListPlayer
+     */
+    bool playAt(MediaListPlayer& mlp, size_t index)
+    {
+        setCurrent( index );
+        return mlp.playItemAtIndex( 0 );
+    }
+
+    /**
+     * Start playing an arbitrary entry with a MediaPlayer.
+     *
+     * The window is moved so the following entries are materialized ahead
+     * of time.
+     */
+    int playAt(MediaPlayer& mp, size_t index)
+    {
+        setCurrent( index );
+        auto md = mediaAt( index );
+        mp.setMedia( *md );
+        return mp.play();
+    }
+
+private:
+    // Must be called with m_mutex held
+    const char* entry(size_t index) const
+    {
+        if ( index >= m_offsets.size() )
+            throw std::out_of_range( "Invalid VirtualMediaList index" );
+        return m_arena.data() + m_offsets[index];
+    }
+
+    // Must be called with m_mutex held
+    MediaPtr materialize(size_t index)
+    {
+        auto e = entry( index );
+        auto type = e[0] == 'p' ? Media::FromPath : Media::FromLocation;
+        return std::make_shared<Media>( m_instance, e + 1, type );
+    }
+
+    // Append entries to the window, until current + lookahead is covered.
+    // Must be called with m_mutex held
+    void fillWindow()
+    {
+        MediaList::Lock l( m_window );
+        auto last = std::min<size_t>( m_current + m_lookahead + 1, m_offsets.size() );
+        for ( auto i = m_windowStart + m_window.count(); i < last; ++i )
+        {
+            auto md = materialize( i );
+            m_window.addMedia( *md );
+        }
+    }
+
+    // Replace the items preceding the history by the placeholder, keeping
+    // their index so the player's current index remains valid.
+    // Must be called with m_mutex held
+    void trimWindow()
+    {
+        if ( m_liveStart + m_history >= m_current )
+            return;
+        if ( m_placeholder == nullptr )
+            m_placeholder = std::make_shared<Media>( m_instance, "vlc://nop", Media::FromType::FromLocation );
+        MediaList::Lock l( m_window );
+        for ( ; m_liveStart + m_history < m_current; ++m_liveStart )
+        {
+            auto pos = (int)( m_liveStart - m_windowStart );
+            m_window.removeIndex( pos );
+            m_window.insertMedia( *m_placeholder, pos );
+        }
+    }
+
+private:
+    Instance m_instance;
+    // Each entry is stored as a type tag ('p' for a path, 'l' for a
+    // location) followed by the NUL terminated string.
+    std::vector<char> m_arena;
+    std::vector<size_t> m_offsets;
+    MediaList m_window;
+    size_t m_windowStart;
+    // Index of the first entry which isn't replaced by the placeholder
+    size_t m_liveStart;
+    // Index of the entry being played
+    size_t m_current;
+    unsigned int m_lookahead;
+    unsigned int m_history;
+    MediaPtr m_placeholder;
+    mutable std::mutex m_mutex;
+    // Declared last, so our handler is unregistered first
+    std::unique_ptr<MediaListPlayerEventManager> m_playerEventManager;
+};
+
+} // namespace VLC
+
+#endif
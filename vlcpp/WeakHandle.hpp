@@ -0,0 +1,202 @@
+/*****************************************************************************
+ * WeakHandle.hpp: Non-owning references to libvlc objects
+ *****************************************************************************
+ * Copyright © 2015 libvlcpp authors & VideoLAN
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_CXX_WEAKHANDLE_H
+#define LIBVLC_CXX_WEAKHANDLE_H
+
+#include "Internal.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <type_traits>
+
+namespace VLC
+{
+
+/**
+ * @brief Refers to a libvlc object without keeping it alive
+ *
+ * The object is released as soon as the last strong handle (Media,
+ * MediaPlayer, ...) to it goes away. lock() then returns an invalid handle.
+ *
+ * Weak handles are compared, ordered and hashed by the address of their
+ * object, and can therefore be used as keys in std::map and
+ * std::unordered_map:
+ *
+ * \code
+ * std::map<VLC::WeakHandle<VLC::MediaPlayer>, Stats> stats;
+ * stats[player].nbPlays++;
+ * \endcode
+ *
+ * Once an object is released, its address may be reused by a new object,
+ * whose weak handles then compare equal to the expired ones. Entries keyed
+ * by expired handles should therefore be pruned.
+ *
+ * lock() returns a fresh wrapper around the same libvlc object, which
+ * compares equal to the original one. A MediaPlayer gets back the video &
+ * audio callbacks storage of the original wrapper, so they can be set
+ * through it. The rest of the wrapper side state isn't shared though: it
+ * has its own event manager, and an Instance doesn't cache its module lists.
+ *
+ * A weak handle to a borrowed object (see Media::borrow()) is always expired.
+ * Weak handles are only available with the std::shared_ptr handle policy.
+ */
+template <typename T>
+class WeakHandle
+{
+    using InternalType = typename T::InternalType;
+    using InternalPtr = typename T::InternalPtr;
+
+    static_assert( std::is_same<typename T::Pointer, std::shared_ptr<InternalType>>::value,
+                   "WeakHandle requires a std::shared_ptr handle, see VLCPP_INTRUSIVE_HANDLES" );
+    static_assert( std::is_default_constructible<T>::value && std::is_copy_constructible<T>::value,
+                   "WeakHandle requires a default constructible & copyable handle" );
+
+public:
+    WeakHandle()
+        : m_ptr( nullptr )
+    {
+    }
+
+    WeakHandle( const T& obj )
+        : m_obj( pointer( obj ) )
+        // Borrowed handles have no owner, and are expired right away
+        , m_ptr( m_obj.expired() ? nullptr : obj.get() )
+    {
+    }
+
+    /**
+     * Returns a new strong handle to the object, or an invalid handle (see
+     * Internal::isValid()) if it has been released already.
+     *
+     * The returned wrapper doesn't share the original one's event manager
+     * nor caches, see the class documentation.
+     */
+    T lock() const
+    {
+        T res;
+        pointer( res ) = m_obj.lock();
+        adoptCallbacks( res, 0 );
+        return res;
+    }
+
+    /**
+     * Returns true if the object has been released.
+     *
+     * This can only be trusted when it returns true, since another thread may
+     * release the last strong handle meanwhile.
+     */
+    bool expired() const
+    {
+        return m_obj.expired();
+    }
+
+    void reset()
+    {
+        m_obj.reset();
+        m_ptr = nullptr;
+    }
+
+    /**
+     * Returns the address of the object this handle was created from.
+     *
+     * This is only meant for logging & hashing: the object might have been
+     * released, and the address reused.
+     */
+    InternalPtr address() const
+    {
+        return m_ptr;
+    }
+
+    /**
+     * Orders the handles by their object address, consistently with the
+     * equality and the hash.
+     */
+    bool operator<( const WeakHandle& another ) const
+    {
+        return std::less<InternalPtr>()( m_ptr, another.m_ptr );
+    }
+
+    /**
+     * Check if 2 weak handles refer to the same object address.
+     */
+    bool operator==( const WeakHandle& another ) const
+    {
+        return m_ptr == another.m_ptr;
+    }
+
+    bool operator!=( const WeakHandle& another ) const
+    {
+        return !( *this == another );
+    }
+
+private:
+    // Wrappers which own callbacks, ie. MediaPlayer, recover them from the
+    // deleter of their handle
+    template <typename U>
+    static auto adoptCallbacks( U& obj, int ) -> decltype( obj.adoptCallbacks() )
+    {
+        obj.adoptCallbacks();
+    }
+
+    template <typename U>
+    static void adoptCallbacks( U&, long )
+    {
+    }
+
+    // Naming m_obj through Internal, which befriends us
+    static typename T::Pointer& pointer( T& obj )
+    {
+        return static_cast<typename T::InternalBase&>( obj ).m_obj;
+    }
+
+    static const typename T::Pointer& pointer( const T& obj )
+    {
+        return static_cast<const typename T::InternalBase&>( obj ).m_obj;
+    }
+
+private:
+    std::weak_ptr<InternalType> m_obj;
+    // Kept alongside the weak pointer, since the address can't be retrieved
+    // from an expired weak_ptr.
+    InternalPtr m_ptr;
+};
+
+} // namespace VLC
+
+namespace std
+{
+
+template <typename T>
+struct hash<VLC::WeakHandle<T>>
+{
+    // Handles which compare equal share the same object, hence the same address
+    size_t operator()( const VLC::WeakHandle<T>& h ) const
+    {
+        return std::hash<typename T::InternalPtr>()( h.address() );
+    }
+};
+
+} // namespace std
+
+#endif
@@ -27,7 +27,13 @@
 #include <vlc/vlc.h>
 #include <array>
 #include <cassert>
+#include <cstring>
 #include <memory>
+#include <string>
+#include <utility>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
 
 namespace VLC
 {
@@ -53,6 +59,99 @@ namespace VLC
         return std::unique_ptr<char, void(*)(void*)>( str, [](void* ptr) { libvlc_free(ptr); } );
     }
 
+    /**
+     * @brief Owns a string allocated by libvlc
+     *
+     * This exposes the libvlc buffer as is, saving the copy to a std::string.
+     * A null string is exposed as an empty one.
+     */
+    class VlcString
+    {
+    public:
+        VlcString()
+            : m_str( nullptr )
+            , m_size( 0 )
+        {
+        }
+
+        /**
+         * Takes ownership of str, which will be released with libvlc_free()
+         */
+        explicit VlcString( char* str )
+            : m_str( str )
+            , m_size( str != nullptr ? strlen( str ) : 0 )
+        {
+        }
+
+        VlcString( VlcString&& s ) noexcept
+            : m_str( s.m_str )
+            , m_size( s.m_size )
+        {
+            s.m_str = nullptr;
+            s.m_size = 0;
+        }
+
+        VlcString& operator=( VlcString&& s ) noexcept
+        {
+            std::swap( m_str, s.m_str );
+            std::swap( m_size, s.m_size );
+            return *this;
+        }
+
+        VlcString( const VlcString& ) = delete;
+        VlcString& operator=( const VlcString& ) = delete;
+
+        ~VlcString()
+        {
+            if ( m_str != nullptr )
+                libvlc_free( m_str );
+        }
+
+        const char* data() const
+        {
+            return c_str();
+        }
+
+        const char* c_str() const
+        {
+            return m_str != nullptr ? m_str : "";
+        }
+
+        size_t size() const
+        {
+            return m_size;
+        }
+
+        bool empty() const
+        {
+            return m_size == 0;
+        }
+
+        /**
+         * Returns false if libvlc returned a null string
+         */
+        bool isValid() const
+        {
+            return m_str != nullptr;
+        }
+
+        std::string str() const
+        {
+            return std::string( c_str(), m_size );
+        }
+
+#if __cplusplus >= 201703L
+        operator std::string_view() const
+        {
+            return std::string_view( c_str(), m_size );
+        }
+#endif
+
+    private:
+        char* m_str;
+        size_t m_size;
+    };
+
 #if !defined(_MSC_VER)
     // Kudos to 3xxO for the signature_match helper
     template <typename, typename, typename = void>
@@ -102,10 +201,40 @@ namespace VLC
     template <int NbEvent>
     struct EventOwner
     {
-        std::array<std::shared_ptr<CallbackHandlerBase>, NbEvent> callbacks;
+        using Callbacks = std::array<std::shared_ptr<CallbackHandlerBase>, NbEvent>;
+
+        // The callbacks live in their own heap block, which is the opaque
+        // pointer given to libvlc. The handle of the object invoking them
+        // owns it as well (see CallbacksReleaser), so it is only freed once
+        // the object has been released, whichever copy of the handle drops
+        // the last reference, and from whichever thread.
+        // Only the wrapper which created the object, and its copies, have
+        // one: callbacks can't be set through another wrapper.
+        std::shared_ptr<Callbacks> callbacks;
 
     protected:
         EventOwner() = default;
+
+        explicit EventOwner( std::shared_ptr<Callbacks> c )
+            : callbacks( std::move( c ) )
+        {
+        }
+    };
+
+    // Releases a libvlc object, and then the callbacks it may invoke until
+    // it is destroyed
+    template <typename T, int NbEvent>
+    struct CallbacksReleaser
+    {
+        void operator()( T* obj )
+        {
+            if ( obj != nullptr )
+                release( obj );
+            callbacks.reset();
+        }
+
+        void (*release)( T* );
+        std::shared_ptr<typename EventOwner<NbEvent>::Callbacks> callbacks;
     };
 
     template <int Idx, typename Func, typename... Args>
@@ -124,11 +253,12 @@ namespace VLC
         template <int NbEvents>
         static Wrapped* wrap(EventOwner<NbEvents>* owner, Func&& func)
         {
-            owner->callbacks[Idx] = std::make_shared<CallbackHandler<Func>>( std::move( func ) );
+            assert( owner->callbacks != nullptr );
+            (*owner->callbacks)[Idx] = std::make_shared<CallbackHandler<Func>>( std::move( func ) );
             return [](void* opaque, Args... args) -> Ret {
-                auto self = reinterpret_cast<EventOwner<NbEvents>*>(opaque);
-                assert(self->callbacks[Idx].get());
-                auto cbHandler = static_cast<CallbackHandler<Func>*>( self->callbacks[Idx].get() );
+                auto self = reinterpret_cast<typename EventOwner<NbEvents>::Callbacks*>(opaque);
+                assert((*self)[Idx].get());
+                auto cbHandler = static_cast<CallbackHandler<Func>*>( (*self)[Idx].get() );
                 return cbHandler->func( std::move(args)... );
             };
         }
@@ -144,11 +274,12 @@ namespace VLC
         template <int NbEvents>
         static Wrapped* wrap(EventOwner<NbEvents>* owner, Func&& func)
         {
-            owner->callbacks[Idx] = std::make_shared<CallbackHandler<Func>>( std::move( func ) );
+            assert( owner->callbacks != nullptr );
+            (*owner->callbacks)[Idx] = std::make_shared<CallbackHandler<Func>>( std::move( func ) );
             return [](void** opaque, Args... args) -> Ret {
-                auto self = reinterpret_cast<EventOwner<NbEvents>*>(*opaque);
-                assert(self->callbacks[Idx].get());
-                auto cbHandler = static_cast<CallbackHandler<Func>*>( self->callbacks[Idx].get() );
+                auto self = reinterpret_cast<typename EventOwner<NbEvents>::Callbacks*>(*opaque);
+                assert((*self)[Idx].get());
+                auto cbHandler = static_cast<CallbackHandler<Func>*>( (*self)[Idx].get() );
                 return cbHandler->func( std::move(args)... );
             };
         }
@@ -24,7 +24,14 @@
 #ifndef LIBVLC_CXX_STRUCTURES_H
 #define LIBVLC_CXX_STRUCTURES_H
 
+#include <array>
+#include <cstring>
+#include <memory>
 #include <string>
+#include <vector>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
 
 #include "common.hpp"
 
@@ -77,6 +84,17 @@ private:
 };
 
 
+/**
+ * @brief The description of an elementary stream
+ *
+ * The type specific fields share the same storage, and the strings live in
+ * a separate immutable block. Each track has its own block, which is only
+ * allocated when the track has any string, and which its copies share. This
+ * keeps large track indexes compact, and their copies cheap.
+ *
+ * Type specific accessors return 0, or an empty string, when invoked on a
+ * track of another type.
+ */
 class MediaTrack
 {
 public:
@@ -129,60 +147,61 @@ public:
 
     const std::string& language() const
     {
-        return m_language;
+        return strings().language;
     }
 
     const std::string& description() const
     {
-        return m_description;
+        return strings().description;
     }
 
     // Audio specific
     uint32_t channels() const
     {
-        return m_channels;
+        return m_type == Audio ? m_audio.channels : 0;
     }
 
     uint32_t rate() const
     {
-        return m_rate;
+        return m_type == Audio ? m_audio.rate : 0;
     }
 
     // Video specific
     uint32_t height() const
     {
-        return m_height;
+        return m_type == Video ? m_video.height : 0;
     }
 
     uint32_t width() const
     {
-        return m_width;
+        return m_type == Video ? m_video.width : 0;
     }
 
     uint32_t sarNum() const
     {
-        return m_sarNum;
+        return m_type == Video ? m_video.sarNum : 0;
     }
 
     uint32_t sarDen() const
     {
-        return m_sarDen;
+        return m_type == Video ? m_video.sarDen : 0;
     }
 
     uint32_t fpsNum() const
     {
-        return m_fpsNum;
+        return m_type == Video ? m_video.fpsNum : 0;
     }
 
     uint32_t fpsDen() const
     {
-        return m_fpsDen;
+        return m_type == Video ? m_video.fpsDen : 0;
     }
 
     // Subtitles specific
     const std::string& encoding() const
     {
-        return m_encoding;
+        // Only set for subtitles
+        return strings().encoding;
     }
 
     explicit MediaTrack(libvlc_media_track_t* c)
@@ -193,30 +212,26 @@ public:
         , m_level( c->i_level )
         , m_bitrate( c->i_bitrate )
     {
-        if ( c->psz_language != NULL )
-            m_language = c->psz_language;
-        if ( c->psz_description != NULL )
-            m_description = c->psz_description;
+        if ( Strings::hasAny( c ) )
+            m_strings = std::make_shared<const Strings>( c );
         switch ( c->i_type )
         {
             case libvlc_track_audio:
                 m_type = Audio;
-                m_channels = c->audio->i_channels;
-                m_rate = c->audio->i_rate;
+                m_audio.channels = c->audio->i_channels;
+                m_audio.rate = c->audio->i_rate;
                 break;
             case libvlc_track_video:
                 m_type = Video;
-                m_height = c->video->i_height;
-                m_width = c->video->i_width;
-                m_sarNum = c->video->i_sar_num;
-                m_sarDen = c->video->i_sar_den;
-                m_fpsNum = c->video->i_frame_rate_num;
-                m_fpsDen = c->video->i_frame_rate_den;
+                m_video.height = c->video->i_height;
+                m_video.width = c->video->i_width;
+                m_video.sarNum = c->video->i_sar_num;
+                m_video.sarDen = c->video->i_sar_den;
+                m_video.fpsNum = c->video->i_frame_rate_num;
+                m_video.fpsDen = c->video->i_frame_rate_den;
                 break;
             case libvlc_track_text:
                 m_type = Subtitle;
-                if ( c->subtitle->psz_encoding != NULL )
-                    m_encoding = c->subtitle->psz_encoding;
                 break;
             case libvlc_track_unknown:
             default:
@@ -226,27 +241,69 @@ public:
     }
 
 private:
+    struct Strings
+    {
+        Strings() = default;
+
+        explicit Strings( libvlc_media_track_t* c )
+            : language( c->psz_language != NULL ? c->psz_language : "" )
+            , description( c->psz_description != NULL ? c->psz_description : "" )
+            , encoding( c->i_type == libvlc_track_text && c->subtitle->psz_encoding != NULL ?
+                            c->subtitle->psz_encoding : "" )
+        {
+        }
+
+        static bool hasAny( libvlc_media_track_t* c )
+        {
+            return ( c->psz_language != NULL && *c->psz_language != 0 ) ||
+                   ( c->psz_description != NULL && *c->psz_description != 0 ) ||
+                   ( c->i_type == libvlc_track_text && c->subtitle->psz_encoding != NULL &&
+                     *c->subtitle->psz_encoding != 0 );
+        }
+
+        std::string language;
+        std::string description;
+        std::string encoding;
+    };
+
+    // The tracks without any string don't allocate a block
+    const Strings& strings() const
+    {
+        static const Strings none{};
+        return m_strings != nullptr ? *m_strings : none;
+    }
+
+private:
+    struct AudioInfo
+    {
+        uint32_t channels;
+        uint32_t rate;
+    };
+
+    struct VideoInfo
+    {
+        uint32_t height;
+        uint32_t width;
+        uint32_t sarNum;
+        uint32_t sarDen;
+        uint32_t fpsNum;
+        uint32_t fpsDen;
+    };
+
     uint32_t m_codec;
     uint32_t m_originalFourcc;
     uint32_t m_id;
-    Type m_type;
     int32_t m_profile;
     int32_t m_level;
     uint32_t m_bitrate;
-    std::string m_language;
-    std::string m_description;
-    // Audio
-    uint32_t m_channels;
-    uint32_t m_rate;
-    // Video
-    uint32_t m_height;
-    uint32_t m_width;
-    uint32_t m_sarNum;
-    uint32_t m_sarDen;
-    uint32_t m_fpsNum;
-    uint32_t m_fpsDen;
-    // Subtitles
-    std::string m_encoding;
+    Type m_type;
+    // Only the member matching m_type is initialized
+    union
+    {
+        AudioInfo m_audio;
+        VideoInfo m_video;
+    };
+    std::shared_ptr<const Strings> m_strings;
 };
 
 
@@ -276,6 +333,236 @@ private:
     std::string m_description;
 };
 
+/**
+ * @brief A non-owning reference to a NUL terminated string
+ */
+class StringRef
+{
+public:
+    StringRef()
+        : m_data( "" )
+        , m_size( 0 )
+    {
+    }
+
+    StringRef( const char* data, size_t size )
+        : m_data( data )
+        , m_size( size )
+    {
+    }
+
+    const char* data() const
+    {
+        return m_data;
+    }
+
+    const char* c_str() const
+    {
+        return m_data;
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    std::string str() const
+    {
+        return std::string( m_data, m_size );
+    }
+
+    bool operator==( const StringRef& s ) const
+    {
+        return m_size == s.m_size && memcmp( m_data, s.m_data, m_size ) == 0;
+    }
+
+    bool operator!=( const StringRef& s ) const
+    {
+        return !( *this == s );
+    }
+
+#if __cplusplus >= 201703L
+    operator std::string_view() const
+    {
+        return std::string_view( m_data, m_size );
+    }
+#endif
+
+private:
+    const char* m_data;
+    size_t m_size;
+};
+
+/**
+ * @brief An immutable list of libvlc descriptions, with all their strings
+ * stored in a single buffer.
+ *
+ * Lists aren't copyable, since their entries point to their own buffer.
+ * They are meant to be shared through a std::shared_ptr<const ...>
+ */
+template <typename Entry, typename T, size_t NbFields>
+class DescriptionList
+{
+public:
+    using const_iterator = typename std::vector<Entry>::const_iterator;
+
+    DescriptionList( const DescriptionList& ) = delete;
+    DescriptionList& operator=( const DescriptionList& ) = delete;
+
+    size_t size() const
+    {
+        return m_entries.size();
+    }
+
+    bool empty() const
+    {
+        return m_entries.empty();
+    }
+
+    const Entry& operator[]( size_t idx ) const
+    {
+        return m_entries[idx];
+    }
+
+    const_iterator begin() const
+    {
+        return m_entries.begin();
+    }
+
+    const_iterator end() const
+    {
+        return m_entries.end();
+    }
+
+protected:
+    template <typename Getter>
+    DescriptionList( T* list, Getter get )
+    {
+        // Size the buffer first, so that it never gets reallocated while the
+        // entries point to it.
+        size_t nbEntries = 0;
+        size_t arenaSize = 0;
+        for ( auto p = list; p != nullptr; p = p->p_next )
+        {
+            std::array<const char*, NbFields> fields = get( p );
+            for ( auto f : fields )
+                arenaSize += ( f != nullptr ? strlen( f ) : 0 ) + 1;
+            ++nbEntries;
+        }
+        m_arena.reserve( arenaSize );
+        m_entries.reserve( nbEntries );
+        for ( auto p = list; p != nullptr; p = p->p_next )
+        {
+            std::array<const char*, NbFields> fields = get( p );
+            Entry e;
+            for ( size_t i = 0; i < NbFields; ++i )
+            {
+                auto len = fields[i] != nullptr ? strlen( fields[i] ) : 0;
+                auto offset = m_arena.size();
+                m_arena.insert( m_arena.end(), fields[i], fields[i] + len );
+                m_arena.push_back( 0 );
+                e.m_fields[i] = StringRef( m_arena.data() + offset, len );
+            }
+            m_entries.push_back( e );
+        }
+    }
+
+private:
+    std::vector<char> m_arena;
+    std::vector<Entry> m_entries;
+};
+
+/**
+ * @brief A ModuleDescription, referencing a ModuleDescriptionList buffer
+ */
+class ModuleInfo
+{
+public:
+    StringRef name() const
+    {
+        return m_fields[0];
+    }
+
+    StringRef shortname() const
+    {
+        return m_fields[1];
+    }
+
+    StringRef longname() const
+    {
+        return m_fields[2];
+    }
+
+    StringRef help() const
+    {
+        return m_fields[3];
+    }
+
+private:
+    std::array<StringRef, 4> m_fields;
+
+    template <typename, typename, size_t>
+    friend class DescriptionList;
+};
+
+class ModuleDescriptionList : public DescriptionList<ModuleInfo, libvlc_module_description_t, 4>
+{
+public:
+    /**
+     * \param list  The libvlc list to copy. It isn't released.
+     */
+    explicit ModuleDescriptionList( libvlc_module_description_t* list )
+        : DescriptionList( list, []( libvlc_module_description_t* m ) {
+            return std::array<const char*, 4>{ { m->psz_name, m->psz_shortname,
+                                                 m->psz_longname, m->psz_help } };
+        })
+    {
+    }
+};
+
+/**
+ * @brief An AudioOutputDescription, referencing an AudioOutputDescriptionList
+ * buffer
+ */
+class AudioOutputInfo
+{
+public:
+    StringRef name() const
+    {
+        return m_fields[0];
+    }
+
+    StringRef description() const
+    {
+        return m_fields[1];
+    }
+
+private:
+    std::array<StringRef, 2> m_fields;
+
+    template <typename, typename, size_t>
+    friend class DescriptionList;
+};
+
+class AudioOutputDescriptionList : public DescriptionList<AudioOutputInfo, libvlc_audio_output_t, 2>
+{
+public:
+    /**
+     * \param list  The libvlc list to copy. It isn't released.
+     */
+    explicit AudioOutputDescriptionList( libvlc_audio_output_t* list )
+        : DescriptionList( list, []( libvlc_audio_output_t* o ) {
+            return std::array<const char*, 2>{ { o->psz_name, o->psz_description } };
+        })
+    {
+    }
+};
+
 class AudioOutputDeviceDescription
 {
     public:
@@ -296,7 +583,17 @@ class AudioOutputDeviceDescription
             if ( d->psz_device != NULL )
                 m_device = d->psz_device;
             if ( d->psz_description != NULL )
-                m_device = d->psz_description;
+                m_description = d->psz_description;
+        }
+
+        bool operator==( const AudioOutputDeviceDescription& d ) const
+        {
+            return m_device == d.m_device && m_description == d.m_description;
+        }
+
+        bool operator!=( const AudioOutputDeviceDescription& d ) const
+        {
+            return !( *this == d );
         }
 
     private:
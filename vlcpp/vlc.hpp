@@ -33,6 +33,21 @@
 #include "MediaList.hpp"
 #include "EventManager.hpp"
 #include "structures.hpp"
+#include "IndexedMediaList.hpp"
+#include "VirtualMediaList.hpp"
+#include "PlaylistParser.hpp"
+#include "GaplessMediaListPlayer.hpp"
+#include "MediaPlayerPool.hpp"
+#include "PlayerStateMirror.hpp"
+#include "SeekController.hpp"
+#include "StartupProbe.hpp"
+#include "DecodeSession.hpp"
+#include "Equalizer.hpp"
+#include "TrackDescriptionCache.hpp"
+#include "AudioOutputDeviceRegistry.hpp"
+#include "LogCapture.hpp"
+#include "InstanceProvider.hpp"
+#include "WeakHandle.hpp"
 
 #include <memory>
 